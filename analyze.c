@@ -9,439 +9,524 @@
 #include "symtab.h"
 #include "analyze.h"
 #include "util.h"
-
-static char *funcName;
+#include "pool.h"
+#include "callgraph.h"
+#include "intrinsic.h"
+#include "iface.h"
+#include "visit.h"
+
+/* each thread checking function bodies keeps its
+ * own current function (see typeCheck)
+ */
+static __thread char *funcName;
 static int preserveLastScope = FALSE;
+
+/* the variable assigned by the innermost AssignK
+ * seen, so that its use is recorded as a write
+ */
+static TreeNode *assignTarget = NULL;
 int main_count = 0;
 
 /* counter for variable memory locations */
 
-/* Procedure traverse is a generic recursive
- * syntax tree traversal routine:
- * it applies preProc in preorder and postProc
- * in postorder to tree pointed to by t
+/* Function isIntrinsicStub tells if the function
+ * declaration t is the first declaration in the
+ * source of a built-in function, with its types
+ */
+static int isIntrinsicStub(TreeNode *t) {
+  const Intrinsic *in = intrinsic(t->attr.name);
+  BucketList l = st_bucket(t->attr.name);
+  int k;
+
+  if (in == NULL || l == NULL || l->treeNode != in->decl || !intrinsicMatches(in, t))
+    return FALSE;
+  for (k = 0; k < l->nUses; ++k)
+    if (l->uses[k].kind == UseDecl)
+      return FALSE;
+  return TRUE;
+}
+
+static void symbolError(TreeNode *t, char *message) {
+  printError("semantic", t->lineno, message);
+  Error = TRUE;
+}
+
+/* The handlers of the symbol table pass insert
+ * the identifiers declared at a node into the
+ * symbol table and record the uses of the others
  */
-static void traverse( TreeNode *t,
-               void (*preProc) (TreeNode*),
-               void (*postProc) (TreeNode*) ) {
-  if (t != NULL) {
-    preProc(t);
-    int i;
-    for (i=0; i < MAXCHILDREN; i++)
-      traverse(t->child[i], preProc, postProc);
-    postProc(t);
-    traverse(t->sibling, preProc, postProc);
+static void insertCompound(TreeNode *t) {
+  if (preserveLastScope) {
+    preserveLastScope = FALSE;
+  }
+  else {
+    Scope scope = sc_create(funcName);
+    sc_push(scope);
   }
+  t->attr.scope = sc_top();
 }
 
-static void insertIOFunc(void) {
-  TreeNode *func;
-  TreeNode *typeSpec;
-  TreeNode *param;
-  TreeNode *compStmt;
+static void insertAssign(TreeNode *t) {
+  assignTarget = t->child[0];
+}
 
-  func = newDeclNode(FuncK);
+static void insertId(TreeNode *t) {
+  if (st_lookup(t->attr.name) == -1)
+  /* not yet in table, error */
+    symbolError(t, "rule 1 - undeclared symbol");
+  else
+  /* already in table, so ignore location,
+     add the use only */
+    st_add_use(t->attr.name, t, t == assignTarget ? UseWrite : UseRead);
+}
 
-  typeSpec = newTypeNode(FuncK);
-  typeSpec->attr.type = INT;
-  func->type = Integer;
+static void insertCall(TreeNode *t) {
+  if (st_lookup(t->attr.name) == -1)
+  /* not yet in table, error */
+    symbolError(t, "rule 5 - undeclared function");
+  else {
+  /* already in table, so ignore location,
+     add the use only */
+    st_add_use(t->attr.name, t, UseCall);
+    cg_addCall(st_bucket(t->attr.name)->treeNode, t->lineno);
+  }
+}
 
-  compStmt = newStmtNode(CompK);
-  compStmt->child[0] = NULL;      // no local var
-  compStmt->child[1] = NULL;      // no stmt
+static void insertFunc(TreeNode *t) {
+  funcName = t->attr.name;
+  if (strcmp(funcName, "main") == 0)
+    main_count++;
+  /* a function declared again gets a node as well,
+   * so that its calls are not credited to the one
+   * before it
+   */
+  cg_addFunc(t);
+  if (isIntrinsicStub(t))
+  /* the body of a stub for a built-in function
+     is checked but never compiled */
+    st_add_use(funcName, t, UseDecl);
+  else if (st_lookup_top(funcName) >= 0) {
+  /* already in table, so it's an error */
+    symbolError(t, "rule 7 - function already declared");
+    return;
+  }
+  else
+    st_insert(funcName, t->lineno, addLocation(), t);
+  sc_push(sc_create(funcName));
+  preserveLastScope = TRUE;
+  switch (t->child[0]->attr.type) {
+    case INT:
+      t->type = Integer;
+      break;
+    case VOID:
+    default:
+      t->type = Void;
+      break;
+  }
+}
 
-  func->lineno = 0;
-  func->attr.name = "input";
-  func->child[0] = typeSpec;
-  func->child[1] = NULL;          // no param
-  func->child[2] = compStmt;
+static void insertVar(TreeNode *t) {
+  char *name;
 
-  st_insert("input", -1, addLocation(), func);
+  if (t->child[0]->attr.type == VOID) {
+    symbolError(t, "rule 3 - variable should have non-void type");
+    return;
+  }
 
-  func = newDeclNode(FuncK);
+  if (t->kind.decl == VarK) {
+    name = t->attr.name;
+    t->type = Integer;
+  }
+  else {
+    name = t->attr.vector.name;
+    t->type = IntegerArray;
+  }
 
-  typeSpec = newTypeNode(FuncK);
-  typeSpec->attr.type = VOID;
-  func->type = Void;
+  if (st_lookup_top(name) >= 0)
+    symbolError(t, "symbol already declared for current scope");
+  else if (st_lookup_top_func(name) >= 0)
+    symbolError(t, "function already declared with symbol name");
+  else
+    st_insert(name, t->lineno, addLocation(), t);
+}
 
-  param = newParamNode(NonVectorParamK);
-  param->attr.name = "arg";
-  param->child[0] = newTypeNode(FuncK);
-  param->child[0]->attr.type = INT;
+static void insertParam(TreeNode *t) {
+  if (t->child[0]->attr.type == VOID)
+    symbolError(t->child[0], "void type parameter is not allowed");
+  if (st_lookup_top(t->attr.name) == -1) {
+    st_insert(t->attr.name, t->lineno, addLocation(), t);
+    if (t->kind.param == NonVectorParamK)
+      t->type = Integer;
+    else
+      t->type = IntegerArray;
+  }
+  else
+    symbolError(t, "rule 4 - symbol already declared for current scope");
+}
 
-  compStmt = newStmtNode(CompK);
-  compStmt->child[0] = NULL;      // no local var
-  compStmt->child[1] = NULL;      // no stmt
+static void popScope(TreeNode *t) {
+  sc_pop();
+}
 
-  func->lineno = 0;
-  func->attr.name = "output";
-  func->child[0] = typeSpec;
-  func->child[1] = param;
-  func->child[2] = compStmt;
+#define INSERT_PRE(X)                       \
+  X(StmtK,  CompK,           insertCompound) \
+  X(ExpK,   AssignK,         insertAssign)   \
+  X(ExpK,   IdK,             insertId)       \
+  X(ExpK,   VectorIdK,       insertId)       \
+  X(ExpK,   CallK,           insertCall)     \
+  X(DeclK,  FuncK,           insertFunc)     \
+  X(DeclK,  VarK,            insertVar)      \
+  X(DeclK,  VectorVarK,      insertVar)      \
+  X(ParamK, VectorParamK,    insertParam)    \
+  X(ParamK, NonVectorParamK, insertParam)
+
+#define INSERT_POST(X)                       \
+  X(StmtK,  CompK,           popScope)
+
+DEFINE_VISITOR(insertTree, INSERT_PRE, INSERT_POST)
+
+/* Procedure beginSymtab empties the symbol table
+ * and opens the global scope with the built-in
+ * functions, for insertDecl to fill
+ */
+void beginSymtab(void) {
+  st_reset();
+  cg_reset();
+  main_count = 0;
+  preserveLastScope = FALSE;
+  assignTarget = NULL;
+  globalScope = sc_create(NULL);
+  sc_push(globalScope);
+  insertIntrinsics();
+  insertImports();
+}
 
-  st_insert("output", -1, addLocation(), func);
+/* Procedure insertDecl inserts the identifiers of
+ * the top-level declaration decl into the symbol
+ * table
+ */
+void insertDecl(TreeNode *decl) {
+  insertTreeNode(decl);
 }
 
-/* nullProc is a do-nothing procedure to
- * generate preorder-only or postorder-only
- * traversals from traverse
+/* Procedure endSymtab closes the global scope and
+ * finds the functions reachable from main
  */
-static void nullProc(TreeNode *t) {
-  if (t==NULL)
-    return;
-  else
-    return;
+void endSymtab(void) {
+  sc_pop();
+  cg_markReachable();
 }
 
-static void symbolError(TreeNode *t, char *message) {
-  fprintf(listing, "line %d: %s\n", t->lineno, message);
-  Error = TRUE;
+/* Function buildSymtab constructs the symbol
+ * table by preorder traversal of the syntax tree
+ */
+void buildSymtab(TreeNode *syntaxTree) {
+  beginSymtab();
+  insertTree(syntaxTree);
+  endSymtab();
+  if (TraceAnalyze) {
+    if (!JsonListing)
+      fprintf(listing, "\nSymbol table:\n\n");
+    printSymTab(listing);
+  }
 }
 
-/* Procedure insertNode inserts
- * identifiers stored in t into
- * the symbol table
+/* Procedure releaseTree releases the scopes of the
+ * compound statements in the statement list tree,
+ * innermost first
  */
-static void insertNode( TreeNode *t) {
-  switch (t->nodekind) {
-    case StmtK:
-      switch (t->kind.stmt) {
+static void releaseTree(TreeNode *tree) {
+  while (tree != NULL) {
+    if (tree->nodekind == StmtK) {
+      switch (tree->kind.stmt) {
         case CompK:
-          if (preserveLastScope) {
-            preserveLastScope = FALSE;
-          }
-          else {
-            Scope scope = sc_create(funcName);
-            sc_push(scope);
-          }
-          t->attr.scope = sc_top();
-          break;
-        default:
+          releaseTree(tree->child[1]);
+          st_release(tree->attr.scope);
+          tree->attr.scope = NULL;
           break;
-      }
-      break;
-    case ExpK:
-      switch (t->kind.exp) {
-        case IdK:
-        case VectorIdK:
-          if (st_lookup(t->attr.name) == -1)
-          /* not yet in table, error */
-            symbolError(t, "rule 1 - undeclared symbol");
-          else
-          /* already in table, so ignore location,
-             add line number of use only */
-            st_add_lineno(t->attr.name, t->lineno);
-          break;
-        case CallK:
-          if (st_lookup(t->attr.name) == -1)
-          /* not yet in table, error */
-            symbolError(t, "rule 5 - undeclared function");
-          else
-          /* already in table, so ignore location,
-             add line number of use only */
-            st_add_lineno(t->attr.name, t->lineno);
-          break;
-        default:
-          break;
-      }
-      break;
-    case DeclK:
-      switch (t->kind.decl) {
-        case FuncK:
-          funcName = t->attr.name;
-          if (strcmp(funcName, "main") == 0)
-            main_count++;
-          if (st_lookup_top(funcName) >= 0) {
-          /* already in table, so it's an error */
-            symbolError(t, "rule 7 - function already declared");
-            break;
-          }
-          st_insert(funcName, t->lineno, addLocation(), t);
-          sc_push(sc_create(funcName));
-          preserveLastScope = TRUE;
-          switch (t->child[0]->attr.type) {
-            case INT:
-              t->type = Integer;
-              break;
-            case VOID:
-            default:
-              t->type = Void;
-              break;
-          }
-          break;
-        case VarK:
-        case VectorVarK: {
-            char *name;
-
-            if (t->child[0]->attr.type == VOID) {
-              symbolError(t, "rule 3 - variable should have non-void type");
-              break;
-            }
-
-            if (t->kind.decl == VarK) {
-              name = t->attr.name;
-              t->type = Integer;
-            }
-            else {
-              name = t->attr.vector.name;
-              t->type = IntegerArray;
-            }
-
-            if (st_lookup_top(name) >= 0)
-              symbolError(t, "symbol already declared for current scope");
-            else if (st_lookup_top_func(name) >= 0)
-              symbolError(t, "function already declared with symbol name");
-            else
-              st_insert(name, t->lineno, addLocation(), t);
-          }
+        case IfK:
+        case WhileK:
+          releaseTree(tree->child[1]);
+          releaseTree(tree->child[2]);
           break;
         default:
           break;
       }
-      break;
-    case ParamK:
-      if (t->child[0]->attr.type == VOID)
-        symbolError(t->child[0], "void type parameter is not allowed");
-      if (st_lookup(t->attr.name) == -1) {
-        st_insert(t->attr.name, t->lineno, addLocation(), t);
-        if (t->kind.param == NonVectorParamK)
-          t->type = Integer;
-        else
-          symbolError(t, "rule 4 - symbol already declared for current scope");
-      }
-      break;
-    default:
-      break;
+    }
+    tree = tree->sibling;
   }
 }
 
-static void afterInsertNode( TreeNode *t ) {
-  switch (t->nodekind) {
-    case StmtK:
-      switch (t->kind.stmt) {
-        case CompK:
-          sc_pop();
-          break;
-        default:
-          break;
-      }
-      break;
-    default:
-      break;
+/* Procedure releaseScopes releases the scopes of
+ * the function declaration func, which no pass may
+ * use again
+ */
+void releaseScopes(TreeNode *func) {
+  releaseTree(func->child[2]);
+}
+
+/* diagnostics of one top-level declaration, kept
+ * until every declaration has been checked so that
+ * they are printed in source order
+ */
+typedef struct {
+  int lineno;
+  char *message;
+} Diagnostic;
+
+typedef struct {
+  TreeNode *decl;
+  Diagnostic *diags;
+  int nDiags, maxDiags;
+} CheckTask;
+
+/* the task being checked by the current thread */
+static __thread CheckTask *task = NULL;
+
+static void typeError(TreeNode *t, char *message) {
+  if (task != NULL) {
+    if (task->nDiags == task->maxDiags) {
+      task->maxDiags = task->maxDiags ? 2 * task->maxDiags : 4;
+      task->diags = (Diagnostic *)
+        realloc(task->diags, task->maxDiags * sizeof(Diagnostic));
+    }
+    task->diags[task->nDiags].lineno = t->lineno;
+    task->diags[task->nDiags].message = message;
+    task->nDiags++;
+    return;
   }
+  printError("semantic", t->lineno, message);
+  Error = TRUE;
 }
 
-/* Function buildSymtab constructs the symbol
- * table by preorder traversal of the syntax tree
+/* The handlers of the type checking pass: enterFunc
+ * and pushScope run before the children of a node,
+ * the others perform type checking at the node
+ * after them
  */
-void buildSymtab(TreeNode *syntaxTree) {
-  globalScope = sc_create(NULL);
-  sc_push(globalScope);
-  // insertIOFunc();
-  traverse(syntaxTree, insertNode, afterInsertNode);
-  sc_pop();
-  if (TraceAnalyze) {
-    fprintf(listing, "\nSymbol table:\n\n");
-    printSymTab(listing);
+static void enterFunc(TreeNode *t) {
+  funcName = t->attr.name;
+}
+
+static void pushScope(TreeNode *t) {
+  sc_push(t->attr.scope);
+}
+
+static void checkWhile(TreeNode *t) {
+  if (t->child[0]->type == Void)
+  /* while test should be void function call */
+    typeError(t->child[0], "while test has void value");
+}
+
+static void checkReturn(TreeNode *t) {
+  const TreeNode *funcDecl = st_bucket(funcName)->treeNode;
+  const ExpType funcType = funcDecl->type;
+  const TreeNode *expr = t->child[0];
+
+  if ((funcType == Void) &&
+      (expr != NULL && expr->type != Void)) {
+    typeError(t, "expected no return value");
+  }
+  else if ((funcType == Integer) &&
+           (expr == NULL || expr->type == Void)) {
+    typeError(t, "expected return value");
   }
 }
 
-static void typeError(TreeNode *t, char *message) {
-  fprintf(listing, "line %d: %s\n", t->lineno,message);
-  Error = TRUE;
+static void checkAssign(TreeNode *t) {
+  if (t->child[0]->type == IntegerArray)
+  /* no value can be assigned to array variable */
+    typeError(t->child[0], "rule 2 - assignment to array variable");
+  else if (t->child[1]->type == Void)
+  /* r-value cannot have void type */
+    typeError(t->child[0], "rule 2 - assignment of void value");
+  else
+    t->type = t->child[0]->type;
 }
 
-static void beforeCheckNode(TreeNode *t) {
-  switch (t->nodekind) {
-    case DeclK:
-      switch (t->kind.decl) {
-        case FuncK:
-          funcName = t->attr.name;
-          break;
-        default:
-          break;
-      }
-      break;
-    case StmtK:
-      switch (t->kind.stmt) {
-        case CompK:
-          sc_push(t->attr.scope);
-          break;
-        default:
-          break;
-      }
-    default:
-      break;
+static void checkOp(TreeNode *t) {
+  ExpType leftType, rightType;
+  TokenType op;
+
+  leftType = t->child[0]->type;
+  rightType = t->child[1]->type;
+  op = t->attr.op;
+
+  if (leftType == Void ||
+      rightType == Void)
+    typeError(t, "rule 2 - two operands should have non-void type");
+  else if (leftType == IntegerArray &&
+           rightType == IntegerArray)
+    typeError(t, "rule 2 - not both of operands can be array");
+  else if (op == MINUS &&
+           leftType == Integer &&
+           rightType == IntegerArray)
+    typeError(t, "rule 2 - invalid operands to binary expression");
+  else if ((op == TIMES || op == OVER) &&
+           (leftType == IntegerArray ||
+            rightType == IntegerArray))
+    typeError(t, "rule 2 - invalid operands to binary expression");
+  else
+    t->type = Integer;
+}
+
+static void checkConst(TreeNode *t) {
+  t->type = Integer;
+}
+
+static void checkId(TreeNode *t) {
+  const char *symbolName = t->attr.name;
+  const BucketList bucket = st_bucket(symbolName);
+  TreeNode *symbolDecl = NULL;
+
+  if (bucket == NULL)
+    return;
+  symbolDecl = bucket->treeNode;
+
+  if (t->kind.exp == VectorIdK) {
+    if (symbolDecl->kind.decl  != VectorVarK &&
+        symbolDecl->kind.param != VectorParamK)
+      typeError(t, "rule 2 - expected array symbol");
+    else if (t->child[0]->type != Integer)
+      typeError(t, "rule 2 - index expression should have integer type");
+    else
+      t->type = Integer;
   }
+  else
+    t->type = symbolDecl->type;
 }
 
-/* Procedure checkNode performs
- * type checking at a single tree node
- */
-static void checkNode(TreeNode *t) {
-  switch (t->nodekind) {
-    case StmtK:
-      switch (t->kind.stmt) {
-        case CompK:
-          sc_pop();
-          break;
-        case WhileK:
-          if (t->child[0]->type == Void)
-          /* while test should be void function call */
-            typeError(t->child[0], "while test has void value");
-          break;
-        case ReturnK: {
-            const TreeNode *funcDecl = st_bucket(funcName)->treeNode;
-            const ExpType funcType = funcDecl->type;
-            const TreeNode *expr = t->child[0];
-
-            if ((funcType == Void) &&
-                (expr != NULL && expr->type != Void)) {
-              typeError(t, "expected no return value");
-            }
-            else if ((funcType == Integer) &&
-                     (expr == NULL || expr->type == Void)) {
-              typeError(t, "expected return value");
-            }
-          }
-          break;
-        default:
-          break;
-      }
-      break;
-    case ExpK:
-      switch (t->kind.exp) {
-        case AssignK:
-          if (t->child[0]->type == IntegerArray)
-          /* no value can be assigned to array variable */
-            typeError(t->child[0], "rule 2 - assignment to array variable");
-          else if (t->child[1]->type == Void)
-          /* r-value cannot have void type */
-            typeError(t->child[0], "rule 2 - assignment of void value");
-          else
-            t->type = t->child[0]->type;
-          break;
-        case OpK: {
-            ExpType leftType, rightType;
-            TokenType op;
-
-            leftType = t->child[0]->type;
-            rightType = t->child[1]->type;
-            op = t->attr.op;
-
-            if (leftType == Void ||
-                rightType == Void)
-              typeError(t, "rule 2 - two operands should have non-void type");
-            else if (leftType == IntegerArray &&
-                     rightType == IntegerArray)
-              typeError(t, "rule 2 - not both of operands can be array");
-            else if (op == MINUS &&
-                     leftType == Integer &&
-                     rightType == IntegerArray)
-              typeError(t, "rule 2 - invalid operands to binary expression");
-            else if ((op == TIMES || op == OVER) &&
-                     (leftType == IntegerArray ||
-                      rightType == IntegerArray))
-              typeError(t, "rule 2 - invalid operands to binary expression");
-            else
-              t->type = Integer;
-          }
-          break;
-        case ConstK:
-          t->type = Integer;
-          break;
-        case IdK:
-        case VectorIdK: {
-            const char *symbolName = t->attr.name;
-            const BucketList bucket = st_bucket(symbolName);
-            TreeNode *symbolDecl = NULL;
-
-            if (bucket == NULL)
-              break;
-            symbolDecl = bucket->treeNode;
-
-            if (t->kind.exp == VectorIdK) {
-              if (symbolDecl->kind.decl  != VectorVarK &&
-                  symbolDecl->kind.param != VectorParamK)
-                typeError(t, "rule 2 - expected array symbol");
-              else if (t->child[0]->type != Integer)
-                typeError(t, "rule 2 - index expression should have integer type");
-              else
-                t->type = Integer;
-            }
-            else
-              t->type = symbolDecl->type;
-          }
-          break;
-        case CallK: {
-            if (st_lookup(t->attr.name) == -1){
-              typeError(t, "rule 5 - undeclared function");
-              break;
-            }
-
-            const char *callingFuncName = t->attr.name;
-            const TreeNode *funcDecl =
-                st_bucket(callingFuncName)->treeNode;
-            TreeNode *arg;
-            TreeNode *param;
-
-            if (funcDecl == NULL)
-              break;
-
-            arg = t->child[0];
-            param = funcDecl->child[1];
-
-            if (funcDecl->kind.decl != FuncK) {
-              typeError(t, "expected function symbol");
-              break;
-            }
-
-            while (arg  != NULL) {
-              if (param == NULL)
-              /* the number of arguments does not match to
-                 that of parameters */
-                typeError(arg, "the number of parameters is wrong");
-              else if (arg->type == IntegerArray &&
-                  param->type != IntegerArray)
-                typeError(arg,"expected non-array value");
-              else if (arg->type == Integer &&
-                  param->type == IntegerArray)
-                typeError(arg,"expected array value");
-              else if (arg->type == Void)
-                typeError(arg, "void value cannot be passed as an argument");
-              else {  // no problem!
-                arg = arg->sibling;
-                param = param->sibling;
-                continue;
-              }
-              /* any problem */
-              break;
-            }
-
-           if (arg == NULL && param != NULL)
-           /* the number of arguments does not match to
-              that of parameters */
-             typeError(t, "the number of parameters is wrong");
-
-            t->type = funcDecl->type;
-          }
-          break;
-        default:
-          break;
-      }
-      break;
-    default:
-      break;
+static void checkCall(TreeNode *t) {
+  if (st_lookup(t->attr.name) == -1){
+    typeError(t, "rule 5 - undeclared function");
+    return;
   }
+
+  const char *callingFuncName = t->attr.name;
+  const TreeNode *funcDecl =
+      st_bucket(callingFuncName)->treeNode;
+  TreeNode *arg;
+  TreeNode *param;
+
+  if (funcDecl == NULL)
+    return;
+
+  arg = t->child[0];
+  param = funcDecl->child[1];
+
+  if (funcDecl->kind.decl != FuncK) {
+    typeError(t, "expected function symbol");
+    return;
+  }
+
+  while (arg  != NULL) {
+    if (param == NULL)
+    /* the number of arguments does not match to
+       that of parameters */
+      typeError(arg, "the number of parameters is wrong");
+    else if (arg->type == IntegerArray &&
+        param->type != IntegerArray)
+      typeError(arg,"expected non-array value");
+    else if (arg->type == Integer &&
+        param->type == IntegerArray)
+      typeError(arg,"expected array value");
+    else if (arg->type == Void)
+      typeError(arg, "void value cannot be passed as an argument");
+    else {  // no problem!
+      arg = arg->sibling;
+      param = param->sibling;
+      continue;
+    }
+    /* any problem */
+    break;
+  }
+
+ if (arg == NULL && param != NULL)
+ /* the number of arguments does not match to
+    that of parameters */
+   typeError(t, "the number of parameters is wrong");
+
+  t->type = funcDecl->type;
 }
 
-/* Procedure typeCheck performs type checking
- * by a postorder syntax tree traversal
+#define CHECK_PRE(X)                        \
+  X(DeclK, FuncK,     enterFunc)            \
+  X(StmtK, CompK,     pushScope)
+
+#define CHECK_POST(X)                       \
+  X(StmtK, CompK,     popScope)             \
+  X(StmtK, WhileK,    checkWhile)           \
+  X(StmtK, ReturnK,   checkReturn)          \
+  X(ExpK,  AssignK,   checkAssign)          \
+  X(ExpK,  OpK,       checkOp)              \
+  X(ExpK,  ConstK,    checkConst)           \
+  X(ExpK,  IdK,       checkId)              \
+  X(ExpK,  VectorIdK, checkId)              \
+  X(ExpK,  CallK,     checkCall)
+
+DEFINE_VISITOR(checkTree, CHECK_PRE, CHECK_POST)
+
+/* Procedure checkDecl type checks the top-level
+ * declaration of task i; it only reads the symbol
+ * table and writes the types of its own subtree,
+ * so declarations may be checked concurrently
  */
-void typeCheck(TreeNode *syntaxTree) {
+static void checkDecl(int i, void *arg) {
+  CheckTask *t = &((CheckTask *) arg)[i];
+  TreeNode *decl = t->decl;
+
+  if (Prune == PruneCheck && decl->nodekind == DeclK &&
+      decl->kind.decl == FuncK && !cg_reachable(decl))
+    return;
+  task = t;
   sc_push(globalScope);
-  traverse(syntaxTree, beforeCheckNode, checkNode);
+  checkTreeNode(decl);
   sc_pop();
-  if (main_count == 0)
+  task = NULL;
+}
+
+/* Procedure checkDecls type checks the list of
+ * top-level declarations on Jobs threads and
+ * prints their diagnostics in order
+ */
+void checkDecls(TreeNode *syntaxTree) {
+  CheckTask *tasks;
+  TreeNode *t;
+  int n = 0, i, j;
+
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    ++n;
+  tasks = (CheckTask *) calloc(n > 0 ? n : 1, sizeof(CheckTask));
+  for (t = syntaxTree, i = 0; t != NULL; t = t->sibling, ++i)
+    tasks[i].decl = t;
+
+  parallelFor(n, Jobs, checkDecl, tasks);
+
+  for (i = 0; i < n; ++i) {
+    for (j = 0; j < tasks[i].nDiags; ++j)
+      printError("semantic", tasks[i].diags[j].lineno, tasks[i].diags[j].message);
+    if (tasks[i].nDiags > 0)
+      Error = TRUE;
+    free(tasks[i].diags);
+  }
+  free(tasks);
+}
+
+/* Procedure checkMain reports a program without
+ * a main function at its first declaration; a
+ * module may leave main to another one
+ */
+void checkMain(TreeNode *syntaxTree) {
+  if (main_count == 0 && !Module)
     typeError(syntaxTree, "rule 6 - main function not declared");
-}
\ No newline at end of file
+}
+
+/* Procedure typeCheck performs type checking
+ * by a postorder syntax tree traversal; the
+ * top-level declarations are checked on Jobs
+ * threads and their diagnostics merged in order
+ */
+void typeCheck(TreeNode *syntaxTree) {
+  checkDecls(syntaxTree);
+  checkMain(syntaxTree);
+}
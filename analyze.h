@@ -12,9 +12,34 @@
  */
 void buildSymtab(TreeNode *);
 
+/* buildSymtab in steps, for a program given one
+ * top-level declaration at a time: beginSymtab
+ * opens the global scope, insertDecl inserts the
+ * declaration decl and endSymtab closes the scope
+ */
+void beginSymtab(void);
+void insertDecl(TreeNode *decl);
+void endSymtab(void);
+
+/* Procedure releaseScopes releases the scopes of
+ * the function declaration func, which no pass may
+ * use again (see st_release)
+ */
+void releaseScopes(TreeNode *func);
+
 /* Procedure typeCheck performs type checking
- * by a postorder syntax tree traversal
+ * by a postorder syntax tree traversal; with
+ * Jobs > 1 the top-level declarations are checked
+ * concurrently
  */
 void typeCheck(TreeNode *);
 
+/* typeCheck in steps: checkDecls checks a list of
+ * top-level declarations and checkMain reports a
+ * program without main at its first declaration,
+ * unless it is a Module
+ */
+void checkDecls(TreeNode *);
+void checkMain(TreeNode *);
+
 #endif
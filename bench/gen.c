@@ -0,0 +1,202 @@
+/****************************************************/
+/* File: gen.c                                      */
+/* Synthetic workload generator for the C-          */
+/* compiler: writes a valid C- program of the       */
+/* requested shape to stdout. The programs are      */
+/* meant to be compiled, not run                    */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* shape of the generated program */
+static int nFuncs    = 10;   /* -f: functions besides main */
+static int nStmts    = 10;   /* -s: statements per block */
+static int depth     = 2;    /* -d: nesting of {} blocks per function */
+static int nArgs     = 2;    /* -a: parameters per function */
+static int nIdents   = 10;   /* -i: distinct global identifiers */
+static int nComments = 0;    /* -c: comment lines before each function */
+static unsigned long seed = 1; /* -r: seed of the statement mix */
+
+/* Function rnd returns a pseudo-random number in
+ * [0, n); the generator is fixed so that the same
+ * options always give the same program
+ */
+static int rnd(int n) {
+  seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+  return (int) ((seed >> 33) % n);
+}
+
+/* Function ident returns the C- identifier for
+ * number n with the given prefix; identifiers are
+ * letters only, so n is written in base 26. The
+ * result lives in one of NIDBUF rotating buffers
+ */
+#define NIDBUF 4
+static const char *ident(const char *prefix, int n) {
+  static char buf[NIDBUF][32];
+  static int next = 0;
+  char digits[16];
+  int len = 0;
+  char *start = buf[next];
+  char *id = start;
+
+  next = (next + 1) % NIDBUF;
+  do {
+    digits[len++] = 'a' + n % 26;
+    n /= 26;
+  } while (n > 0);
+  strcpy(id, prefix);
+  id += strlen(prefix);
+  while (len > 0)
+    *id++ = digits[--len];
+  *id = '\0';
+  return start;
+}
+
+static void indent(int level) {
+  int i;
+  for (i = 0; i < level; ++i)
+    printf("  ");
+}
+
+static void comment(void) {
+  int i;
+  if (nComments == 0)
+    return;
+  printf("/*\n");
+  for (i = 0; i < nComments; ++i)
+    printf(" * comment line %d of a large block that the scanner skips\n", i);
+  printf(" */\n");
+}
+
+/* Procedure genArgs prints an argument list of
+ * nArgs expressions over the local variable v
+ */
+static void genArgs(const char *v) {
+  int i;
+  printf("(");
+  for (i = 0; i < nArgs; ++i)
+    printf("%s%s + %d", i ? ", " : "", v, i);
+  printf(")");
+}
+
+/* Procedure genStmt prints one statement of
+ * function f at nesting level; v is the innermost
+ * local variable
+ */
+static void genStmt(int f, int level, const char *v) {
+  indent(level);
+  switch (rnd(5)) {
+    case 0:
+      printf("%s = %s + %s * %d;\n", v, v, ident("gl", rnd(nIdents)), rnd(100));
+      break;
+    case 1:
+      printf("%s = %s - (%s / 3);\n", ident("gl", rnd(nIdents)), v, v);
+      break;
+    case 2:
+      printf("if (%s < %d) %s = %s + 1; else %s = %s - 1;\n",
+             v, rnd(1000), v, v, v, v);
+      break;
+    case 3:
+      printf("while (%s > %d) %s = %s / 2;\n", v, 1000 + rnd(1000), v, v);
+      break;
+    default:
+      if (f > 0) {
+        printf("%s = %s", v, ident("fn", rnd(f)));
+        genArgs(v);
+        printf(";\n");
+      }
+      else
+        printf("%s = %s * 2;\n", v, v);
+      break;
+  }
+}
+
+/* Procedure genBlock prints the nested blocks of
+ * function f from level down to depth
+ */
+static void genBlock(int f, int level) {
+  char v[32];
+  int i;
+
+  strcpy(v, ident("lv", level));
+  indent(level);
+  printf("{\n");
+  indent(level + 1);
+  printf("int %s;\n", v);
+  indent(level + 1);
+  printf("%s = %s;\n", v, level > 1 ? "x" : "paa");
+  for (i = 0; i < nStmts; ++i)
+    genStmt(f, level + 1, v);
+  if (level < depth)
+    genBlock(f, level + 1);
+  indent(level + 1);
+  printf("x = x + %s;\n", v);
+  indent(level);
+  printf("}\n");
+}
+
+static void genFunc(int f) {
+  int i;
+
+  comment();
+  printf("int %s(", ident("fn", f));
+  for (i = 0; i < nArgs; ++i)
+    printf("%sint %s", i ? ", " : "", ident("pa", i));
+  printf(")\n{\n  int x;\n  x = paa;\n");
+  if (depth > 0)
+    genBlock(f, 1);
+  printf("  return x;\n}\n\n");
+}
+
+static void usage(char *prog) {
+  fprintf(stderr, "usage: %s [-f funcs] [-s stmts] [-d depth] [-a args]\n"
+                  "          [-i idents] [-c comment lines] [-r seed]\n", prog);
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  int i, val;
+
+  for (i = 1; i < argc; i += 2) {
+    if (i + 1 >= argc || strlen(argv[i]) != 2 || argv[i][0] != '-')
+      usage(argv[0]);
+    val = atoi(argv[i + 1]);
+    switch (argv[i][1]) {
+      case 'f': nFuncs = val; break;
+      case 's': nStmts = val; break;
+      case 'd': depth = val; break;
+      case 'a': nArgs = val; break;
+      case 'i': nIdents = val; break;
+      case 'c': nComments = val; break;
+      case 'r': seed = val; break;
+      default:  usage(argv[0]);
+    }
+  }
+  if (nArgs < 1)
+    nArgs = 1;
+  if (nIdents < 1)
+    nIdents = 1;
+
+  printf("/* generated by bench/gen");
+  for (i = 1; i < argc; ++i)
+    printf(" %s", argv[i]);
+  printf(" */\n\n");
+  for (i = 0; i < nIdents; ++i)
+    printf("int %s;\n", ident("gl", i));
+  printf("\n");
+  for (i = 0; i < nFuncs; ++i)
+    genFunc(i);
+
+  printf("void main(void)\n{\n  int r;\n  r = 0;\n");
+  if (nFuncs > 0) {
+    printf("  r = %s", ident("fn", nFuncs - 1));
+    genArgs("r");
+    printf(";\n");
+  }
+  printf("}\n");
+  return 0;
+}
@@ -0,0 +1,29 @@
+#!/bin/sh
+# Checks that the loop programs of bench print the
+# same numbers with every loop transformation on,
+# with each of them off and as C built by gcc. Each
+# program names its expected output on a line
+# "expect: ..." of its header comment. Run from the
+# project root after make.
+
+set -e
+
+status=0
+for prog in ivstore; do
+  expect=$(sed -n 's/^ *expect: //p' bench/$prog.cminus)
+  ./cminus --target=c bench/$prog.cminus > /dev/null
+  gcc -O2 -o bench/$prog-c bench/$prog.c runtime/libcminus_rt.a
+  for opts in "" --no-strength-reduce --unroll=1 --bounds-check c; do
+    if [ "$opts" = c ]; then
+      got=$(./bench/$prog-c | tr '\n' ' ')
+    else
+      got=$(./cminus --jit $opts bench/$prog.cminus | grep -x -- '-\{0,1\}[0-9][0-9]*' | tr '\n' ' ')
+    fi
+    if [ "$got" != "$expect " ]; then
+      echo "$prog ${opts:-default}: got $got, expected $expect"
+      status=1
+    fi
+  done
+done
+[ $status = 0 ] && echo "loops: ok"
+exit $status
@@ -0,0 +1,29 @@
+#!/bin/sh
+# Times the benchmark programs compiled by the native
+# x86-64 backend, run in-process by the JIT (the JIT
+# column includes compilation), and written as C by
+# --target=c and built with gcc -O2. Run from the
+# project root after make.
+
+set -e
+
+now() {
+  date +%s.%N
+}
+
+printf "%-12s %12s %12s %12s\n" "program" "x86-64 (s)" "jit (s)" "c (s)"
+for prog in gdc arrays; do
+  ./cminus --target=x86-64 bench/$prog.cminus > /dev/null
+  gcc -o bench/$prog bench/$prog.s runtime/libcminus_rt.a
+  ./cminus --target=c bench/$prog.cminus > /dev/null
+  gcc -O2 -o bench/$prog-c bench/$prog.c runtime/libcminus_rt.a
+  start=$(now)
+  ./bench/$prog > /dev/null
+  native=$(now)
+  ./cminus --jit bench/$prog.cminus > /dev/null
+  jit=$(now)
+  ./bench/$prog-c > /dev/null
+  c=$(now)
+  awk -v p=$prog -v s=$start -v n=$native -v j=$jit -v c=$c \
+    'BEGIN { printf "%-12s %12.3f %12.3f %12.3f\n", p, n - s, j - n, c - j }'
+done
@@ -0,0 +1,64 @@
+#!/bin/sh
+# Times the parse phase of the compiler built with the
+# Bison parser against the one built with the
+# recursive-descent parser of rdparse.c (-DRD_PARSER),
+# on synthetic programs made by bench/gen; the parse
+# phase includes the scanner. Then compares the code
+# size of both binaries. Run from the project root
+# after make parser tokenizer.
+
+set -e
+
+RUNS=${RUNS:-5}
+WORK=bench/work
+
+# name and bench/gen options of each workload
+WORKLOADS="
+funcs:-f 2000 -s 20
+stmts:-f 20 -s 5000
+nesting:-f 20 -d 300 -s 2
+args:-f 1000 -a 150 -s 5
+"
+
+mkdir -p $WORK
+gcc -O2 -o bench/gen bench/gen.c
+for p in bison rd; do
+  flags=
+  [ $p = rd ] && flags=-DRD_PARSER
+  gcc -O2 $flags -o $WORK/cminus-$p *.c runtime/cminus_rt.c \
+    -lfl -lpthread -fno-builtin-exp -Wno-implicit-function-declaration
+done
+
+# prints the fastest parse phase, in CPU ms, of RUNS
+# compilations of file by compiler
+parseTime() {
+  i=0
+  while [ $i -lt $RUNS ]; do
+    $1 --stats-json=$WORK/parser.json $2 > /dev/null
+    grep -o '"parse": {"wall_ms": [0-9.]*, "cpu_ms": [0-9.]*}' $WORK/parser.json |
+      sed 's/.*"cpu_ms": \([0-9.]*\)}/\1/'
+    i=$((i + 1))
+  done | sort -n | head -1
+}
+
+printf "%-10s %12s %12s %8s\n" "workload" "bison (ms)" "rd (ms)" "change"
+echo "$WORKLOADS" | while IFS=: read name opts; do
+  [ -z "$name" ] && continue
+  ./bench/gen $opts > $WORK/$name.cminus
+  bison=$(parseTime $WORK/cminus-bison $WORK/$name.cminus)
+  rd=$(parseTime $WORK/cminus-rd $WORK/$name.cminus)
+  awk -v n=$name -v b=$bison -v r=$rd \
+    'BEGIN { printf "%-10s %12.3f %12.3f %+7.1f%%\n", n, b, r, 100 * (r - b) / b }'
+done
+
+# the text segment of each binary, in KB
+textSize() {
+  size $1 | awk 'NR == 2 { print $1 / 1024 }'
+}
+
+bison=$(textSize $WORK/cminus-bison)
+rd=$(textSize $WORK/cminus-rd)
+echo
+printf "%-10s %12s %12s %8s\n" "binary" "bison (KB)" "rd (KB)" "change"
+awk -v b=$bison -v r=$rd \
+  'BEGIN { printf "%-10s %12.3f %12.3f %+7.1f%%\n", "text", b, r, 100 * (r - b) / b }'
@@ -0,0 +1,97 @@
+#!/bin/sh
+# Times each compiler phase on synthetic programs made
+# by bench/gen and compares the CPU times with the
+# baseline file. The baseline is written on the first
+# run, or when UPDATE=1. A phase that grows more than
+# THRESHOLD percent (and more than NOISE ms) over its
+# baseline is reported as a regression, and the script
+# exits with status 1. Run from the project root after
+# make.
+
+set -e
+
+BASELINE=${BASELINE:-bench/baseline.txt}
+THRESHOLD=${THRESHOLD:-20}
+NOISE=${NOISE:-1}
+RUNS=${RUNS:-3}
+WORK=bench/work
+
+# name and bench/gen options of each workload
+WORKLOADS="
+funcs:-f 300 -s 10
+stmts:-f 4 -s 2000
+nesting:-f 2 -d 300 -s 2
+args:-f 200 -a 150 -s 5
+idents:-f 20 -i 20000
+comments:-f 20 -c 20000
+"
+
+mkdir -p $WORK
+gcc -O2 -o bench/gen bench/gen.c
+
+if [ "$UPDATE" = 1 ] || [ ! -f $BASELINE ]; then
+  update=1
+  : > $BASELINE.new
+else
+  update=0
+fi
+
+printf "%-10s %-10s %12s %12s %8s\n" "workload" "phase" "cpu (ms)" "base (ms)" "change"
+echo "$WORKLOADS" | while IFS=: read name opts; do
+  [ -z "$name" ] && continue
+  ./bench/gen $opts > $WORK/$name.cminus
+  # keep the fastest of RUNS compilations of each phase
+  i=0
+  : > $WORK/$name.times
+  while [ $i -lt $RUNS ]; do
+    ./cminus --target=x86-64 --stats-json=$WORK/$name.json $WORK/$name.cminus > /dev/null
+    grep -o '"[a-z]*": {"wall_ms": [0-9.]*, "cpu_ms": [0-9.]*}' $WORK/$name.json |
+      sed 's/"\([a-z]*\)": {"wall_ms": [0-9.]*, "cpu_ms": \([0-9.]*\)}/\1 \2/' \
+      >> $WORK/$name.times
+    i=$((i + 1))
+  done
+  awk -v name=$name -v base=$BASELINE -v update=$update \
+      -v threshold=$THRESHOLD -v noise=$NOISE '
+    BEGIN {
+      if (!update)
+        while ((getline line < base) > 0) {
+          split(line, f, " ")
+          old[f[1] " " f[2]] = f[3]
+        }
+    }
+    !($1 in best) || $2 < best[$1] { if (!($1 in best)) order[n++] = $1; best[$1] = $2 }
+    END {
+      bad = 0
+      for (i = 0; i < n; ++i) {
+        p = order[i]
+        key = name " " p
+        if (update) {
+          printf "%s %.3f\n", key, best[p] >> (base ".new")
+          printf "%-10s %-10s %12.3f %12s %8s\n", name, p, best[p], "-", "-"
+        }
+        else if (key in old) {
+          change = old[key] > 0 ? 100 * (best[p] - old[key]) / old[key] : 0
+          flag = ""
+          if (change > threshold && best[p] - old[key] > noise) {
+            flag = "  REGRESSION"
+            bad = 1
+          }
+          printf "%-10s %-10s %12.3f %12.3f %+7.1f%%%s\n",
+                 name, p, best[p], old[key], change, flag
+        }
+        else
+          printf "%-10s %-10s %12.3f %12s %8s\n", name, p, best[p], "-", "new"
+      }
+      exit bad
+    }' $WORK/$name.times || echo regression >> $WORK/status
+done
+
+if [ $update = 1 ]; then
+  mv $BASELINE.new $BASELINE
+  echo "baseline written to $BASELINE"
+fi
+if [ -f $WORK/status ]; then
+  rm -f $WORK/status
+  echo "phases slower than the baseline by more than $THRESHOLD%"
+  exit 1
+fi
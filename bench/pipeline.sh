@@ -0,0 +1,48 @@
+#!/bin/sh
+# Times the parse phase of the compiler, scanner
+# included, with and without --pipeline on large
+# synthetic programs made by bench/gen. The times are
+# wall clock, since with --pipeline the scanner runs
+# on a second processor. Run from the project root
+# after make parser tokenizer.
+
+set -e
+
+RUNS=${RUNS:-5}
+WORK=bench/work
+
+# name and bench/gen options of each workload
+WORKLOADS="
+funcs:-f 4000 -s 20
+args:-f 2000 -a 150 -s 5
+comments:-f 10 -c 20000
+"
+
+mkdir -p $WORK
+gcc -O2 -o bench/gen bench/gen.c
+gcc -O2 -o $WORK/cminus-pipeline *.c runtime/cminus_rt.c \
+  -lfl -lpthread -fno-builtin-exp -Wno-implicit-function-declaration
+
+# prints the fastest parse phase, in wall ms, of
+# RUNS compilations of file with the options given
+parseTime() {
+  file=$1
+  shift
+  i=0
+  while [ $i -lt $RUNS ]; do
+    $WORK/cminus-pipeline "$@" --stats-json=$WORK/pipeline.json $file > /dev/null
+    grep -o '"parse": {"wall_ms": [0-9.]*' $WORK/pipeline.json |
+      sed 's/.*"wall_ms": //'
+    i=$((i + 1))
+  done | sort -n | head -1
+}
+
+printf "%-10s %12s %14s %8s\n" "workload" "plain (ms)" "pipeline (ms)" "change"
+echo "$WORKLOADS" | while IFS=: read name opts; do
+  [ -z "$name" ] && continue
+  ./bench/gen $opts > $WORK/$name.cminus
+  plain=$(parseTime $WORK/$name.cminus)
+  piped=$(parseTime $WORK/$name.cminus --pipeline)
+  awk -v n=$name -v b=$plain -v p=$piped \
+    'BEGIN { printf "%-10s %12.3f %14.3f %+7.1f%%\n", n, b, p, 100 * (p - b) / b }'
+done
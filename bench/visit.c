@@ -0,0 +1,195 @@
+/****************************************************/
+/* File: visit.c                                    */
+/* Benchmark of the syntax tree visitors of         */
+/* visit.h against the function pointer traverse    */
+/* they replaced, on a tree of a million nodes      */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include <time.h>
+#include "globals.h"
+#include "visit.h"
+
+/* the tree is NSTMTS statements, alternately
+ * x = x + y * 3 (7 nodes) and x = v[x] (4 nodes),
+ * in blocks of BLOCK statements
+ */
+#define NSTMTS 200000
+#define BLOCK 100
+#define ROUNDS 20
+
+/* work done by the handlers, so that the passes
+ * cannot be optimised away
+ */
+static long nIds, nOps, nAssigns, nBlocks;
+
+static TreeNode *node(NodeKind nodekind, int kind) {
+  TreeNode *t = (TreeNode *) calloc(1, sizeof(TreeNode));
+  t->nodekind = nodekind;
+  t->kind.exp = (ExpKind) kind;
+  return t;
+}
+
+static TreeNode *id(char *name) {
+  TreeNode *t = node(ExpK, IdK);
+  t->attr.name = name;
+  return t;
+}
+
+static TreeNode *buildTree(void) {
+  TreeNode *first = NULL, *block = NULL, *last = NULL, *prev = NULL;
+  TreeNode *s, *e;
+  int i;
+
+  for (i = 0; i < NSTMTS; ++i) {
+    s = node(ExpK, AssignK);
+    s->child[0] = id("x");
+    if (i % 2 == 0) {
+      e = node(ExpK, OpK);
+      e->attr.op = PLUS;
+      e->child[0] = id("x");
+      e->child[1] = node(ExpK, OpK);
+      e->child[1]->attr.op = TIMES;
+      e->child[1]->child[0] = id("y");
+      e->child[1]->child[1] = node(ExpK, ConstK);
+    }
+    else {
+      e = node(ExpK, VectorIdK);
+      e->attr.name = "v";
+      e->child[0] = id("x");
+    }
+    s->child[1] = e;
+    if (i % BLOCK == 0) {
+      block = node(StmtK, CompK);
+      block->child[1] = s;
+      if (last != NULL)
+        last->sibling = block;
+      else
+        first = block;
+      last = block;
+    }
+    else
+      prev->sibling = s;
+    prev = s;
+  }
+  return first;
+}
+
+/* the traversal of analyze.c before visit.h: two
+ * indirect calls per node, each switching again on
+ * the node and its kind
+ */
+static void traverse(TreeNode *t,
+                     void (*preProc) (TreeNode *),
+                     void (*postProc) (TreeNode *)) {
+  if (t != NULL) {
+    int i;
+    preProc(t);
+    for (i = 0; i < MAXCHILDREN; i++)
+      traverse(t->child[i], preProc, postProc);
+    postProc(t);
+    traverse(t->sibling, preProc, postProc);
+  }
+}
+
+static void preNode(TreeNode *t) {
+  switch (t->nodekind) {
+    case StmtK:
+      switch (t->kind.stmt) {
+        case CompK:
+          nBlocks++;
+          break;
+        default:
+          break;
+      }
+      break;
+    case ExpK:
+      switch (t->kind.exp) {
+        case IdK:
+        case VectorIdK:
+          nIds++;
+          break;
+        default:
+          break;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+static void postNode(TreeNode *t) {
+  switch (t->nodekind) {
+    case ExpK:
+      switch (t->kind.exp) {
+        case AssignK:
+          nAssigns++;
+          break;
+        case OpK:
+          nOps++;
+          break;
+        default:
+          break;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+/* the same pass as a visitor */
+static void countBlock(TreeNode *t) { nBlocks++; }
+static void countId(TreeNode *t) { nIds++; }
+static void countAssign(TreeNode *t) { nAssigns++; }
+static void countOp(TreeNode *t) { nOps++; }
+
+#define COUNT_PRE(X)                \
+  X(StmtK, CompK,     countBlock)   \
+  X(ExpK,  IdK,       countId)      \
+  X(ExpK,  VectorIdK, countId)
+
+#define COUNT_POST(X)               \
+  X(ExpK,  AssignK,   countAssign)  \
+  X(ExpK,  OpK,       countOp)
+
+DEFINE_VISITOR(countTree, COUNT_PRE, COUNT_POST)
+
+static double seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static long counts(void) {
+  long n = nIds + nOps + nAssigns + nBlocks;
+  nIds = nOps = nAssigns = nBlocks = 0;
+  return n;
+}
+
+int main(void) {
+  TreeNode *tree = buildTree();
+  double start, tTraverse, tVisit;
+  long cTraverse, cVisit;
+  int r;
+
+  start = seconds();
+  for (r = 0; r < ROUNDS; ++r)
+    traverse(tree, preNode, postNode);
+  tTraverse = (seconds() - start) / ROUNDS;
+  cTraverse = counts();
+
+  start = seconds();
+  for (r = 0; r < ROUNDS; ++r)
+    countTree(tree);
+  tVisit = (seconds() - start) / ROUNDS;
+  cVisit = counts();
+
+  if (cTraverse != cVisit) {
+    fprintf(stderr, "visit: the passes disagree (%ld, %ld)\n", cTraverse, cVisit);
+    return 1;
+  }
+  printf("%d nodes, mean of %d passes\n", NSTMTS / 2 * 11 + NSTMTS / BLOCK, ROUNDS);
+  printf("traverse  %8.2f ms\n", tTraverse * 1e3);
+  printf("visitor   %8.2f ms  (%.2fx)\n", tVisit * 1e3, tTraverse / tVisit);
+  return 0;
+}
@@ -0,0 +1,642 @@
+/****************************************************/
+/* File: bounds.c                                   */
+/* Array bounds analysis for the C- compiler:       */
+/* interval analysis of the integer variables of    */
+/* each function, with widening at while loops      */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "util.h"
+#include "callgraph.h"
+#include "bounds.h"
+
+#define INTMIN (-2147483647L - 1)
+#define INTMAX 2147483647L
+
+/* loops nested deeper than MAXLOOPDEPTH are not
+ * iterated to a fixpoint: the variables they assign
+ * are simply assumed to take any value
+ */
+#define MAXLOOPDEPTH 3
+
+/* joins before a loop head is widened */
+#define WIDENAFTER 1
+
+/* the range [lo, hi] of an integer value */
+typedef struct {
+  long lo, hi;
+} Interval;
+
+/* abstract state: the range of every variable
+ * of the current function, or unreachable
+ */
+typedef struct {
+  int bottom;
+  Interval *var;
+} State;
+
+static const Interval top = { INTMIN, INTMAX };
+
+/* variables of the current function; ids index
+ * State.var and are found by bucket address
+ */
+static BucketList *varBucket;
+static int *varId;
+static int nVars, varCap;
+
+/* marking is TRUE during the final pass over a
+ * statement, when the states are a fixpoint and the
+ * array accesses can be classified
+ */
+static int marking;
+static int loopDepth;
+
+static int nAccesses, nProven;
+
+static void boundsError(TreeNode *t, char *message) {
+  printError("bounds", t->lineno, message);
+  Error = TRUE;
+}
+
+/**************************************************/
+/*************   variables and states   ***********/
+/**************************************************/
+
+static int varSlot(BucketList l) {
+  unsigned long h = ((unsigned long) l >> 4) % varCap;
+  while (varBucket[h] != NULL && varBucket[h] != l)
+    h = (h + 1) % varCap;
+  return h;
+}
+
+/* Function varOf returns the id of the local
+ * integer variable l, or -1 for other symbols
+ */
+static int varOf(BucketList l) {
+  int h;
+  if (l == NULL || varCap == 0)
+    return -1;
+  h = varSlot(l);
+  return varBucket[h] == NULL ? -1 : varId[h];
+}
+
+static void addVar(TreeNode *decl) {
+  BucketList l;
+  int h;
+
+  if (!((decl->nodekind == DeclK && decl->kind.decl == VarK) ||
+        (decl->nodekind == ParamK && decl->kind.param == NonVectorParamK)))
+    return;
+  l = st_bucket(decl->attr.name);
+  h = varSlot(l);
+  if (varBucket[h] == NULL) {
+    varBucket[h] = l;
+    varId[h] = nVars++;
+  }
+}
+
+static int countDecls(TreeNode *tree) {
+  int n = 0;
+  int i;
+  for (; tree != NULL; tree = tree->sibling) {
+    if (tree->nodekind == DeclK || tree->nodekind == ParamK)
+      ++n;
+    for (i = 0; i < MAXCHILDREN; ++i)
+      n += countDecls(tree->child[i]);
+  }
+  return n;
+}
+
+/* Procedure collectVars numbers the integer variables
+ * declared in the compound statements of tree
+ */
+static void collectVars(TreeNode *tree) {
+  TreeNode *t;
+  for (; tree != NULL; tree = tree->sibling) {
+    if (tree->nodekind != StmtK)
+      continue;
+    switch (tree->kind.stmt) {
+      case CompK:
+        sc_push(tree->attr.scope);
+        for (t = tree->child[0]; t != NULL; t = t->sibling)
+          addVar(t);
+        collectVars(tree->child[1]);
+        sc_pop();
+        break;
+      case IfK:
+      case WhileK:
+        collectVars(tree->child[1]);
+        collectVars(tree->child[2]);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+static State *newState(void) {
+  State *s = (State *) malloc(sizeof(State));
+  int i;
+  s->bottom = FALSE;
+  s->var = (Interval *) malloc((nVars ? nVars : 1) * sizeof(Interval));
+  for (i = 0; i < nVars; ++i)
+    s->var[i] = top;
+  return s;
+}
+
+static State *copyState(State *s) {
+  State *c = newState();
+  c->bottom = s->bottom;
+  memcpy(c->var, s->var, nVars * sizeof(Interval));
+  return c;
+}
+
+static void assignState(State *dst, State *src) {
+  dst->bottom = src->bottom;
+  memcpy(dst->var, src->var, nVars * sizeof(Interval));
+}
+
+static void freeState(State *s) {
+  free(s->var);
+  free(s);
+}
+
+/* Procedure joinState makes a the smallest state
+ * that covers both a and b
+ */
+static void joinState(State *a, State *b) {
+  int i;
+  if (b->bottom)
+    return;
+  if (a->bottom) {
+    assignState(a, b);
+    return;
+  }
+  for (i = 0; i < nVars; ++i) {
+    if (b->var[i].lo < a->var[i].lo)
+      a->var[i].lo = b->var[i].lo;
+    if (b->var[i].hi > a->var[i].hi)
+      a->var[i].hi = b->var[i].hi;
+  }
+}
+
+/* Procedure widenState joins b into a, pushing every
+ * bound that still grows to the limit of its type
+ */
+static void widenState(State *a, State *b) {
+  int i;
+  if (b->bottom)
+    return;
+  if (a->bottom) {
+    assignState(a, b);
+    return;
+  }
+  for (i = 0; i < nVars; ++i) {
+    if (b->var[i].lo < a->var[i].lo)
+      a->var[i].lo = INTMIN;
+    if (b->var[i].hi > a->var[i].hi)
+      a->var[i].hi = INTMAX;
+  }
+}
+
+/* Function leqState tells whether a is covered by b */
+static int leqState(State *a, State *b) {
+  int i;
+  if (a->bottom)
+    return TRUE;
+  if (b->bottom)
+    return FALSE;
+  for (i = 0; i < nVars; ++i)
+    if (a->var[i].lo < b->var[i].lo || a->var[i].hi > b->var[i].hi)
+      return FALSE;
+  return TRUE;
+}
+
+/**************************************************/
+/*************   interval arithmetic   ************/
+/**************************************************/
+
+static Interval range(long lo, long hi) {
+  Interval r;
+  if (lo < INTMIN || hi > INTMAX)
+    return top;
+  r.lo = lo;
+  r.hi = hi;
+  return r;
+}
+
+static long min4(long a, long b, long c, long d) {
+  long m = a;
+  if (b < m) m = b;
+  if (c < m) m = c;
+  if (d < m) m = d;
+  return m;
+}
+
+static long max4(long a, long b, long c, long d) {
+  long m = a;
+  if (b > m) m = b;
+  if (c > m) m = c;
+  if (d > m) m = d;
+  return m;
+}
+
+static Interval arith(TokenType op, Interval a, Interval b) {
+  switch (op) {
+    case PLUS:
+      return range(a.lo + b.lo, a.hi + b.hi);
+    case MINUS:
+      return range(a.lo - b.hi, a.hi - b.lo);
+    case TIMES:
+      return range(min4(a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi),
+                   max4(a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi));
+    case OVER:
+      if (b.lo <= 0 && b.hi >= 0)
+        return top;
+      return range(min4(a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi),
+                   max4(a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi));
+    default: /* relational operators */
+      return range(0, 1);
+  }
+}
+
+/**************************************************/
+/*************   abstract evaluation   ************/
+/**************************************************/
+
+/* Procedure checkIndex classifies the array access
+ * tree whose index lies in idx
+ */
+static void checkIndex(TreeNode *tree, Interval idx) {
+  TreeNode *decl = st_bucket(tree->attr.name)->treeNode;
+  int size;
+
+  if (!marking)
+    return;
+  ++nAccesses;
+  if (decl->nodekind != DeclK || decl->kind.decl != VectorVarK)
+    return;
+  size = decl->attr.vector.size;
+  if (idx.lo >= 0 && idx.hi < size) {
+    tree->inBounds = TRUE;
+    ++nProven;
+  }
+  else if (idx.lo == idx.hi)
+    boundsError(tree, "array index out of bounds");
+}
+
+static Interval evalExp(TreeNode *tree, State *s) {
+  Interval a, b;
+  TreeNode *arg;
+  int id;
+
+  switch (tree->kind.exp) {
+    case ConstK:
+      return range(tree->attr.val, tree->attr.val);
+    case IdK:
+      id = varOf(st_bucket(tree->attr.name));
+      return id < 0 ? top : s->var[id];
+    case VectorIdK:
+      checkIndex(tree, evalExp(tree->child[0], s));
+      return top;
+    case AssignK:
+      if (tree->child[0]->kind.exp == VectorIdK) {
+        checkIndex(tree->child[0], evalExp(tree->child[0]->child[0], s));
+        return evalExp(tree->child[1], s);
+      }
+      a = evalExp(tree->child[1], s);
+      id = varOf(st_bucket(tree->child[0]->attr.name));
+      if (id >= 0)
+        s->var[id] = a;
+      return a;
+    case OpK:
+      a = evalExp(tree->child[0], s);
+      b = evalExp(tree->child[1], s);
+      return arith(tree->attr.op, a, b);
+    case CallK:
+      for (arg = tree->child[0]; arg != NULL; arg = arg->sibling)
+        evalExp(arg, s);
+      return top;
+    default:
+      return top;
+  }
+}
+
+static int hasAssign(TreeNode *tree) {
+  int i;
+  if (tree == NULL)
+    return FALSE;
+  if (tree->nodekind == ExpK && tree->kind.exp == AssignK)
+    return TRUE;
+  for (i = 0; i < MAXCHILDREN; ++i)
+    if (hasAssign(tree->child[i]))
+      return TRUE;
+  return FALSE;
+}
+
+static TokenType mirror(TokenType op) {
+  switch (op) {
+    case LT:  return GT;
+    case LET: return GET;
+    case GT:  return LT;
+    case GET: return LET;
+    default:  return op;
+  }
+}
+
+static TokenType negation(TokenType op) {
+  switch (op) {
+    case EQ:  return NEQ;
+    case NEQ: return EQ;
+    case LT:  return GET;
+    case LET: return GT;
+    case GT:  return LET;
+    default:  return LT;
+  }
+}
+
+/* Procedure restrictVar narrows variable id to the
+ * values that satisfy "id op e" with e in b
+ */
+static void restrictVar(State *s, int id, TokenType op, Interval b) {
+  Interval *x = &s->var[id];
+  switch (op) {
+    case LT:
+      if (b.hi - 1 < x->hi) x->hi = b.hi - 1;
+      break;
+    case LET:
+      if (b.hi < x->hi) x->hi = b.hi;
+      break;
+    case GT:
+      if (b.lo + 1 > x->lo) x->lo = b.lo + 1;
+      break;
+    case GET:
+      if (b.lo > x->lo) x->lo = b.lo;
+      break;
+    case EQ:
+      if (b.lo > x->lo) x->lo = b.lo;
+      if (b.hi < x->hi) x->hi = b.hi;
+      break;
+    case NEQ:
+      if (b.lo == b.hi && x->lo == b.lo) x->lo++;
+      if (b.lo == b.hi && x->hi == b.lo) x->hi--;
+      break;
+    default:
+      break;
+  }
+  if (x->lo > x->hi)
+    s->bottom = TRUE;
+}
+
+/* Procedure refine narrows state s (taken after the
+ * test was evaluated) to the executions where the
+ * test tree is true (sense TRUE) or false
+ */
+static void refine(TreeNode *tree, State *s, int sense) {
+  TokenType op;
+  TreeNode *l = tree->child[0];
+  TreeNode *r = tree->child[1];
+  int lid, rid, savedMarking = marking;
+  Interval li, ri;
+
+  if (s->bottom || tree->nodekind != ExpK || tree->kind.exp != OpK)
+    return;
+  op = tree->attr.op;
+  if (op == PLUS || op == MINUS || op == TIMES || op == OVER)
+    return;
+  if (hasAssign(tree))
+    return;
+  if (!sense)
+    op = negation(op);
+
+  lid = l->kind.exp == IdK ? varOf(st_bucket(l->attr.name)) : -1;
+  rid = r->kind.exp == IdK ? varOf(st_bucket(r->attr.name)) : -1;
+  /* the test was evaluated, and its accesses
+   * classified, before
+   */
+  marking = FALSE;
+  li = evalExp(l, s);
+  ri = evalExp(r, s);
+  marking = savedMarking;
+  if (lid >= 0)
+    restrictVar(s, lid, op, ri);
+  if (rid >= 0 && !s->bottom)
+    restrictVar(s, rid, mirror(op), li);
+}
+
+/* Procedure havoc forgets the range of every
+ * variable assigned in tree
+ */
+static void havoc(TreeNode *tree, State *s) {
+  int i, id;
+  for (; tree != NULL; tree = tree->sibling) {
+    if (tree->nodekind == ExpK && tree->kind.exp == AssignK) {
+      id = varOf(st_bucket(tree->child[0]->attr.name));
+      if (id >= 0)
+        s->var[id] = top;
+    }
+    if (tree->nodekind == StmtK && tree->kind.stmt == CompK) {
+      sc_push(tree->attr.scope);
+      for (i = 0; i < MAXCHILDREN; ++i)
+        havoc(tree->child[i], s);
+      sc_pop();
+    }
+    else
+      for (i = 0; i < MAXCHILDREN; ++i)
+        havoc(tree->child[i], s);
+  }
+}
+
+static void analyzeStmt(TreeNode *tree, State *s);
+
+static void analyzeList(TreeNode *tree, State *s) {
+  for (; tree != NULL && !s->bottom; tree = tree->sibling)
+    analyzeStmt(tree, s);
+}
+
+/* Procedure loopBody runs one iteration of the while
+ * loop tree from the loop head state s
+ */
+static void loopBody(TreeNode *tree, State *s) {
+  evalExp(tree->child[0], s);
+  refine(tree->child[0], s, TRUE);
+  ++loopDepth;
+  if (!s->bottom)
+    analyzeStmt(tree->child[1], s);
+  --loopDepth;
+}
+
+/* Procedure analyzeWhile computes a loop invariant
+ * for the while statement tree by iteration with
+ * widening, then makes the final pass over it
+ */
+static void analyzeWhile(TreeNode *tree, State *s) {
+  State *head = copyState(s);
+  State *cur;
+  int savedMarking = marking;
+  int iter;
+
+  marking = FALSE;
+  if (loopDepth < MAXLOOPDEPTH) {
+    for (iter = 0; ; ++iter) {
+      cur = copyState(head);
+      loopBody(tree, cur);
+      joinState(cur, s);
+      if (leqState(cur, head)) {
+        freeState(cur);
+        break;
+      }
+      if (iter < WIDENAFTER)
+        joinState(head, cur);
+      else
+        widenState(head, cur);
+      freeState(cur);
+    }
+    /* one narrowing step */
+    cur = copyState(head);
+    loopBody(tree, cur);
+    joinState(cur, s);
+    assignState(head, cur);
+    freeState(cur);
+  }
+  else {
+    havoc(tree->child[0], head);
+    havoc(tree->child[1], head);
+  }
+  marking = savedMarking;
+
+  /* final pass */
+  evalExp(tree->child[0], head);
+  cur = copyState(head);
+  refine(tree->child[0], cur, TRUE);
+  ++loopDepth;
+  if (!cur->bottom)
+    analyzeStmt(tree->child[1], cur);
+  --loopDepth;
+  freeState(cur);
+  refine(tree->child[0], head, FALSE);
+  assignState(s, head);
+  freeState(head);
+}
+
+static void analyzeStmt(TreeNode *tree, State *s) {
+  State *other;
+  TreeNode *t;
+  int id;
+
+  if (tree->nodekind == ExpK) {
+    evalExp(tree, s);
+    return;
+  }
+  if (tree->nodekind != StmtK)
+    return;
+  switch (tree->kind.stmt) {
+    case CompK:
+      sc_push(tree->attr.scope);
+      for (t = tree->child[0]; t != NULL; t = t->sibling)
+        if (t->nodekind == DeclK && t->kind.decl == VarK &&
+            (id = varOf(st_bucket(t->attr.name))) >= 0)
+          s->var[id] = top;
+      analyzeList(tree->child[1], s);
+      sc_pop();
+      break;
+    case IfK:
+      evalExp(tree->child[0], s);
+      other = copyState(s);
+      refine(tree->child[0], s, TRUE);
+      refine(tree->child[0], other, FALSE);
+      if (!s->bottom && tree->child[1] != NULL)
+        analyzeStmt(tree->child[1], s);
+      if (!other->bottom && tree->child[2] != NULL)
+        analyzeStmt(tree->child[2], other);
+      joinState(s, other);
+      freeState(other);
+      break;
+    case WhileK:
+      analyzeWhile(tree, s);
+      break;
+    case ReturnK:
+      if (tree->child[0] != NULL)
+        evalExp(tree->child[0], s);
+      s->bottom = TRUE;
+      break;
+    default:
+      break;
+  }
+}
+
+/* Procedure analyzeFunc numbers the variables of the
+ * function declaration tree and analyses its body
+ */
+static void analyzeFunc(TreeNode *tree) {
+  TreeNode *body = tree->child[2];
+  TreeNode *t;
+  State *s;
+  int n = countDecls(tree->child[1]) + countDecls(body);
+
+  varCap = 2 * n + 1;
+  varBucket = (BucketList *) calloc(varCap, sizeof(BucketList));
+  varId = (int *) malloc(varCap * sizeof(int));
+  nVars = 0;
+
+  sc_push(body->attr.scope);
+  for (t = tree->child[1]; t != NULL; t = t->sibling)
+    addVar(t);
+  sc_pop();
+  collectVars(body);
+
+  s = newState();
+  marking = TRUE;
+  loopDepth = 0;
+  analyzeStmt(body, s);
+  freeState(s);
+
+  free(varBucket);
+  free(varId);
+  varBucket = NULL;
+  varId = NULL;
+  varCap = 0;
+}
+
+/* Procedure checkBoundsDecl analyses the top-level
+ * declaration t if it is a function
+ */
+void checkBoundsDecl(TreeNode *t) {
+  if (t->nodekind == DeclK && t->kind.decl == FuncK &&
+      (Prune != PruneCheck || cg_reachable(t))) {
+    sc_push(globalScope);
+    analyzeFunc(t);
+    sc_pop();
+  }
+}
+
+/* Procedure printBounds prints how many array
+ * accesses were proven in bounds
+ */
+void printBounds(void) {
+  if (TraceAnalyze && BoundsCheck) {
+    if (JsonListing)
+      fprintf(listing, "{\"type\": \"bounds\", \"accesses\": %d, \"proven\": %d}\n",
+              nAccesses, nProven);
+    else
+      fprintf(listing, "\nBounds checks: %d of %d array accesses proven in bounds\n",
+              nProven, nAccesses);
+  }
+}
+
+/* Procedure checkBounds computes the range of every
+ * integer variable by interval analysis of each
+ * function, marks the VectorIdK nodes whose index is
+ * proven within the array (inBounds) and reports
+ * indexes that are definitely out of bounds
+ */
+void checkBounds(TreeNode *syntaxTree) {
+  TreeNode *t;
+
+  nAccesses = nProven = 0;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    checkBoundsDecl(t);
+  printBounds();
+}
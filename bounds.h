@@ -0,0 +1,26 @@
+/****************************************************/
+/* File: bounds.h                                   */
+/* Array bounds analysis interface for the          */
+/* C- compiler                                      */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _BOUNDS_H_
+#define _BOUNDS_H_
+
+/* Procedure checkBounds computes the range of every
+ * integer variable by interval analysis of each
+ * function, marks the VectorIdK nodes whose index is
+ * proven within the array (inBounds) and reports
+ * indexes that are definitely out of bounds
+ */
+void checkBounds(TreeNode *syntaxTree);
+
+/* checkBounds in steps: checkBoundsDecl analyses
+ * one top-level declaration and printBounds prints
+ * the count of accesses proven in bounds so far
+ */
+void checkBoundsDecl(TreeNode *t);
+void printBounds(void);
+
+#endif
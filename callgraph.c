@@ -0,0 +1,123 @@
+/****************************************************/
+/* File: callgraph.c                                */
+/* Call graph of the C- program, built during       */
+/* semantic analysis                                */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "callgraph.h"
+
+/* the functions in declaration order */
+static CallNode *funcs = NULL;
+static int nFuncs = 0, maxFuncs = 0;
+
+void cg_reset(void) {
+  int i;
+
+  for (i = 0; i < nFuncs; ++i) {
+    free(funcs[i]->calls);
+    free(funcs[i]);
+  }
+  nFuncs = 0;
+}
+
+void cg_addFunc(TreeNode *func) {
+  CallNode n = (CallNode) malloc(sizeof(struct CallNodeRec));
+
+  n->func = func;
+  n->calls = NULL;
+  n->nCalls = n->maxCalls = 0;
+  n->reachable = FALSE;
+  n->pure = FALSE;
+  func->callNode = n;
+  if (nFuncs == maxFuncs) {
+    maxFuncs = maxFuncs ? 2 * maxFuncs : 64;
+    funcs = (CallNode *) realloc(funcs, maxFuncs * sizeof(CallNode));
+  }
+  funcs[nFuncs++] = n;
+}
+
+void cg_addCall(TreeNode *callee, int lineno) {
+  CallNode caller;
+
+  if (nFuncs == 0 || callee->nodekind != DeclK ||
+      callee->kind.decl != FuncK || callee->callNode == NULL)
+    return;
+  caller = funcs[nFuncs - 1];
+  if (caller->nCalls == caller->maxCalls) {
+    caller->maxCalls = caller->maxCalls ? 2 * caller->maxCalls : 4;
+    caller->calls = (CallSite *)
+      realloc(caller->calls, caller->maxCalls * sizeof(CallSite));
+  }
+  caller->calls[caller->nCalls].callee = callee->callNode;
+  caller->calls[caller->nCalls].lineno = lineno;
+  caller->nCalls++;
+}
+
+void cg_markReachable(void) {
+  CallNode *stack;
+  int i, top = 0;
+
+  for (i = 0; i < nFuncs; ++i)
+    funcs[i]->reachable = FALSE;
+  for (i = 0; i < nFuncs; ++i)
+    if (strcmp(funcs[i]->func->attr.name, "main") == 0)
+      break;
+  if (i == nFuncs)
+    return;
+
+  /* every function is pushed at most once */
+  stack = (CallNode *) malloc(nFuncs * sizeof(CallNode));
+  funcs[i]->reachable = TRUE;
+  stack[top++] = funcs[i];
+  while (top > 0) {
+    CallNode n = stack[--top];
+    for (i = 0; i < n->nCalls; ++i)
+      if (!n->calls[i].callee->reachable) {
+        n->calls[i].callee->reachable = TRUE;
+        stack[top++] = n->calls[i].callee;
+      }
+  }
+  free(stack);
+}
+
+int cg_reachable(TreeNode *func) {
+  return func->callNode == NULL || func->callNode->reachable;
+}
+
+void printCallGraph(FILE *listing) {
+  int i, k, nReachable = 0;
+
+  if (JsonListing) {
+    for (i = 0; i < nFuncs; ++i) {
+      CallNode n = funcs[i];
+      fprintf(listing, "{\"type\": \"function\", \"name\": ");
+      printJsonString(listing, n->func->attr.name);
+      fprintf(listing, ", \"line\": %d, \"reachable\": %s, \"calls\": [",
+              n->func->lineno, n->reachable ? "true" : "false");
+      for (k = 0; k < n->nCalls; ++k) {
+        fprintf(listing, k ? ", {\"callee\": " : "{\"callee\": ");
+        printJsonString(listing, n->calls[k].callee->func->attr.name);
+        fprintf(listing, ", \"line\": %d}", n->calls[k].lineno);
+      }
+      fprintf(listing, "]}\n");
+    }
+    return;
+  }
+
+  fprintf(listing, "\nCall graph:\n\n");
+  fprintf(listing, "Function        Reachable  Calls\n");
+  fprintf(listing, "--------------  ---------  -----\n");
+  for (i = 0; i < nFuncs; ++i) {
+    CallNode n = funcs[i];
+    fprintf(listing, "%-14s  %-9s", n->func->attr.name, n->reachable ? "yes" : "no");
+    for (k = 0; k < n->nCalls; ++k)
+      fprintf(listing, "%s%s (%d)", k ? ", " : "  ", n->calls[k].callee->func->attr.name,
+              n->calls[k].lineno);
+    fputc('\n', listing);
+    nReachable += n->reachable;
+  }
+  fprintf(listing, "\n%d of %d functions reachable from main\n", nReachable, nFuncs);
+}
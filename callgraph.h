@@ -0,0 +1,62 @@
+/****************************************************/
+/* File: callgraph.h                                */
+/* Call graph of the C- program, built during       */
+/* semantic analysis                                */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _CALLGRAPH_H_
+#define _CALLGRAPH_H_
+
+#include "globals.h"
+
+/* one call site of a function */
+typedef struct {
+  struct CallNodeRec *callee;
+  int lineno;
+} CallSite;
+
+/* The node of each declared function, with its
+ * call sites in source order
+ */
+typedef struct CallNodeRec {
+  TreeNode *func;
+  CallSite *calls;  /* growable array of nCalls calls */
+  int nCalls;
+  int maxCalls;
+  int reachable;    /* called from main, directly or not */
+  int pure;         /* has no effect but its result (see fold.h) */
+} *CallNode;
+
+/* Procedure cg_reset discards the call graph so
+ * that a new program can be analysed
+ */
+void cg_reset(void);
+
+/* Procedure cg_addFunc adds the function
+ * declaration func to the graph; the calls added
+ * next are made by it
+ */
+void cg_addFunc(TreeNode *func);
+
+/* Procedure cg_addCall adds a call from the last
+ * function added to the function declared by callee
+ */
+void cg_addCall(TreeNode *callee, int lineno);
+
+/* Procedure cg_markReachable marks the functions
+ * reachable from main
+ */
+void cg_markReachable(void);
+
+/* Function cg_reachable returns FALSE if the
+ * function declaration func is never called from main
+ */
+int cg_reachable(TreeNode *func);
+
+/* Procedure printCallGraph prints the functions,
+ * whether they are reachable and their calls
+ */
+void printCallGraph(FILE *listing);
+
+#endif
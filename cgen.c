@@ -0,0 +1,795 @@
+/****************************************************/
+/* File: cgen.c                                     */
+/* The code generator implementation                */
+/* for the C- compiler                              */
+/* (generates x86-64 code for the System V ABI)     */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "analyze.h"
+#include "code.h"
+#include "callgraph.h"
+#include "peephole.h"
+#include "loops.h"
+#include "intrinsic.h"
+#include "cgen.h"
+
+/* argument registers of the System V calling convention */
+static const Reg argReg[] = { RDI, RSI, RDX, RCX, R8, R9 };
+#define NARGREGS 6
+
+/* pushDepth counts the quadwords pushed since the
+ * prologue, so that %rsp can be kept 16-byte aligned
+ * at every call
+ */
+static int pushDepth;
+
+/* label of the epilogue of the current function */
+static int returnLabel;
+
+/* frame bytes used by the function being laid out,
+ * and those taken by the blocks enclosing the block
+ * being laid out; blocks that are never active at
+ * the same time share their frame bytes
+ */
+static int frameSize;
+static int frameDepth;
+
+/* the callee-saved registers used by the function
+ * and the frame slots in which they are kept
+ */
+static Reg savedReg[NPTRREGS];
+static int savedOffset[NPTRREGS];
+static int nSaved;
+
+/* the pointers of the strength-reduced loops being
+ * generated, innermost last
+ */
+static IvPointer live[NPTRREGS];
+static int nLive;
+
+/* vector registers of the vectorized loops: the
+ * values of the expressions take the registers from
+ * 0 on by depth, the splats of the loop those from
+ * VSPLAT on, and the SSE2 multiplication VTMP and
+ * VTMP + 1
+ */
+#define VSPLAT 8
+#define VTMP (VSPLAT + NSPLATS)
+
+/* prototypes for internal recursive code generators */
+static void cGen(TreeNode *tree);
+static void genExp(TreeNode *tree);
+
+static void push(Reg r) {
+  emit(I_PUSH, 8, opReg(r), opNone());
+  ++pushDepth;
+}
+
+static void pop(Reg r) {
+  emit(I_POP, 8, opReg(r), opNone());
+  --pushDepth;
+}
+
+static int isArray(TreeNode *decl) {
+  return (decl->nodekind == DeclK && decl->kind.decl == VectorVarK) ||
+         (decl->nodekind == ParamK && decl->kind.param == VectorParamK);
+}
+
+/* Function varSize returns the number of frame
+ * bytes needed by the declaration decl
+ */
+static int varSize(TreeNode *decl) {
+  if (decl->nodekind == DeclK && decl->kind.decl == VectorVarK)
+    return (4 * decl->attr.vector.size + 7) & ~7;
+  return 8;
+}
+
+/* Procedure layoutScope assigns frame offsets to the
+ * symbols of scope sc below frameDepth, in the order
+ * in which addLocation numbered them
+ */
+static void layoutScope(Scope sc) {
+  BucketList *syms;
+  BucketList l;
+  int n = 0;
+  int i, j;
+
+  for (i = 0; i < SIZE; ++i)
+    for (l = sc->hashTable[i]; l != NULL; l = l->next)
+      ++n;
+  if (n == 0)
+    return;
+
+  syms = (BucketList *) malloc(n * sizeof(BucketList));
+  n = 0;
+  for (i = 0; i < SIZE; ++i)
+    for (l = sc->hashTable[i]; l != NULL; l = l->next) {
+      for (j = n++; j > 0 && syms[j - 1]->memloc > l->memloc; --j)
+        syms[j] = syms[j - 1];
+      syms[j] = l;
+    }
+
+  for (i = 0; i < n; ++i) {
+    frameDepth += varSize(syms[i]->treeNode);
+    syms[i]->offset = -frameDepth;
+  }
+  if (frameDepth > frameSize)
+    frameSize = frameDepth;
+  free(syms);
+}
+
+/* Procedure layoutStmt lays out the scopes of the
+ * compound statements in the statement list tree:
+ * the variables of a block go below those of the
+ * blocks around it, and the frame bytes of a block
+ * are free again after it, for its sibling blocks
+ * and the branches of an if
+ */
+static void layoutStmt(TreeNode *tree) {
+  int depth;
+
+  while (tree != NULL) {
+    if (tree->nodekind == StmtK) {
+      switch (tree->kind.stmt) {
+        case CompK:
+          depth = frameDepth;
+          layoutScope(tree->attr.scope);
+          layoutStmt(tree->child[1]);
+          frameDepth = depth;
+          break;
+        case IfK:
+        case WhileK:
+          layoutStmt(tree->child[1]);
+          layoutStmt(tree->child[2]);
+          break;
+        default:
+          break;
+      }
+    }
+    tree = tree->sibling;
+  }
+}
+
+/* Function varOperand returns the memory operand
+ * holding the variable l
+ */
+static Operand varOperand(BucketList l) {
+  if (l->scope == globalScope)
+    return opGlobal(asmName(l->name));
+  return opMem(RBP, l->offset);
+}
+
+/* Procedure genArrayBase loads the address of the
+ * first element of array l into register r
+ */
+static void genArrayBase(BucketList l, Reg r) {
+  if (l->treeNode->nodekind == ParamK)
+    emit(I_MOV, 8, opReg(r), varOperand(l));
+  else
+    emit(I_LEA, 8, opReg(r), varOperand(l));
+}
+
+/* Procedure genBoundsCheck stops the program when
+ * the index of the VectorIdK node tree, in %eax, is
+ * outside its array. Only arrays declared with a size
+ * and indexes not proven by checkBounds are checked
+ */
+static void genBoundsCheck(TreeNode *tree) {
+  TreeNode *decl = st_bucket(tree->attr.name)->treeNode;
+  int ok;
+
+  if (!BoundsCheck || tree->inBounds || decl->nodekind != DeclK)
+    return;
+  ok = newLabel();
+  emit(I_CMP, 4, opReg(RAX), opImm(decl->attr.vector.size));
+  emitJcc(CondB, ok);
+  /* the call does not return, so %rsp need not be restored */
+  emit(I_AND, 8, opReg(RSP), opImm(-16));
+  emit(I_MOV, 4, opReg(RDI), opImm(tree->lineno));
+  emit(I_CALL, 8, opSym("cminus_bounds_error"), opNone());
+  emitLabel(ok);
+}
+
+/* Function livePointer returns the register that
+ * holds the address of element k of the array of the
+ * VectorIdK node tree, less 4 * k, or NOREG
+ */
+static Reg livePointer(TreeNode *tree, long *k) {
+  BucketList iv, array;
+  int i;
+
+  if (nLive == 0 || !ivAccess(tree, &iv, &array, k))
+    return NOREG;
+  for (i = nLive - 1; i >= 0; --i)
+    if (live[i].iv == iv && live[i].array == array)
+      return live[i].reg;
+  return NOREG;
+}
+
+/* Function hasAssign tells if the expression tree
+ * assigns a variable, which may move the pointers
+ * of the live loops
+ */
+static int hasAssign(TreeNode *tree) {
+  int i;
+
+  for (; tree != NULL; tree = tree->sibling) {
+    if (tree->nodekind == ExpK && tree->kind.exp == AssignK)
+      return TRUE;
+    for (i = 0; i < MAXCHILDREN; ++i)
+      if (hasAssign(tree->child[i]))
+        return TRUE;
+  }
+  return FALSE;
+}
+
+/* Procedure genIndex evaluates the index of the
+ * VectorIdK node tree into %rax and the array
+ * address into %rcx
+ */
+static void genIndex(TreeNode *tree) {
+  genExp(tree->child[0]);
+  genBoundsCheck(tree);
+  emit(I_MOVSX, 8, opReg(RAX), opReg(RAX));
+  genArrayBase(st_bucket(tree->attr.name), RCX);
+}
+
+static CondCode condOf(TokenType op) {
+  switch (op) {
+    case EQ:  return CondE;
+    case NEQ: return CondNE;
+    case LT:  return CondL;
+    case LET: return CondLE;
+    case GT:  return CondG;
+    default:  return CondGE;
+  }
+}
+
+static int isRelation(TreeNode *tree) {
+  if (tree->nodekind != ExpK || tree->kind.exp != OpK)
+    return FALSE;
+  switch (tree->attr.op) {
+    case EQ: case NEQ: case LT: case LET: case GT: case GET:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+/* Procedure genOperands evaluates the operands of
+ * the OpK node tree into %eax (left) and %ecx (right)
+ */
+static void genOperands(TreeNode *tree) {
+  genExp(tree->child[0]);
+  push(RAX);
+  genExp(tree->child[1]);
+  emit(I_MOV, 4, opReg(RCX), opReg(RAX));
+  pop(RAX);
+}
+
+/* Procedure genCond jumps to label falseLabel when
+ * the test expression tree evaluates to zero
+ */
+static void genCond(TreeNode *tree, int falseLabel) {
+  if (isRelation(tree)) {
+    genOperands(tree);
+    emit(I_CMP, 4, opReg(RAX), opReg(RCX));
+    emitJcc(negateCond(condOf(tree->attr.op)), falseLabel);
+  }
+  else {
+    genExp(tree);
+    emit(I_TEST, 4, opReg(RAX), opReg(RAX));
+    emitJcc(CondE, falseLabel);
+  }
+}
+
+/* Procedure genIntrinsic lowers a call of the
+ * built-in function in: its argument is evaluated
+ * straight into %edi and the runtime routine is
+ * called without the argument pushes of genCall
+ */
+static void genIntrinsic(TreeNode *tree, const Intrinsic *in) {
+  int pad = pushDepth % 2;
+
+  if (tree->child[0] != NULL) {
+    genExp(tree->child[0]);
+    emit(I_MOV, 4, opReg(RDI), opReg(RAX));
+  }
+  if (pad)
+    emit(I_SUB, 8, opReg(RSP), opImm(8));
+  emit(I_CALL, 8, opSym(in->routine), opNone());
+  if (pad)
+    emit(I_ADD, 8, opReg(RSP), opImm(8));
+}
+
+/* Procedure genCall generates a call following the
+ * System V calling convention; arguments are
+ * evaluated left to right
+ */
+static void genCall(TreeNode *tree) {
+  TreeNode *arg;
+  const Intrinsic *in = intrinsic(tree->attr.name);
+  const char *target;
+  int nargs = 0;
+  int nstack, reserve, i;
+
+  if (in != NULL) {
+    genIntrinsic(tree, in);
+    return;
+  }
+  target = asmName(tree->attr.name);
+
+  for (arg = tree->child[0]; arg != NULL; arg = arg->sibling)
+    ++nargs;
+  nstack = nargs > NARGREGS ? nargs - NARGREGS : 0;
+  reserve = nstack + (pushDepth + nstack) % 2;
+  if (reserve > 0) {
+    emit(I_SUB, 8, opReg(RSP), opImm(8 * reserve));
+    pushDepth += reserve;
+  }
+
+  for (arg = tree->child[0], i = 0; arg != NULL; arg = arg->sibling, ++i) {
+    genExp(arg);
+    if (i < NARGREGS)
+      push(RAX);
+    else /* above the pushed register arguments */
+      emit(I_MOV, 8, opMem(RSP, 8 * i), opReg(RAX));
+  }
+  for (i = (nargs < NARGREGS ? nargs : NARGREGS) - 1; i >= 0; --i)
+    pop(argReg[i]);
+
+  emit(I_CALL, 8, opSym(target), opNone());
+
+  if (reserve > 0) {
+    emit(I_ADD, 8, opReg(RSP), opImm(8 * reserve));
+    pushDepth -= reserve;
+  }
+}
+
+/* Procedure genExp generates code at an expression
+ * node; the value is left in %eax (%rax for arrays)
+ */
+static void genExp(TreeNode *tree) {
+  BucketList l;
+  Reg r;
+  long k;
+  int i;
+
+  switch (tree->kind.exp) {
+    case ConstK:
+      emit(I_MOV, 4, opReg(RAX), opImm(tree->attr.val));
+      break;
+    case IdK:
+      l = st_bucket(tree->attr.name);
+      if (isArray(l->treeNode))
+        genArrayBase(l, RAX);
+      else
+        emit(I_MOV, 4, opReg(RAX), varOperand(l));
+      break;
+    case VectorIdK:
+      if ((r = livePointer(tree, &k)) != NOREG)
+        emit(I_MOV, 4, opReg(RAX), opMem(r, 4 * k));
+      else {
+        genIndex(tree);
+        emit(I_MOV, 4, opReg(RAX), opIndex(RCX, RAX, 4, 0));
+      }
+      break;
+    case AssignK: {
+        TreeNode *var = tree->child[0];
+
+        l = st_bucket(var->attr.name);
+        if (var->kind.exp == VectorIdK &&
+            (r = livePointer(var, &k)) != NOREG) {
+          if (hasAssign(tree->child[1])) {
+            /* the value may move the pointer, so the
+             * element is fixed before it
+             */
+            emit(I_LEA, 8, opReg(RCX), opMem(r, 4 * k));
+            push(RCX);
+            genExp(tree->child[1]);
+            pop(RCX);
+            emit(I_MOV, 4, opMem(RCX, 0), opReg(RAX));
+          }
+          else {
+            genExp(tree->child[1]);
+            emit(I_MOV, 4, opMem(r, 4 * k), opReg(RAX));
+          }
+        }
+        else if (var->kind.exp == VectorIdK) {
+          genExp(var->child[0]);
+          genBoundsCheck(var);
+          emit(I_MOVSX, 8, opReg(RAX), opReg(RAX));
+          push(RAX);
+          genExp(tree->child[1]);
+          pop(RCX);
+          genArrayBase(l, RDX);
+          emit(I_MOV, 4, opIndex(RDX, RCX, 4, 0), opReg(RAX));
+        }
+        else {
+          genExp(tree->child[1]);
+          emit(I_MOV, 4, varOperand(l), opReg(RAX));
+          /* keep the pointers that follow l in step */
+          for (i = 0; i < nLive; ++i)
+            if (live[i].iv == l)
+              emit(I_ADD, 8, opReg(live[i].reg), opImm(4L * ivStep(tree, l)));
+        }
+      }
+      break;
+    case OpK:
+      genOperands(tree);
+      switch (tree->attr.op) {
+        case PLUS:
+          emit(I_ADD, 4, opReg(RAX), opReg(RCX));
+          break;
+        case MINUS:
+          emit(I_SUB, 4, opReg(RAX), opReg(RCX));
+          break;
+        case TIMES:
+          emit(I_IMUL, 4, opReg(RAX), opReg(RCX));
+          break;
+        case OVER:
+          emit(I_CDQ, 4, opNone(), opNone());
+          emit(I_IDIV, 4, opReg(RCX), opNone());
+          break;
+        default: /* relational operators */
+          emit(I_CMP, 4, opReg(RAX), opReg(RCX));
+          emit(I_SETCC, 1, opReg(RAX), opNone())->cc = condOf(tree->attr.op);
+          emit(I_MOVZB, 4, opReg(RAX), opReg(RAX));
+          break;
+      }
+      break;
+    case CallK:
+      genCall(tree);
+      break;
+    default:
+      break;
+  }
+}
+
+/* Function vecBase returns the register that holds
+ * the address of the first element of array l in
+ * the vectorized loop
+ */
+static Reg vecBase(LoopInfo loop, BucketList l) {
+  int i;
+  for (i = 0; loop->pointers[i].array != l; ++i)
+    ;
+  return loop->pointers[i].reg;
+}
+
+/* Procedure genVecMul multiplies vector register d
+ * by src lane by lane; SSE2 has no pmulld, so the
+ * even and the odd lanes are multiplied to 64 bits
+ * by pmuludq and the low halves put back together
+ */
+static void genVecMul(int size, int d, Operand src) {
+  if (size == 32) {
+    emit(I_VMUL, size, opVec(d), src);
+    return;
+  }
+  emit(I_VMOV, size, opVec(VTMP), opVec(d));
+  emit(I_PMULUDQ, size, opVec(d), src);
+  emit(I_PSRLQ, size, opVec(VTMP), opImm(32));
+  emit(I_VMOV, size, opVec(VTMP + 1), src);
+  emit(I_PSRLQ, size, opVec(VTMP + 1), opImm(32));
+  emit(I_PMULUDQ, size, opVec(VTMP), opVec(VTMP + 1));
+  emit(I_PSHUFD, size, opVec(d), opImm(0x08));
+  emit(I_PSHUFD, size, opVec(VTMP), opImm(0x08));
+  emit(I_PUNPCKLDQ, size, opVec(d), opVec(VTMP));
+}
+
+static void genVecExp(LoopInfo loop, TreeNode *tree, int depth);
+
+/* Function vecOperand returns the operand that
+ * holds the value of the expression tree in every
+ * lane: the splat of a constant or invariant, the
+ * elements themselves for AVX2, which loads them
+ * unaligned, or else vector register depth
+ */
+static Operand vecOperand(LoopInfo loop, TreeNode *tree, int depth) {
+  int size = 4 * loop->lanes;
+
+  if (tree->kind.exp == ConstK || tree->kind.exp == IdK)
+    return opVec(VSPLAT + splatIndex(loop, tree));
+  if (tree->kind.exp == VectorIdK && size == 32)
+    return opIndex(vecBase(loop, st_bucket(tree->attr.name)), RAX, 4, 0);
+  genVecExp(loop, tree, depth);
+  return opVec(depth);
+}
+
+/* Procedure genVecExp evaluates the expression tree
+ * of a vectorized loop into vector register depth,
+ * one element per lane; the index is in %rax
+ */
+static void genVecExp(LoopInfo loop, TreeNode *tree, int depth) {
+  int size = 4 * loop->lanes;
+  Operand src;
+
+  if (tree->kind.exp == VectorIdK) {
+    emit(I_VMOV, size, opVec(depth),
+         opIndex(vecBase(loop, st_bucket(tree->attr.name)), RAX, 4, 0));
+    return;
+  }
+  if (tree->kind.exp != OpK) {
+    emit(I_VMOV, size, opVec(depth), opVec(VSPLAT + splatIndex(loop, tree)));
+    return;
+  }
+  genVecExp(loop, tree->child[0], depth);
+  src = vecOperand(loop, tree->child[1], depth + 1);
+  switch (tree->attr.op) {
+    case PLUS:
+      emit(I_VADD, size, opVec(depth), src);
+      break;
+    case MINUS:
+      emit(I_VSUB, size, opVec(depth), src);
+      break;
+    default: /* TIMES */
+      genVecMul(size, depth, src);
+      break;
+  }
+}
+
+/* Procedure genVectorLoop generates the vector part
+ * of the WhileK node tree, which loops.c vectorized:
+ * it runs the body on loop->lanes elements at a time
+ * while the last of them passes the test, with the
+ * index in %rax; the scalar loop that follows does
+ * the remaining iterations. Unaligned loads and
+ * stores let it start at any element
+ */
+static void genVectorLoop(TreeNode *tree, LoopInfo loop) {
+  TreeNode *body = tree->child[1];
+  TreeNode *t;
+  int size = 4 * loop->lanes;
+  int top = newLabel();
+  int done = newLabel();
+  int i;
+
+  for (i = 0; i < loop->nPointers; ++i)
+    genArrayBase(loop->pointers[i].array, loop->pointers[i].reg);
+  for (i = 0; i < loop->nSplats; ++i) {
+    Splat *sp = &loop->splats[i];
+    if (sp->var != NULL)
+      emit(I_MOV, 4, opReg(RAX), varOperand(sp->var));
+    else
+      emit(I_MOV, 4, opReg(RAX), opImm(sp->val));
+    emit(I_MOVD, size, opVec(VSPLAT + i), opReg(RAX));
+    if (size == 32)
+      emit(I_VBROADCAST, size, opVec(VSPLAT + i), opVec(VSPLAT + i));
+    else
+      emit(I_PSHUFD, size, opVec(VSPLAT + i), opImm(0));
+  }
+  emit(I_MOVSX, 8, opReg(RAX), varOperand(loop->iv));
+
+  /* iv + lanes - 1 test bound, in 64 bits so that it
+   * cannot overflow
+   */
+  emitLabel(top);
+  emit(I_LEA, 8, opReg(RCX), opMem(RAX, loop->lanes - 1));
+  if (loop->bound->kind.exp == ConstK)
+    emit(I_CMP, 8, opReg(RCX), opImm(loop->bound->attr.val));
+  else {
+    emit(I_MOVSX, 8, opReg(RDX), varOperand(st_bucket(loop->bound->attr.name)));
+    emit(I_CMP, 8, opReg(RCX), opReg(RDX));
+  }
+  emitJcc(negateCond(condOf(loop->test)), done);
+  sc_push(body->attr.scope);
+  for (t = body->child[1]; t->sibling != NULL; t = t->sibling) {
+    emitLineno = t->lineno;
+    genVecExp(loop, t->child[1], 0);
+    emit(I_VMOV, size, opIndex(vecBase(loop, st_bucket(t->child[0]->attr.name)), RAX, 4, 0),
+         opVec(0));
+  }
+  sc_pop();
+  emit(I_ADD, 8, opReg(RAX), opImm(loop->lanes));
+  emitJmp(top);
+  emitLabel(done);
+  emit(I_MOV, 4, varOperand(loop->iv), opReg(RAX));
+  if (size == 32)
+    emit(I_VZEROUPPER, size, opNone(), opNone());
+  emitLineno = tree->lineno;
+}
+
+/* Procedure genLoop generates the WhileK node tree
+ * as loopInfo describes it: the vector loop, if it
+ * was vectorized, runs first; the pointers of its
+ * strength-reduced accesses are set up next, then
+ * come the peeled copies of the body and the loop
+ * with its unrolled copies
+ */
+static void genLoop(TreeNode *tree) {
+  LoopInfo loop = loopInfo(tree);
+  int peel = loop != NULL ? loop->peel : 0;
+  int copies = loop != NULL ? loop->copies : 1;
+  int base = nLive;
+  int l1, l2, i;
+
+  if (loop != NULL && loop->lanes > 0)
+    genVectorLoop(tree, loop);
+  for (i = 0; loop != NULL && StrengthReduce && i < loop->nPointers; ++i) {
+    IvPointer *p = &loop->pointers[i];
+    genArrayBase(p->array, p->reg);
+    emit(I_MOVSX, 8, opReg(RAX), varOperand(p->iv));
+    emit(I_LEA, 8, opReg(p->reg), opIndex(p->reg, RAX, 4, 0));
+    live[nLive++] = *p;
+  }
+  for (i = 0; i < peel; ++i)
+    cGen(tree->child[1]);
+  if (copies > 0) {
+    l1 = newLabel();
+    l2 = newLabel();
+    emitLabel(l1);
+    genCond(tree->child[0], l2);
+    for (i = 0; i < copies; ++i)
+      cGen(tree->child[1]);
+    emitJmp(l1);
+    emitLabel(l2);
+  }
+  nLive = base;
+}
+
+/* Procedure genStmt generates code at a statement node */
+static void genStmt(TreeNode *tree) {
+  int l1, l2;
+
+  switch (tree->kind.stmt) {
+    case CompK:
+      sc_push(tree->attr.scope);
+      cGen(tree->child[1]);
+      sc_pop();
+      break;
+    case IfK:
+      l1 = newLabel();
+      genCond(tree->child[0], l1);
+      cGen(tree->child[1]);
+      if (tree->child[2] != NULL) {
+        l2 = newLabel();
+        emitJmp(l2);
+        emitLabel(l1);
+        cGen(tree->child[2]);
+        emitLabel(l2);
+      }
+      else
+        emitLabel(l1);
+      break;
+    case WhileK:
+      genLoop(tree);
+      break;
+    case ReturnK:
+      if (tree->child[0] != NULL)
+        genExp(tree->child[0]);
+      emitJmp(returnLabel);
+      break;
+    default:
+      break;
+  }
+}
+
+/* Procedure cGen recursively generates code for
+ * the statement list tree
+ */
+static void cGen(TreeNode *tree) {
+  while (tree != NULL) {
+    emitLineno = tree->lineno;
+    if (tree->nodekind == StmtK)
+      genStmt(tree);
+    else if (tree->nodekind == ExpK)
+      genExp(tree);
+    tree = tree->sibling;
+  }
+}
+
+/* Procedure genFunc generates the prologue, body
+ * and epilogue of the function declaration tree
+ */
+static void genFunc(TreeNode *tree) {
+  TreeNode *body = tree->child[2];
+  TreeNode *param;
+  unsigned regs;
+  int i;
+
+  frameSize = frameDepth = 0;
+  layoutStmt(body);
+  regs = analyzeLoops(tree);
+  for (nSaved = 0, i = 0; i < NOREG; ++i)
+    if (regs & (1u << i)) {
+      frameSize += 8;
+      savedReg[nSaved] = (Reg) i;
+      savedOffset[nSaved++] = -frameSize;
+    }
+  returnLabel = newLabel();
+  pushDepth = 0;
+
+  emitLineno = tree->lineno;
+  emitFunction(asmName(tree->attr.name));
+  emit(I_PUSH, 8, opReg(RBP), opNone());
+  emit(I_MOV, 8, opReg(RBP), opReg(RSP));
+  if (frameSize > 0)
+    emit(I_SUB, 8, opReg(RSP), opImm((frameSize + 15) & ~15));
+  for (i = 0; i < nSaved; ++i)
+    emit(I_MOV, 8, opMem(RBP, savedOffset[i]), opReg(savedReg[i]));
+
+  /* spill the parameters into their frame slots */
+  sc_push(body->attr.scope);
+  for (param = tree->child[1], i = 0; param != NULL; param = param->sibling, ++i) {
+    BucketList l = st_bucket(param->attr.name);
+    int size = isArray(param) ? 8 : 4;
+
+    if (i < NARGREGS)
+      emit(I_MOV, size, opMem(RBP, l->offset), opReg(argReg[i]));
+    else {
+      emit(I_MOV, size, opReg(RAX), opMem(RBP, 16 + 8 * (i - NARGREGS)));
+      emit(I_MOV, size, opMem(RBP, l->offset), opReg(RAX));
+    }
+  }
+  sc_pop();
+
+  cGen(body);
+
+  emitLabel(returnLabel);
+  for (i = 0; i < nSaved; ++i)
+    emit(I_MOV, 8, opReg(savedReg[i]), opMem(RBP, savedOffset[i]));
+  emit(I_LEAVE, 8, opNone(), opNone());
+  emit(I_RET, 8, opNone(), opNone());
+}
+
+/* Procedure genDecl appends the code of the
+ * top-level declaration t to the instruction buffer
+ */
+void genDecl(TreeNode *t) {
+  if (t->nodekind != DeclK)
+    return;
+  sc_push(globalScope);
+  switch (t->kind.decl) {
+    case FuncK:
+      if (intrinsic(t->attr.name) == NULL &&
+          (Prune == NoPrune || cg_reachable(t)))
+        genFunc(t);
+      if (ReleaseScopes)
+        releaseScopes(t);
+      break;
+    case VarK:
+      emitGlobal(asmName(t->attr.name), 4);
+      break;
+    case VectorVarK:
+      emitGlobal(asmName(t->attr.vector.name), 4 * t->attr.vector.size);
+      break;
+    default:
+      break;
+  }
+  sc_pop();
+}
+
+/* Procedure genProgram fills the instruction buffer
+ * of code.h with x86-64 code for the syntax tree,
+ * without writing it out
+ */
+void genProgram(TreeNode *syntaxTree) {
+  TreeNode *t;
+
+  codeReset();
+  resetPeephole();
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    genDecl(t);
+  if (Peephole)
+    peephole();
+}
+
+/**********************************************/
+/* the primary function of the code generator */
+/**********************************************/
+/* Procedure codeGen generates x86-64 code to the
+ * code file by traversal of the syntax tree. The
+ * second parameter (codefile) is the file name
+ * of the code file, and is used to print the
+ * file name as a comment in the code file
+ */
+void codeGen(TreeNode *syntaxTree, char *codefile) {
+  genProgram(syntaxTree);
+  fprintf(code, "# C- Compilation to x86-64 Code\n");
+  fprintf(code, "# File: %s\n", codefile);
+  writeCode(code);
+}
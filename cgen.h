@@ -0,0 +1,31 @@
+/****************************************************/
+/* File: cgen.h                                     */
+/* The code generator interface to the C- compiler  */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _CGEN_H_
+#define _CGEN_H_
+
+/* Procedure codeGen generates x86-64 code to the
+ * code file by traversal of the syntax tree. The
+ * second parameter (codefile) is the file name
+ * of the code file, and is used to print the
+ * file name as a comment in the code file
+ */
+void codeGen(TreeNode *syntaxTree, char *codefile);
+
+/* Procedure genProgram fills the instruction buffer
+ * of code.h with x86-64 code for the syntax tree,
+ * without writing it out
+ */
+void genProgram(TreeNode *syntaxTree);
+
+/* Procedure genDecl appends the code of the
+ * top-level declaration t to the instruction
+ * buffer; with ReleaseScopes it then releases the
+ * scopes of a function
+ */
+void genDecl(TreeNode *t);
+
+#endif
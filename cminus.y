@@ -1,22 +1,62 @@
 %{
 
+/* built with -DRD_PARSER, the parser is the one of
+ * rdparse.c: the tables and yyparse that Bison
+ * generates are left out below, and the token codes
+ * come from cminus.tab.h as in the other files
+ */
+#ifndef RD_PARSER
 #define YYPARSER /* distinguishes Yacc output from other code files */
+#endif
 
 #include "globals.h"
 #include "util.h"
 #include "scan.h"
 #include "parse.h"
+#include "pool.h"
+#include "rdparse.h"
+#include "scanpipe.h"
 
 #define YYSTYPE TreeNode *
-static char *savedName; /* for use in assignments */
-static int savedNumber;
-static int savedLineNo;  /* ditto */
-static TreeNode *savedTree; /* stores syntax tree for later return */
-static int yylex(void);
+
+/* the parser state is per thread, so that the parts
+ * of a program can be parsed concurrently
+ */
+static __thread char *savedName; /* for use in assignments */
+static __thread int savedNumber;
+static __thread int savedLineNo;  /* ditto */
+static __thread int savedColNo;   /* ditto */
+static __thread TreeNode *savedTree; /* stores syntax tree for later return */
+static __thread int savedToken;  /* last token read, for yyerror */
+static int yylex(YYSTYPE *lvalp);
 int yyerror(char *message);
 
+/* a part of the program parsed by parseChunks */
+typedef struct {
+  char *text;
+  size_t len;
+  int lineno, colno; /* where the text starts */
+  TreeNode *tree;
+  void *arena;
+  int tokens;
+  int failed;
+} Chunk;
+
+/* the chunk parsed by the current thread, NULL when
+ * the whole program is parsed at once
+ */
+static __thread Chunk *chunk = NULL;
+
+/* the handler of the top-level declarations given
+ * to parseStream, NULL when the tree is built
+ */
+static void (*compileDecl)(TreeNode *) = NULL;
+
+#ifndef RD_PARSER
 %}
 
+%define api.pure full
+
 %token IF ELSE WHILE INT VOID RETURN
 %token ID NUM
 %token ASSIGN EQ NEQ LT LET GT GET PLUS MINUS TIMES OVER COMMA LPAREN RPAREN LBRACKET RBRACKET LBRACE RBRACE SEMI
@@ -30,7 +70,11 @@ program     : decl_list { savedTree = $1; }
 decl_list   : decl_list decl
               {
                 YYSTYPE t = $1;
-                if(t != NULL){
+                if (compileDecl != NULL) {
+                  compileDecl($2);
+                  $$ = NULL;
+                }
+                else if(t != NULL){
                   while(t->sibling != NULL)
                     t = t->sibling;
                   t->sibling = $2;
@@ -39,7 +83,15 @@ decl_list   : decl_list decl
                 else
                   $$ = $2;
               }
-            | decl { $$ = $1; }
+            | decl
+              {
+                if (compileDecl != NULL) {
+                  compileDecl($1);
+                  $$ = NULL;
+                }
+                else
+                  $$ = $1;
+              }
             ;
 
 decl        : var_decl  { $$ = $1; }
@@ -50,6 +102,7 @@ save_name   : ID
               {
                 savedName = copyString(tokenString);
                 savedLineNo = lineno;
+                savedColNo = tokenColumn;
               }
             ;
 
@@ -66,6 +119,7 @@ var_decl    : type save_name SEMI
                 $$->child[0] = $1;
                 $$->lineno = lineno;
                 $$->attr.name = savedName;
+                $$->colno = savedColNo;
               }
             | type save_name LBRACKET save_number RBRACKET SEMI
               {
@@ -73,6 +127,7 @@ var_decl    : type save_name SEMI
                 $$->child[0] = $1;
                 $$->lineno = lineno;
                 $$->attr.vector.name = savedName;
+                $$->colno = savedColNo;
                 $$->attr.vector.size = savedNumber;
               }
             ;
@@ -94,6 +149,7 @@ func_decl   : type save_name
                 $$ = newDeclNode(FuncK);
                 $$->lineno = lineno;
                 $$->attr.name = savedName;
+                $$->colno = savedColNo;
               }
               LPAREN params RPAREN comp_stmt
               {
@@ -131,12 +187,16 @@ param       : type save_name
                 $$ = newParamNode(NonVectorParamK);
                 $$->child[0] = $1;
                 $$->attr.name = savedName;
+                $$->colno = savedColNo;
+                $$->lineno = savedLineNo;
               }
             | type save_name LBRACKET RBRACKET
               {
                 $$ = newParamNode(VectorParamK);
                 $$->child[0] = $1;
                 $$->attr.name = savedName;
+                $$->colno = savedColNo;
+                $$->lineno = savedLineNo;
               }
             | /* empty */ { $$ = NULL; }
             ;
@@ -239,11 +299,15 @@ var         : save_name
               {
                 $$ = newExpNode(IdK);
                 $$->attr.name = savedName;
+                $$->colno = savedColNo;
+                $$->lineno = savedLineNo;
               }
             | save_name
               {
                 $$ = newExpNode(VectorIdK);
                 $$->attr.name = savedName;
+                $$->colno = savedColNo;
+                $$->lineno = savedLineNo;
               }
               LBRACKET expression RBRACKET
               {
@@ -352,6 +416,8 @@ call_func   : save_name
               {
                 $$ = newExpNode(CallK);
                 $$->attr.name = savedName;
+                $$->colno = savedColNo;
+                $$->lineno = savedLineNo;
               }
               LPAREN args RPAREN
               {
@@ -382,23 +448,267 @@ arg_list    : arg_list COMMA expression
 
 %%
 
+#endif /* RD_PARSER */
+
 int yyerror(char * message) {
-  fprintf(listing, "Syntax error at line %d: %s\n", lineno, message);
-  fprintf(listing, "Current token: ");
-  printToken(yychar, tokenString);
+  /* a failed chunk is parsed again as part of the
+   * whole program, which reports the error
+   */
+  if (chunk != NULL) {
+    chunk->failed = TRUE;
+    return 0;
+  }
+  if (JsonListing) {
+    fprintf(listing, "{\"type\": \"error\", \"phase\": \"syntax\", \"line\": %d, \"message\": ",
+            lineno);
+    printJsonString(listing, message);
+    fprintf(listing, ", \"token\": ");
+    printJsonString(listing, tokenString);
+    fprintf(listing, "}\n");
+  }
+  else {
+    fprintf(listing, "Syntax error at line %d: %s\n", lineno, message);
+    fprintf(listing, "Current token: ");
+    printToken(savedToken, tokenString);
+  }
   Error = TRUE;
   return 0;
 }
 
+/* the tokens come from the scanner thread of
+ * scanpipe.c while runParser runs it
+ */
+static __thread int piped = FALSE;
+
 /* yylex calls getToken to make Yacc/Bison output
  * compatible with ealier versions of the C- scanner
  */
-static int yylex(void) {
-  return getToken();
+static int yylex(YYSTYPE *lvalp) {
+  savedToken = piped ? pipedToken() : getToken();
+  return savedToken;
 }
 
-TreeNode * parse(void) {
-  yyparse();
+#ifdef RD_PARSER
+/* the drivers below run the recursive-descent parser
+ * of rdparse.c, which reads its tokens through yylex
+ * as well
+ */
+static int rdLex(void) {
+  return yylex(NULL);
+}
+
+#define yyparse() rdParse(rdLex, compileDecl, &savedTree)
+#endif
+
+/* the pre-scan cuts the program into about
+ * CHUNKSPERJOB chunks per thread, none of them
+ * smaller than MINCHUNK bytes
+ */
+#define CHUNKSPERJOB 4
+#define MINCHUNK 4096
+
+/* Function splitDecls cuts the len bytes of text
+ * into chunks of whole top-level declarations: a
+ * declaration ends at a ';' or '}' outside every
+ * brace and parenthesis. Comments are skipped, and
+ * a last chunk of only blanks and comments goes
+ * with the one before it. It returns the number of
+ * chunks, or 0 if the braces or parentheses do not
+ * balance
+ */
+static int splitDecls(char *text, size_t len, Chunk *chunks, int maxChunks) {
+  size_t target = len / maxChunks, start = 0, i;
+  int braces = 0, parens = 0, n = 0;
+  int code = FALSE;   /* the chunk has more than blanks */
+  int line = 1, col = 1;
+
+  if (target < MINCHUNK)
+    target = MINCHUNK;
+  chunks[0].text = text;
+  chunks[0].lineno = chunks[0].colno = 1;
+  for (i = 0; i < len; ++i) {
+    char c = text[i];
+    if (c == '/' && i + 1 < len && text[i + 1] == '*') {
+      for (i += 2, col += 2; i + 1 < len && (text[i] != '*' || text[i + 1] != '/'); ++i)
+        if (text[i] == '\n') {
+          line++;
+          col = 1;
+        }
+        else
+          col++;
+      if (i + 1 >= len)
+        return 0;
+      i++;
+      col += 2;
+      continue;
+    }
+    if (c == '\n') {
+      line++;
+      col = 1;
+      continue;
+    }
+    col++;
+    if (!isspace((unsigned char) c))
+      code = TRUE;
+    if (c == '{')
+      braces++;
+    else if (c == '}')
+      braces--;
+    else if (c == '(')
+      parens++;
+    else if (c == ')')
+      parens--;
+    if (braces < 0 || parens < 0)
+      return 0;
+    if ((c == ';' || c == '}') && braces == 0 && parens == 0 &&
+        i + 1 - start >= target && n + 1 < maxChunks) {
+      chunks[n].len = i + 1 - start;
+      start = i + 1;
+      ++n;
+      chunks[n].text = text + start;
+      chunks[n].lineno = line;
+      chunks[n].colno = col;
+      code = FALSE;
+    }
+  }
+  if (braces != 0 || parens != 0)
+    return 0;
+  if (!code && n > 0) {
+    /* nothing to parse after the last cut */
+    --n;
+    start = chunks[n].text - text;
+  }
+  chunks[n].len = len - start;
+  return n + 1;
+}
+
+/* Procedure parseChunk parses chunk i on its own
+ * scanner and parser; the tree stays in the arena
+ * of the chunk until parseChunks splices it in
+ */
+static void parseChunk(int i, void *arg) {
+  Chunk *c = &((Chunk *) arg)[i];
+  FILE *savedSource = source;
+
+  chunk = c;
+  source = fmemopen(c->text, c->len, "r");
+  if (source == NULL)
+    c->failed = TRUE;
+  else {
+    resetScannerAt(c->lineno, c->colno);
+    savedTree = NULL;
+    if (yyparse() != 0)
+      c->failed = TRUE;
+    c->tree = savedTree;
+    c->tokens = tokenCount;
+    fclose(source);
+  }
+  c->arena = detachArena();
+  freeScanner();
+  source = savedSource;
+  chunk = NULL;
+}
+
+/* Function runParser runs yyparse over the source
+ * file, with the scanner on a thread of its own
+ * when Pipeline is set
+ */
+static int runParser(void) {
+  int result;
+
+  piped = Pipeline && startScanPipe();
+  result = yyparse();
+  if (piped)
+    stopScanPipe();
+  piped = FALSE;
+  return result;
+}
+
+/* Function parseAll parses the whole source file */
+static TreeNode *parseAll(void) {
+  savedTree = NULL;
+  runParser();
   return savedTree;
 }
 
+/* Function parseChunks reads the whole source
+ * file, parses its chunks on Jobs threads and
+ * links their declaration lists in source order. If
+ * the program cannot be split or a chunk has a
+ * syntax error, the program is parsed at once
+ */
+static TreeNode *parseChunks(void) {
+  char *text = NULL;
+  size_t len = 0, cap = 0, got;
+  Chunk *chunks;
+  TreeNode *tree = NULL, *last = NULL;
+  FILE *savedSource = source;
+  int n, i, failed = FALSE, tokens = 0;
+
+  do {
+    if (cap - len < 65536) {
+      cap = cap ? 2 * cap : 1 << 20;
+      text = (char *) realloc(text, cap);
+    }
+    got = fread(text + len, 1, cap - len, source);
+    len += got;
+  } while (got > 0);
+
+  chunks = (Chunk *) calloc(Jobs * CHUNKSPERJOB, sizeof(Chunk));
+  n = len > 0 ? splitDecls(text, len, chunks, Jobs * CHUNKSPERJOB) : 0;
+  if (n > 1) {
+    parallelFor(n, Jobs, parseChunk, chunks);
+    for (i = 0; i < n; ++i) {
+      attachArena(chunks[i].arena);
+      failed |= chunks[i].failed || chunks[i].tree == NULL;
+      tokens += chunks[i].tokens;
+    }
+  }
+  if (n > 1 && !failed) {
+    for (i = 0; i < n; ++i) {
+      if (last == NULL)
+        tree = chunks[i].tree;
+      else
+        last->sibling = chunks[i].tree;
+      for (last = chunks[i].tree; last->sibling != NULL; last = last->sibling)
+        ;
+    }
+    /* every chunk counted its own end of file */
+    tokenCount = tokens - (n - 1);
+  }
+  else if (len > 0 && (source = fmemopen(text, len, "r")) != NULL) {
+    resetScanner();
+    lineno = 0;
+    tree = parseAll();
+    fclose(source);
+    source = savedSource;
+  }
+  else {
+    source = savedSource;
+    tree = parseAll();
+  }
+  free(chunks);
+  free(text);
+  return tree;
+}
+
+/* Function parseStream parses the source file
+ * without building the syntax tree: each top-level
+ * declaration is passed to handler as soon as it is
+ * reduced. It returns FALSE on a syntax error
+ */
+int parseStream(void (*handler)(TreeNode *)) {
+  int ok;
+
+  compileDecl = handler;
+  savedTree = NULL;
+  ok = runParser() == 0;
+  compileDecl = NULL;
+  return ok;
+}
+
+TreeNode * parse(void) {
+  if (Jobs > 1 && !TraceScan)
+    return parseChunks();
+  return parseAll();
+}
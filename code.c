@@ -0,0 +1,482 @@
+/****************************************************/
+/* File: code.c                                     */
+/* x86-64 code emitting utilities                   */
+/* implementation for the C- compiler               */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include "globals.h"
+#include "code.h"
+
+Instr *codeBuf = NULL;
+int codeLen = 0;
+static int codeCap = 0;
+
+GlobalVar *globalVars = NULL;
+int nGlobalVars = 0;
+static int globalCap = 0;
+
+int emitLineno = 0;
+
+static int labelCount = 0;
+
+/* C- identifiers are mangled with SYMPREFIX so that
+ * they cannot clash with the C library or the runtime
+ */
+#define SYMPREFIX "cm_"
+
+/* SYMSIZE is the size of the assembler name table */
+#define SYMSIZE 211
+
+typedef struct SymNameRec {
+  char *name;
+  struct SymNameRec *next;
+} *SymName;
+
+static SymName symNames[SYMSIZE];
+
+static const char *regName64[] = {
+  "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+  "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+};
+
+static const char *regName32[] = {
+  "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+  "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"
+};
+
+static const char *regName8[] = {
+  "al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+  "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"
+};
+
+static const char *condName[] = { "e", "ne", "l", "le", "g", "ge", "b", "ae" };
+
+Operand opReg(Reg r) {
+  Operand o;
+  memset(&o, 0, sizeof(o));
+  o.kind = OpdReg;
+  o.reg = r;
+  o.index = NOREG;
+  return o;
+}
+
+Operand opImm(long val) {
+  Operand o;
+  memset(&o, 0, sizeof(o));
+  o.kind = OpdImm;
+  o.reg = o.index = NOREG;
+  o.val = val;
+  return o;
+}
+
+Operand opMem(Reg base, long disp) {
+  return opIndex(base, NOREG, 1, disp);
+}
+
+Operand opIndex(Reg base, Reg index, int scale, long disp) {
+  Operand o;
+  memset(&o, 0, sizeof(o));
+  o.kind = OpdMem;
+  o.reg = base;
+  o.index = index;
+  o.scale = scale;
+  o.val = disp;
+  return o;
+}
+
+Operand opGlobal(const char *sym) {
+  Operand o = opMem(NOREG, 0);
+  o.sym = sym;
+  return o;
+}
+
+Operand opSym(const char *sym) {
+  Operand o;
+  memset(&o, 0, sizeof(o));
+  o.kind = OpdSym;
+  o.reg = o.index = NOREG;
+  o.sym = sym;
+  return o;
+}
+
+Operand opLabel(int label) {
+  Operand o;
+  memset(&o, 0, sizeof(o));
+  o.kind = OpdLabel;
+  o.reg = o.index = NOREG;
+  o.label = label;
+  return o;
+}
+
+Operand opVec(int n) {
+  Operand o;
+  memset(&o, 0, sizeof(o));
+  o.kind = OpdVec;
+  o.reg = (Reg) n;
+  o.index = NOREG;
+  return o;
+}
+
+CondCode negateCond(CondCode cc) {
+  switch (cc) {
+    case CondE:  return CondNE;
+    case CondNE: return CondE;
+    case CondL:  return CondGE;
+    case CondLE: return CondG;
+    case CondG:  return CondLE;
+    case CondB:  return CondAE;
+    case CondAE: return CondB;
+    default:     return CondL;
+  }
+}
+
+Operand opNone(void) {
+  Operand o;
+  memset(&o, 0, sizeof(o));
+  o.kind = OpdNone;
+  o.reg = o.index = NOREG;
+  return o;
+}
+
+/* Function asmName returns the assembler symbol
+ * for the C- identifier name
+ */
+const char *asmName(const char *name) {
+  int h = 0;
+  int i;
+  SymName s;
+
+  for (i = 0; name[i] != '\0'; ++i)
+    h = ((h << 4) + name[i]) % SYMSIZE;
+  for (s = symNames[h]; s != NULL; s = s->next)
+    if (strcmp(s->name + strlen(SYMPREFIX), name) == 0)
+      return s->name;
+
+  s = (SymName) malloc(sizeof(struct SymNameRec));
+  s->name = (char *) malloc(strlen(SYMPREFIX) + strlen(name) + 1);
+  strcpy(s->name, SYMPREFIX);
+  strcat(s->name, name);
+  s->next = symNames[h];
+  symNames[h] = s;
+  return s->name;
+}
+
+const char *sourceName(const char *sym) {
+  if (strncmp(sym, SYMPREFIX, strlen(SYMPREFIX)) != 0)
+    return NULL;
+  return sym + strlen(SYMPREFIX);
+}
+
+/* Procedure codeReset empties the instruction
+ * buffer and the list of global variables
+ */
+void codeReset(void) {
+  int i;
+  for (i = 0; i < SYMSIZE; ++i) {
+    while (symNames[i] != NULL) {
+      SymName next = symNames[i]->next;
+      free(symNames[i]->name);
+      free(symNames[i]);
+      symNames[i] = next;
+    }
+  }
+  codeLen = 0;
+  nGlobalVars = 0;
+  labelCount = 0;
+  emitLineno = 0;
+}
+
+/* Function emit appends an instruction to the
+ * buffer and returns a pointer to it
+ */
+Instr *emit(InstrOp op, int size, Operand dst, Operand src) {
+  Instr *in;
+  if (codeLen == codeCap) {
+    codeCap = codeCap ? 2 * codeCap : 1024;
+    codeBuf = (Instr *) realloc(codeBuf, codeCap * sizeof(Instr));
+    if (codeBuf == NULL) {
+      fprintf(stderr, "Out of memory while generating code\n");
+      exit(1);
+    }
+  }
+  in = &codeBuf[codeLen++];
+  in->op = op;
+  in->size = size;
+  in->cc = CondE;
+  in->dst = dst;
+  in->src = src;
+  in->lineno = emitLineno;
+  return in;
+}
+
+void emitJmp(int label) {
+  emit(I_JMP, 8, opLabel(label), opNone());
+}
+
+void emitJcc(CondCode cc, int label) {
+  emit(I_JCC, 8, opLabel(label), opNone())->cc = cc;
+}
+
+/* Function newLabel returns a fresh local label */
+int newLabel(void) {
+  return labelCount++;
+}
+
+/* Procedure emitLabel defines label at the current position */
+void emitLabel(int label) {
+  emit(I_LABEL, 0, opLabel(label), opNone());
+}
+
+/* Procedure emitFunction starts the global function name */
+void emitFunction(const char *name) {
+  emit(I_FUNC, 0, opSym(name), opNone());
+}
+
+/* Procedure emitGlobal reserves size bytes for
+ * the global variable name
+ */
+void emitGlobal(const char *name, int size) {
+  if (nGlobalVars == globalCap) {
+    globalCap = globalCap ? 2 * globalCap : 64;
+    globalVars = (GlobalVar *) realloc(globalVars, globalCap * sizeof(GlobalVar));
+    if (globalVars == NULL) {
+      fprintf(stderr, "Out of memory while generating code\n");
+      exit(1);
+    }
+  }
+  globalVars[nGlobalVars].name = name;
+  globalVars[nGlobalVars].size = size;
+  nGlobalVars++;
+}
+
+static void writeReg(FILE *out, Reg r, int size) {
+  switch (size) {
+    case 1: fprintf(out, "%%%s", regName8[r]);  break;
+    case 4: fprintf(out, "%%%s", regName32[r]); break;
+    default: fprintf(out, "%%%s", regName64[r]); break;
+  }
+}
+
+static void writeOperand(FILE *out, Operand o, int size) {
+  switch (o.kind) {
+    case OpdReg:
+      writeReg(out, o.reg, size);
+      break;
+    case OpdImm:
+      fprintf(out, "$%ld", o.val);
+      break;
+    case OpdMem:
+      if (o.sym != NULL) {
+        if (o.val != 0)
+          fprintf(out, "%s%+ld(%%rip)", o.sym, o.val);
+        else
+          fprintf(out, "%s(%%rip)", o.sym);
+        break;
+      }
+      if (o.val != 0)
+        fprintf(out, "%ld", o.val);
+      fprintf(out, "(");
+      if (o.reg != NOREG)
+        writeReg(out, o.reg, 8);
+      if (o.index != NOREG) {
+        fprintf(out, ",");
+        writeReg(out, o.index, 8);
+        fprintf(out, ",%d", o.scale);
+      }
+      fprintf(out, ")");
+      break;
+    case OpdSym:
+      fprintf(out, "%s", o.sym);
+      break;
+    case OpdLabel:
+      fprintf(out, ".L%d", o.label);
+      break;
+    case OpdVec:
+      fprintf(out, "%%%cmm%d", size == 32 ? 'y' : 'x', o.reg);
+      break;
+    default:
+      break;
+  }
+}
+
+/* writeBinary prints a two-operand instruction
+ * in AT&T order (source first)
+ */
+static void writeBinary(FILE *out, const char *name, Instr *in) {
+  fprintf(out, "\t%s%c\t", name, in->size == 8 ? 'q' : 'l');
+  writeOperand(out, in->src, in->size);
+  fprintf(out, ", ");
+  writeOperand(out, in->dst, in->size);
+  fprintf(out, "\n");
+}
+
+/* writeVector prints a vector instruction: the SSE2
+ * form is name src, dst and the AVX2 form, with the
+ * v prefix, vname src, dst, dst
+ */
+static void writeVector(FILE *out, const char *name, Instr *in) {
+  fprintf(out, "\t%s%s\t", in->size == 32 ? "v" : "", name);
+  writeOperand(out, in->src, in->size);
+  if (in->size == 32 && in->op != I_VMOV) {
+    fprintf(out, ", ");
+    writeOperand(out, in->dst, in->size);
+  }
+  fprintf(out, ", ");
+  writeOperand(out, in->dst, in->size);
+  fprintf(out, "\n");
+}
+
+static void writeInstr(FILE *out, Instr *in) {
+  switch (in->op) {
+    case I_MOV:  writeBinary(out, "mov", in);  break;
+    case I_LEA:  writeBinary(out, "lea", in);  break;
+    case I_ADD:  writeBinary(out, "add", in);  break;
+    case I_SUB:  writeBinary(out, "sub", in);  break;
+    case I_AND:  writeBinary(out, "and", in);  break;
+    case I_IMUL: writeBinary(out, "imul", in); break;
+    case I_CMP:  writeBinary(out, "cmp", in);  break;
+    case I_TEST: writeBinary(out, "test", in); break;
+    case I_MOVSX:
+      fprintf(out, "\tmovslq\t");
+      writeOperand(out, in->src, 4);
+      fprintf(out, ", ");
+      writeOperand(out, in->dst, 8);
+      fprintf(out, "\n");
+      break;
+    case I_MOVZB:
+      fprintf(out, "\tmovzbl\t");
+      writeOperand(out, in->src, 1);
+      fprintf(out, ", ");
+      writeOperand(out, in->dst, 4);
+      fprintf(out, "\n");
+      break;
+    case I_CDQ:
+      fprintf(out, "\tcltd\n");
+      break;
+    case I_IDIV:
+      fprintf(out, "\tidiv%c\t", in->size == 8 ? 'q' : 'l');
+      writeOperand(out, in->dst, in->size);
+      fprintf(out, "\n");
+      break;
+    case I_SETCC:
+      fprintf(out, "\tset%s\t", condName[in->cc]);
+      writeOperand(out, in->dst, 1);
+      fprintf(out, "\n");
+      break;
+    case I_PUSH:
+      fprintf(out, "\tpushq\t");
+      writeOperand(out, in->dst, 8);
+      fprintf(out, "\n");
+      break;
+    case I_POP:
+      fprintf(out, "\tpopq\t");
+      writeOperand(out, in->dst, 8);
+      fprintf(out, "\n");
+      break;
+    case I_JMP:
+      fprintf(out, "\tjmp\t");
+      writeOperand(out, in->dst, 8);
+      fprintf(out, "\n");
+      break;
+    case I_JCC:
+      fprintf(out, "\tj%s\t", condName[in->cc]);
+      writeOperand(out, in->dst, 8);
+      fprintf(out, "\n");
+      break;
+    case I_CALL:
+      fprintf(out, "\tcall\t");
+      writeOperand(out, in->dst, 8);
+      fprintf(out, "\n");
+      break;
+    case I_RET:
+      fprintf(out, "\tret\n");
+      break;
+    case I_LEAVE:
+      fprintf(out, "\tleave\n");
+      break;
+    case I_LABEL:
+      fprintf(out, ".L%d:\n", in->dst.label);
+      break;
+    case I_FUNC:
+      fprintf(out, "\n\t.globl\t%s\n", in->dst.sym);
+      fprintf(out, "\t.type\t%s, @function\n", in->dst.sym);
+      fprintf(out, "%s:\n", in->dst.sym);
+      break;
+    case I_VMOV:
+      writeVector(out, in->src.kind == OpdVec && in->dst.kind == OpdVec ?
+                  "movdqa" : "movdqu", in);
+      break;
+    case I_VADD:      writeVector(out, "paddd", in);     break;
+    case I_VSUB:      writeVector(out, "psubd", in);     break;
+    case I_VMUL:      writeVector(out, "pmulld", in);    break;
+    case I_PMULUDQ:   writeVector(out, "pmuludq", in);   break;
+    case I_PUNPCKLDQ: writeVector(out, "punpckldq", in); break;
+    case I_PSRLQ:     writeVector(out, "psrlq", in);     break;
+    case I_PSHUFD:
+      fprintf(out, "\tpshufd\t$%ld, ", in->src.val);
+      writeOperand(out, in->dst, 16);
+      fprintf(out, ", ");
+      writeOperand(out, in->dst, 16);
+      fprintf(out, "\n");
+      break;
+    case I_MOVD:
+      fprintf(out, "\t%smovd\t", in->size == 32 ? "v" : "");
+      writeOperand(out, in->src, 4);
+      fprintf(out, ", ");
+      writeOperand(out, in->dst, 16);
+      fprintf(out, "\n");
+      break;
+    case I_VBROADCAST:
+      fprintf(out, "\tvpbroadcastd\t");
+      writeOperand(out, in->src, 16);
+      fprintf(out, ", ");
+      writeOperand(out, in->dst, 32);
+      fprintf(out, "\n");
+      break;
+    case I_VZEROUPPER:
+      fprintf(out, "\tvzeroupper\n");
+      break;
+    default:
+      fprintf(out, "\t# unknown instruction %d\n", in->op);
+      break;
+  }
+}
+
+/* Procedure writeText prints the instructions of
+ * the buffer as GNU assembler text
+ */
+void writeText(FILE *out) {
+  int i;
+  int lastLine = -1;
+
+  for (i = 0; i < codeLen; ++i) {
+    Instr *in = &codeBuf[i];
+    if (TraceCode && in->lineno != lastLine && in->op != I_FUNC) {
+      fprintf(out, "\t# line %d\n", in->lineno);
+      lastLine = in->lineno;
+    }
+    writeInstr(out, in);
+  }
+}
+
+/* Procedure writeData prints the global variables
+ * and the end of the assembler file
+ */
+void writeData(FILE *out) {
+  int i;
+
+  for (i = 0; i < nGlobalVars; ++i)
+    fprintf(out, "\t.comm\t%s,%d,8\n", globalVars[i].name, globalVars[i].size);
+
+  fprintf(out, "\t.section\t.note.GNU-stack,\"\",@progbits\n");
+}
+
+/* Procedure writeCode prints the buffer as GNU
+ * assembler text to the code file
+ */
+void writeCode(FILE *out) {
+  fprintf(out, "\t.text\n");
+  writeText(out);
+  writeData(out);
+}
@@ -0,0 +1,161 @@
+/****************************************************/
+/* File: code.h                                     */
+/* Code emitting utilities for the C- compiler      */
+/* and interface to the x86-64 instruction buffer   */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _CODE_H_
+#define _CODE_H_
+
+/* x86-64 general purpose registers, in
+ * hardware encoding order
+ */
+typedef enum {
+  RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+  R8, R9, R10, R11, R12, R13, R14, R15,
+  NOREG
+} Reg;
+
+/* condition codes used by jcc and setcc; CondB and
+ * CondAE compare unsigned
+ */
+typedef enum { CondE, CondNE, CondL, CondLE, CondG, CondGE, CondB, CondAE } CondCode;
+
+typedef enum {
+  OpdNone,  /* no operand */
+  OpdReg,   /* register */
+  OpdImm,   /* immediate value */
+  OpdMem,   /* disp(base,index,scale) or sym(%rip) */
+  OpdSym,   /* function symbol (call target) */
+  OpdLabel, /* local code label */
+  OpdVec    /* vector register %xmm0-15 (%ymm0-15), number in reg */
+} OperandKind;
+
+typedef struct {
+  OperandKind kind;
+  Reg reg;          /* register, or base of a memory operand */
+  Reg index;        /* index of a memory operand, NOREG if none */
+  int scale;        /* scale factor applied to index */
+  long val;         /* immediate value or displacement */
+  const char *sym;  /* symbol name (RIP-relative when kind is OpdMem) */
+  int label;        /* label number for OpdLabel */
+} Operand;
+
+typedef enum {
+  I_MOV, I_MOVSX, I_MOVZB, I_LEA,
+  I_ADD, I_SUB, I_AND, I_IMUL, I_CDQ, I_IDIV, I_CMP, I_TEST, I_SETCC,
+  I_PUSH, I_POP, I_JMP, I_JCC, I_CALL, I_RET, I_LEAVE,
+  I_LABEL,   /* pseudo instruction: defines a local label */
+  I_FUNC,    /* pseudo instruction: starts a global function */
+  /* packed 32-bit integer instructions: movdqu (movdqa
+   * between registers), paddd, psubd, pmulld (AVX2
+   * only), the pmuludq, psrlq, pshufd and punpckldq
+   * that stand for pmulld in SSE2, movd from a 32-bit
+   * register, vpbroadcastd (AVX2 only) and vzeroupper;
+   * psrlq and pshufd take their immediate as src and
+   * pshufd shuffles dst in place
+   */
+  I_VMOV, I_VADD, I_VSUB, I_VMUL,
+  I_PMULUDQ, I_PSRLQ, I_PSHUFD, I_PUNPCKLDQ,
+  I_MOVD, I_VBROADCAST, I_VZEROUPPER
+} InstrOp;
+
+typedef struct {
+  InstrOp op;
+  int size;        /* operand size in bytes (1, 4 or 8); for
+                    * vector instructions 16 (SSE2, %xmm) or
+                    * 32 (AVX2, %ymm) */
+  CondCode cc;     /* condition for I_JCC and I_SETCC */
+  Operand dst;
+  Operand src;
+  int lineno;      /* source line that produced the instruction */
+} Instr;
+
+/* global variables reserved by emitGlobal */
+typedef struct {
+  const char *name;
+  int size;
+} GlobalVar;
+
+/* the instruction buffer filled by the code generator */
+extern Instr *codeBuf;
+extern int codeLen;
+
+extern GlobalVar *globalVars;
+extern int nGlobalVars;
+
+/* emitLineno is stamped on every emitted instruction */
+extern int emitLineno;
+
+/* Function negateCond returns the condition that
+ * holds exactly when cc does not
+ */
+CondCode negateCond(CondCode cc);
+
+/* operand constructors */
+Operand opNone(void);
+Operand opReg(Reg r);
+Operand opImm(long val);
+Operand opMem(Reg base, long disp);
+Operand opIndex(Reg base, Reg index, int scale, long disp);
+Operand opGlobal(const char *sym);
+Operand opSym(const char *sym);
+Operand opLabel(int label);
+Operand opVec(int n);
+
+/* Function asmName returns the assembler symbol
+ * for the C- identifier name
+ */
+const char *asmName(const char *name);
+
+/* Function sourceName returns the C- identifier
+ * of the assembler symbol sym, or NULL if sym is
+ * not the name of a C- identifier
+ */
+const char *sourceName(const char *sym);
+
+/* Procedure codeReset empties the instruction
+ * buffer and the list of global variables
+ */
+void codeReset(void);
+
+/* Function emit appends an instruction to the
+ * buffer and returns a pointer to it
+ */
+Instr *emit(InstrOp op, int size, Operand dst, Operand src);
+
+/* Procedures emitJmp and emitJcc emit an
+ * unconditional or conditional jump to label
+ */
+void emitJmp(int label);
+void emitJcc(CondCode cc, int label);
+
+/* Function newLabel returns a fresh local label */
+int newLabel(void);
+
+/* Procedure emitLabel defines label at the current position */
+void emitLabel(int label);
+
+/* Procedure emitFunction starts the global function name */
+void emitFunction(const char *name);
+
+/* Procedure emitGlobal reserves size bytes for
+ * the global variable name
+ */
+void emitGlobal(const char *name, int size);
+
+/* Procedure writeCode prints the buffer as GNU
+ * assembler text to the code file
+ */
+void writeCode(FILE *out);
+
+/* writeCode in parts, for code written one function
+ * at a time: writeText prints the instructions of
+ * the buffer, and writeData the global variables
+ * and the end of the file
+ */
+void writeText(FILE *out);
+void writeData(FILE *out);
+
+#endif
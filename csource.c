@@ -0,0 +1,522 @@
+/****************************************************/
+/* File: csource.c                                  */
+/* The C source generator for the C- compiler       */
+/* (writes the checked syntax tree as a C program   */
+/* for the host C compiler)                         */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "symtab.h"
+#include "analyze.h"
+#include "code.h"
+#include "callgraph.h"
+#include "intrinsic.h"
+#include "csource.h"
+
+/* C- identifiers are written with the names asmName
+ * gives them, so that they cannot clash with the
+ * keywords and library functions of C, and the
+ * temporaries are named cm_t1, cm_t2, ..., which no
+ * C- identifier can be
+ */
+
+/* the file the C text goes to: the code file, or
+ * the buffer of the function being written
+ */
+static FILE *out;
+
+/* indentation of the statement being written */
+static int indent;
+
+/* the temporaries used by the function being written */
+static int nTemps;
+
+/* the last top-level declaration written was a variable */
+static int afterVar;
+
+/* prototypes for internal recursive writers */
+static void emitExp(TreeNode *tree, int paren);
+static void emitStmt(TreeNode *tree);
+
+static void startLine(void) {
+  fprintf(out, "%*s", 2 * indent, "");
+}
+
+/* Function needsCheck tells if the VectorIdK node
+ * tree indexes an array declared with a size by an
+ * index that checkBounds could not prove, which
+ * --bounds-check checks at run time
+ */
+static int needsCheck(TreeNode *tree) {
+  return BoundsCheck && !tree->inBounds &&
+         st_bucket(tree->attr.name)->treeNode->nodekind == DeclK;
+}
+
+/* Function hasEffects tells if evaluating the
+ * expression tree may assign a variable, call a
+ * function or stop the program on a bounds check
+ */
+static int hasEffects(TreeNode *tree) {
+  int i;
+
+  if (tree == NULL)
+    return FALSE;
+  switch (tree->kind.exp) {
+    case AssignK:
+    case CallK:
+      return TRUE;
+    case VectorIdK:
+      if (needsCheck(tree))
+        return TRUE;
+      break;
+    default:
+      break;
+  }
+  for (i = 0; i < MAXCHILDREN; ++i)
+    if (hasEffects(tree->child[i]))
+      return TRUE;
+  return FALSE;
+}
+
+/* Function assigns tells if the expression tree
+ * assigns the variable or an element of the array
+ * called name
+ */
+static int assigns(TreeNode *tree, const char *name) {
+  TreeNode *arg;
+  int i;
+
+  if (tree == NULL)
+    return FALSE;
+  if (tree->kind.exp == AssignK && strcmp(tree->child[0]->attr.name, name) == 0)
+    return TRUE;
+  if (tree->kind.exp == CallK) {
+    for (arg = tree->child[0]; arg != NULL; arg = arg->sibling)
+      if (assigns(arg, name))
+        return TRUE;
+    return FALSE;
+  }
+  for (i = 0; i < MAXCHILDREN; ++i)
+    if (assigns(tree->child[i], name))
+      return TRUE;
+  return FALSE;
+}
+
+/* Function isFixed tells if the expression tree has
+ * the same value wherever it is evaluated: a
+ * constant or the address of an array
+ */
+static int isFixed(TreeNode *tree) {
+  return tree->kind.exp == ConstK ||
+         (tree->kind.exp == IdK && tree->type == IntegerArray);
+}
+
+/* C- evaluates the operands of an operator and the
+ * arguments of a call left to right, while C leaves
+ * their order unspecified. Function hoist evaluates
+ * into temporaries, in a comma expression, each of
+ * the n operands ops whose value an operand after
+ * it could change or that could change one; temp[i]
+ * is set to the number of the temporary of operand
+ * i, or to 0. It returns TRUE if it opened the comma
+ * expression
+ */
+static int hoist(TreeNode **ops, int n, int *temp) {
+  int laterEffects = FALSE, laterVaries = FALSE;
+  int open = FALSE;
+  int i;
+
+  for (i = n - 1; i >= 0; --i) {
+    int effects = hasEffects(ops[i]);
+    temp[i] = !isFixed(ops[i]) && (laterEffects || (effects && laterVaries));
+    laterEffects |= effects;
+    laterVaries |= !isFixed(ops[i]);
+  }
+  for (i = 0; i < n; ++i)
+    if (temp[i]) {
+      temp[i] = ++nTemps;
+      fprintf(out, open ? "cm_t%d = " : "(cm_t%d = ", temp[i]);
+      emitExp(ops[i], FALSE);
+      fprintf(out, ", ");
+      open = TRUE;
+    }
+  return open;
+}
+
+/* Procedure emitOperand writes the operand tree of
+ * an operator, or its temporary temp; an array
+ * stands for its address truncated to 32 bits, as
+ * in the x86-64 code
+ */
+static void emitOperand(TreeNode *tree, int temp) {
+  if (temp > 0)
+    fprintf(out, "cm_t%d", temp);
+  else if (tree->type == IntegerArray) {
+    fprintf(out, "(int) (long) ");
+    emitExp(tree, TRUE);
+  }
+  else
+    emitExp(tree, TRUE);
+}
+
+/* Procedure emitIndex writes the index of the
+ * VectorIdK node tree, checked if it needs to be
+ */
+static void emitIndex(TreeNode *tree) {
+  if (needsCheck(tree)) {
+    fprintf(out, "cm_check_index(");
+    emitExp(tree->child[0], FALSE);
+    fprintf(out, ", %d, %d)", st_bucket(tree->attr.name)->treeNode->attr.vector.size,
+            tree->lineno);
+  }
+  else
+    emitExp(tree->child[0], FALSE);
+}
+
+static const char *opText(TokenType op) {
+  switch (op) {
+    case EQ:  return "==";
+    case NEQ: return "!=";
+    case LT:  return "<";
+    case LET: return "<=";
+    case GT:  return ">";
+    case GET: return ">=";
+    default:  return "/";
+  }
+}
+
+static void emitOp(TreeNode *tree, int paren) {
+  TreeNode *ops[2];
+  int temp[2];
+  int open;
+
+  ops[0] = tree->child[0];
+  ops[1] = tree->child[1];
+  open = hoist(ops, 2, temp);
+  switch (tree->attr.op) {
+    /* + - and * wrap around, see cSourceHeader */
+    case PLUS:
+    case MINUS:
+    case TIMES:
+      fprintf(out, "%s(", tree->attr.op == PLUS ? "CM_ADD" :
+                          tree->attr.op == MINUS ? "CM_SUB" : "CM_MUL");
+      emitOperand(ops[0], temp[0]);
+      fprintf(out, ", ");
+      emitOperand(ops[1], temp[1]);
+      fprintf(out, ")");
+      break;
+    default:
+      if (paren && !open)
+        fprintf(out, "(");
+      emitOperand(ops[0], temp[0]);
+      fprintf(out, " %s ", opText(tree->attr.op));
+      emitOperand(ops[1], temp[1]);
+      if (paren && !open)
+        fprintf(out, ")");
+      break;
+  }
+  if (open)
+    fprintf(out, ")");
+}
+
+/* Procedure emitAssign writes the AssignK node tree.
+ * The index of an array element is evaluated first
+ * when the value could change it or stop the
+ * program, and the value is when it assigns the
+ * same variable, which C would leave undefined
+ */
+static void emitAssign(TreeNode *tree, int paren) {
+  TreeNode *var = tree->child[0];
+  TreeNode *value = tree->child[1];
+  int index = 0, temp = 0;
+  int open = FALSE;
+
+  if (var->kind.exp == VectorIdK) {
+    int check = needsCheck(var);
+    if ((check || !isFixed(var->child[0])) &&
+        (hasEffects(value) || (hasEffects(var->child[0]) && !isFixed(value)))) {
+      index = ++nTemps;
+      fprintf(out, "(cm_t%d = ", index);
+      emitIndex(var);
+      fprintf(out, ", ");
+      open = TRUE;
+    }
+  }
+  if (assigns(value, var->attr.name)) {
+    temp = ++nTemps;
+    fprintf(out, open ? "cm_t%d = " : "(cm_t%d = ", temp);
+    emitExp(value, FALSE);
+    fprintf(out, ", ");
+    open = TRUE;
+  }
+  if (paren && !open)
+    fprintf(out, "(");
+  fprintf(out, "%s", asmName(var->attr.name));
+  if (var->kind.exp == VectorIdK) {
+    fprintf(out, "[");
+    if (index > 0)
+      fprintf(out, "cm_t%d", index);
+    else
+      emitIndex(var);
+    fprintf(out, "]");
+  }
+  fprintf(out, " = ");
+  if (temp > 0)
+    fprintf(out, "cm_t%d", temp);
+  else
+    emitExp(value, FALSE);
+  if (open || paren)
+    fprintf(out, ")");
+}
+
+/* Procedure emitCall writes the CallK node tree; the
+ * built-in functions call their runtime routines
+ */
+static void emitCall(TreeNode *tree) {
+  const Intrinsic *in = intrinsic(tree->attr.name);
+  TreeNode *arg;
+  TreeNode **args;
+  int *temp;
+  int nargs = 0;
+  int open, i;
+
+  for (arg = tree->child[0]; arg != NULL; arg = arg->sibling)
+    ++nargs;
+  args = (TreeNode **) malloc((nargs + 1) * sizeof(TreeNode *));
+  temp = (int *) malloc((nargs + 1) * sizeof(int));
+  for (arg = tree->child[0], i = 0; arg != NULL; arg = arg->sibling, ++i)
+    args[i] = arg;
+  open = hoist(args, nargs, temp);
+  fprintf(out, "%s(", in != NULL ? in->routine : asmName(tree->attr.name));
+  for (i = 0; i < nargs; ++i) {
+    if (i > 0)
+      fprintf(out, ", ");
+    if (temp[i] > 0)
+      fprintf(out, "cm_t%d", temp[i]);
+    else
+      emitExp(args[i], FALSE);
+  }
+  fprintf(out, open ? "))" : ")");
+  free(args);
+  free(temp);
+}
+
+/* Procedure emitExp writes the expression tree;
+ * paren tells if it is the operand of an operator,
+ * which needs the expressions with operators in
+ * parentheses
+ */
+static void emitExp(TreeNode *tree, int paren) {
+  switch (tree->kind.exp) {
+    case ConstK:
+      /* the constants of --fold may be negative */
+      if (tree->attr.val == INT_MIN)
+        fprintf(out, "(-%d - 1)", INT_MAX);
+      else if (tree->attr.val < 0)
+        fprintf(out, "(%d)", tree->attr.val);
+      else
+        fprintf(out, "%d", tree->attr.val);
+      break;
+    case IdK:
+      fprintf(out, "%s", asmName(tree->attr.name));
+      break;
+    case VectorIdK:
+      fprintf(out, "%s[", asmName(tree->attr.name));
+      emitIndex(tree);
+      fprintf(out, "]");
+      break;
+    case AssignK:
+      emitAssign(tree, paren);
+      break;
+    case OpK:
+      emitOp(tree, paren);
+      break;
+    case CallK:
+      emitCall(tree);
+      break;
+    default:
+      break;
+  }
+}
+
+/* Procedure emitVar writes the variable declaration tree */
+static void emitVar(TreeNode *tree) {
+  startLine();
+  if (tree->kind.decl == VectorVarK)
+    fprintf(out, "int %s[%d];\n", asmName(tree->attr.vector.name), tree->attr.vector.size);
+  else
+    fprintf(out, "int %s;\n", asmName(tree->attr.name));
+}
+
+/* Procedure emitBlock writes the declarations and
+ * statements of the compound statement tree,
+ * without its braces
+ */
+static void emitBlock(TreeNode *tree) {
+  TreeNode *t;
+
+  sc_push(tree->attr.scope);
+  for (t = tree->child[0]; t != NULL; t = t->sibling)
+    emitVar(t);
+  for (t = tree->child[1]; t != NULL; t = t->sibling)
+    emitStmt(t);
+  sc_pop();
+}
+
+/* Procedure emitBody writes the statement tree, if
+ * any, in braces, as the body of an if or while
+ */
+static void emitBody(TreeNode *tree) {
+  fprintf(out, " {\n");
+  ++indent;
+  if (tree != NULL && tree->nodekind == StmtK && tree->kind.stmt == CompK)
+    emitBlock(tree);
+  else if (tree != NULL)
+    emitStmt(tree);
+  --indent;
+  startLine();
+  fprintf(out, "}\n");
+}
+
+static void emitStmt(TreeNode *tree) {
+  startLine();
+  if (tree->nodekind == ExpK) {
+    emitExp(tree, FALSE);
+    fprintf(out, ";\n");
+    return;
+  }
+  switch (tree->kind.stmt) {
+    case CompK:
+      fprintf(out, "{\n");
+      ++indent;
+      emitBlock(tree);
+      --indent;
+      startLine();
+      fprintf(out, "}\n");
+      break;
+    case IfK:
+      fprintf(out, "if (");
+      emitExp(tree->child[0], FALSE);
+      fprintf(out, ")");
+      emitBody(tree->child[1]);
+      if (tree->child[2] != NULL) {
+        startLine();
+        fprintf(out, "else");
+        emitBody(tree->child[2]);
+      }
+      break;
+    case WhileK:
+      fprintf(out, "while (");
+      emitExp(tree->child[0], FALSE);
+      fprintf(out, ")");
+      emitBody(tree->child[1]);
+      break;
+    case ReturnK:
+      if (tree->child[0] != NULL) {
+        fprintf(out, "return ");
+        emitExp(tree->child[0], FALSE);
+        fprintf(out, ";\n");
+      }
+      else
+        fprintf(out, "return;\n");
+      break;
+    default:
+      break;
+  }
+}
+
+/* Procedure emitFunc writes the function declaration
+ * tree; its body goes to a buffer first, to learn
+ * the temporaries it needs
+ */
+static void emitFunc(TreeNode *tree) {
+  TreeNode *param;
+  char *text = NULL;
+  size_t len = 0;
+  int i;
+
+  out = open_memstream(&text, &len);
+  nTemps = 0;
+  indent = 1;
+  emitBlock(tree->child[2]);
+  fclose(out);
+  out = code;
+
+  if (afterVar)
+    fprintf(out, "\n");
+  fprintf(out, "%s %s(", tree->child[0]->attr.type == INT ? "int" : "void",
+          asmName(tree->attr.name));
+  if (tree->child[1] == NULL)
+    fprintf(out, "void");
+  for (param = tree->child[1]; param != NULL; param = param->sibling)
+    fprintf(out, "%s%s%s", param == tree->child[1] ? "" : ", ",
+            param->kind.param == VectorParamK ? "int *" : "int ", asmName(param->attr.name));
+  fprintf(out, ")\n{\n");
+  for (i = 1; i <= nTemps; ++i)
+    fprintf(out, "  int cm_t%d;\n", i);
+  fwrite(text, 1, len, out);
+  fprintf(out, "}\n\n");
+  free(text);
+}
+
+void cSourceHeader(char *codefile) {
+  fprintf(code, "/* C- Compilation to C */\n");
+  fprintf(code, "/* File: %s */\n\n", codefile);
+  fprintf(code, "/* the runtime of runtime/cminus_rt.h */\n");
+  fprintf(code, "int cminus_input(void);\n");
+  fprintf(code, "void cminus_output(int x);\n");
+  fprintf(code, "void cminus_bounds_error(int line);\n\n");
+  fprintf(code, "/* the arithmetic of C- wraps around */\n");
+  fprintf(code, "#define CM_ADD(a, b) ((int) ((unsigned) (a) + (unsigned) (b)))\n");
+  fprintf(code, "#define CM_SUB(a, b) ((int) ((unsigned) (a) - (unsigned) (b)))\n");
+  fprintf(code, "#define CM_MUL(a, b) ((int) ((unsigned) (a) * (unsigned) (b)))\n");
+  if (BoundsCheck) {
+    fprintf(code, "\nstatic int cm_check_index(int i, int size, int line)\n{\n");
+    fprintf(code, "  if ((unsigned) i >= (unsigned) size)\n");
+    fprintf(code, "    cminus_bounds_error(line);\n");
+    fprintf(code, "  return i;\n}\n");
+  }
+  fprintf(code, "\n");
+  afterVar = FALSE;
+}
+
+void cSourceDecl(TreeNode *t) {
+  if (t->nodekind != DeclK)
+    return;
+  out = code;
+  indent = 0;
+  sc_push(globalScope);
+  switch (t->kind.decl) {
+    case FuncK:
+      if (intrinsic(t->attr.name) == NULL &&
+          (Prune == NoPrune || cg_reachable(t))) {
+        emitFunc(t);
+        afterVar = FALSE;
+      }
+      if (ReleaseScopes)
+        releaseScopes(t);
+      break;
+    case VarK:
+    case VectorVarK:
+      emitVar(t);
+      afterVar = TRUE;
+      break;
+    default:
+      break;
+  }
+  sc_pop();
+}
+
+/**********************************************/
+/* the primary function of the C generator    */
+/**********************************************/
+void cSourceGen(TreeNode *syntaxTree, char *codefile) {
+  TreeNode *t;
+
+  codeReset();
+  cSourceHeader(codefile);
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    cSourceDecl(t);
+}
@@ -0,0 +1,29 @@
+/****************************************************/
+/* File: csource.h                                  */
+/* The C source generator interface to the C-       */
+/* compiler                                         */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _CSOURCE_H_
+#define _CSOURCE_H_
+
+/* Procedure cSourceGen writes the syntax tree to
+ * the code file as a C program, to be built by the
+ * host C compiler with runtime/libcminus_rt.a. The
+ * second parameter (codefile) is the file name of
+ * the code file, and is printed in its header
+ */
+void cSourceGen(TreeNode *syntaxTree, char *codefile);
+
+/* cSourceGen in parts, for code written one
+ * declaration at a time: cSourceHeader writes the
+ * declarations every C program starts with, and
+ * cSourceDecl the top-level declaration t; with
+ * ReleaseScopes it then releases the scopes of a
+ * function
+ */
+void cSourceHeader(char *codefile);
+void cSourceDecl(TreeNode *t);
+
+#endif
@@ -0,0 +1,523 @@
+/****************************************************/
+/* File: fold.c                                     */
+/* Compile-time evaluation of the calls of pure     */
+/* functions for the C- compiler: a purity analysis */
+/* over the call graph and an interpreter over the  */
+/* checked syntax tree                              */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include <limits.h>
+#include "globals.h"
+#include "symtab.h"
+#include "util.h"
+#include "callgraph.h"
+#include "intrinsic.h"
+#include "fold.h"
+
+/* MAXCALLDEPTH bounds the calls nested in one
+ * evaluation, so that a deep recursion cannot
+ * overflow the stack of the compiler
+ */
+#define MAXCALLDEPTH 1000
+
+/* the value of a variable never assigned */
+#define UNSET LONG_MIN
+
+/* the variables of the activations being run,
+ * innermost first; an array parameter shares the
+ * cells of the array passed to it
+ */
+typedef struct BindingRec {
+  BucketList var;
+  long *cells;
+  int size;
+  int owned;
+  struct BindingRec *next;
+} *Binding;
+
+/* the outcome of running a statement */
+typedef enum { RunNext, RunReturn, RunFail } RunResult;
+
+static Binding env;
+static long fuel;
+static int callDepth;
+static const char *why; /* why the evaluation gave up */
+static int nFolded;
+
+static int isCall(TreeNode *t) {
+  return t->nodekind == ExpK && t->kind.exp == CallK;
+}
+
+/* Function callee returns the declaration of the
+ * function called by the CallK node t, or NULL
+ */
+static TreeNode *callee(TreeNode *t) {
+  BucketList l = st_bucket(t->attr.name);
+  TreeNode *decl = l != NULL ? l->treeNode : NULL;
+
+  if (intrinsic(t->attr.name) != NULL || decl == NULL ||
+      decl->nodekind != DeclK || decl->kind.decl != FuncK || decl->callNode == NULL)
+    return NULL;
+  return decl;
+}
+
+/********************************************/
+/*             Purity analysis              */
+/********************************************/
+
+/* Function usesNoGlobals tells if the tree list t
+ * uses no global variable and calls no built-in
+ * function
+ */
+static int usesNoGlobals(TreeNode *t) {
+  BucketList l;
+  int i, ok = TRUE;
+
+  for (; t != NULL && ok; t = t->sibling) {
+    if (t->nodekind == StmtK && t->kind.stmt == CompK) {
+      sc_push(t->attr.scope);
+      ok = usesNoGlobals(t->child[1]);
+      sc_pop();
+      continue;
+    }
+    if (t->nodekind == ExpK) {
+      switch (t->kind.exp) {
+        case IdK:
+        case VectorIdK:
+          l = st_bucket(t->attr.name);
+          ok = l != NULL && l->scope != globalScope;
+          break;
+        case CallK:
+          ok = callee(t) != NULL;
+          break;
+        default:
+          break;
+      }
+    }
+    for (i = 0; i < MAXCHILDREN && ok; ++i)
+      ok = usesNoGlobals(t->child[i]);
+  }
+  return ok;
+}
+
+/* Procedure findPure marks the pure functions of
+ * the declaration list tree: each function that
+ * uses no global starts pure, and a function that
+ * calls one that is not is not pure either, until
+ * nothing changes
+ */
+static void findPure(TreeNode *tree) {
+  TreeNode *t;
+  CallNode n;
+  int changed, i;
+
+  for (t = tree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclK && t->kind.decl == FuncK && t->callNode != NULL) {
+      sc_push(t->child[2]->attr.scope);
+      t->callNode->pure = intrinsic(t->attr.name) == NULL && usesNoGlobals(t->child[2]);
+      sc_pop();
+    }
+  do {
+    changed = FALSE;
+    for (t = tree; t != NULL; t = t->sibling) {
+      if (t->nodekind != DeclK || t->kind.decl != FuncK || t->callNode == NULL ||
+          !t->callNode->pure)
+        continue;
+      n = t->callNode;
+      for (i = 0; i < n->nCalls; ++i)
+        if (!n->calls[i].callee->pure) {
+          n->pure = FALSE;
+          changed = TRUE;
+          break;
+        }
+    }
+  } while (changed);
+}
+
+/********************************************/
+/*               Interpreter                */
+/********************************************/
+
+static int fail(const char *reason) {
+  if (why == NULL)
+    why = reason;
+  return FALSE;
+}
+
+static void bind(BucketList var, long *cells, int size) {
+  Binding b = (Binding) malloc(sizeof(struct BindingRec));
+  int i;
+
+  b->var = var;
+  b->size = size;
+  b->owned = cells == NULL;
+  if (b->owned) {
+    cells = (long *) malloc(size * sizeof(long));
+    for (i = 0; i < size; ++i)
+      cells[i] = UNSET;
+  }
+  b->cells = cells;
+  b->next = env;
+  env = b;
+}
+
+/* Procedure unbind drops the bindings made since
+ * env was mark
+ */
+static void unbind(Binding mark) {
+  while (env != mark) {
+    Binding b = env;
+    env = b->next;
+    if (b->owned)
+      free(b->cells);
+    free(b);
+  }
+}
+
+/* Procedure bindLocals binds the variables of the
+ * declaration list t in the current scope
+ */
+static void bindLocals(TreeNode *t) {
+  for (; t != NULL; t = t->sibling) {
+    if (t->nodekind != DeclK)
+      continue;
+    if (t->kind.decl == VarK)
+      bind(st_bucket(t->attr.name), NULL, 1);
+    else if (t->kind.decl == VectorVarK)
+      bind(st_bucket(t->attr.vector.name), NULL, t->attr.vector.size);
+  }
+}
+
+/* Function lookup returns the binding of the
+ * variable named by the node t, or NULL
+ */
+static Binding lookup(TreeNode *t) {
+  BucketList l = st_bucket(t->attr.name);
+  Binding b;
+
+  for (b = env; b != NULL; b = b->next)
+    if (b->var == l)
+      return b;
+  return NULL;
+}
+
+/* wrap reduces v to a 32-bit integer, as the
+ * generated code does
+ */
+static long wrap(long v) {
+  return (long) (int) (unsigned) v;
+}
+
+static int eval(TreeNode *t, long *v);
+static RunResult run(TreeNode *t, long *v);
+
+/* Function evalIndex evaluates the index of the
+ * VectorIdK node t into *i and returns the binding
+ * of its array
+ */
+static Binding evalIndex(TreeNode *t, long *i) {
+  Binding b = lookup(t);
+
+  if (b == NULL) {
+    fail("uses a variable that is not constant");
+    return NULL;
+  }
+  if (!eval(t->child[0], i))
+    return NULL;
+  if (*i < 0 || *i >= b->size) {
+    fail("indexes outside an array");
+    return NULL;
+  }
+  return b;
+}
+
+static int evalOp(TreeNode *t, long *v) {
+  long a, b;
+
+  if (!eval(t->child[0], &a) || !eval(t->child[1], &b))
+    return FALSE;
+  switch (t->attr.op) {
+    case PLUS:  *v = wrap(a + b); break;
+    case MINUS: *v = wrap(a - b); break;
+    case TIMES: *v = wrap(a * b); break;
+    case OVER:
+      /* both trap in the generated code */
+      if (b == 0 || (a == INT_MIN && b == -1))
+        return fail("divides by zero or overflows");
+      *v = a / b;
+      break;
+    case EQ:    *v = a == b; break;
+    case NEQ:   *v = a != b; break;
+    case LT:    *v = a < b;  break;
+    case LET:   *v = a <= b; break;
+    case GT:    *v = a > b;  break;
+    default:    *v = a >= b; break;
+  }
+  return TRUE;
+}
+
+static int evalAssign(TreeNode *t, long *v) {
+  TreeNode *var = t->child[0];
+  Binding b;
+  long i = 0;
+
+  /* the index before the value, as in cgen.c */
+  if (var->kind.exp == VectorIdK)
+    b = evalIndex(var, &i);
+  else if ((b = lookup(var)) == NULL)
+    fail("uses a variable that is not constant");
+  if (b == NULL || !eval(t->child[1], v))
+    return FALSE;
+  b->cells[i] = *v;
+  return TRUE;
+}
+
+/* Function evalCall runs the call t of a pure
+ * function; the arguments are evaluated in the
+ * caller, left to right
+ */
+static int evalCall(TreeNode *t, long *v) {
+  TreeNode *decl = callee(t);
+  TreeNode *body, *param, *arg;
+  Binding mark, b;
+  RunResult r;
+  long *args;
+  Binding *arrays;
+  int n = 0, i, ok = TRUE;
+
+  if (decl == NULL || !decl->callNode->pure)
+    return fail("calls a function that is not pure");
+  if (callDepth == MAXCALLDEPTH)
+    return fail("recurses too deep");
+  for (arg = t->child[0]; arg != NULL; arg = arg->sibling)
+    ++n;
+  args = (long *) malloc((n + 1) * sizeof(long));
+  arrays = (Binding *) malloc((n + 1) * sizeof(Binding));
+  for (arg = t->child[0], param = decl->child[1], i = 0; arg != NULL && ok;
+       arg = arg->sibling, param = param->sibling, ++i) {
+    if (param->kind.param == VectorParamK) {
+      arrays[i] = lookup(arg);
+      ok = arrays[i] != NULL || fail("uses a variable that is not constant");
+    }
+    else
+      ok = eval(arg, &args[i]);
+  }
+
+  if (ok) {
+    body = decl->child[2];
+    mark = env;
+    sc_push(body->attr.scope);
+    for (param = decl->child[1], i = 0; param != NULL; param = param->sibling, ++i) {
+      if (param->kind.param == VectorParamK) {
+        b = arrays[i];
+        bind(st_bucket(param->attr.name), b->cells, b->size);
+      }
+      else {
+        bind(st_bucket(param->attr.name), NULL, 1);
+        env->cells[0] = args[i];
+      }
+    }
+    bindLocals(body->child[0]);
+    ++callDepth;
+    *v = UNSET;
+    r = run(body->child[1], v);
+    --callDepth;
+    unbind(mark);
+    sc_pop();
+    if (r == RunFail)
+      ok = FALSE;
+    else if (decl->child[0]->attr.type == VOID)
+      *v = 0;
+    else if (*v == UNSET)
+      ok = fail("returns no value");
+  }
+  free(args);
+  free(arrays);
+  return ok;
+}
+
+/* Function eval evaluates the expression t into *v;
+ * it returns FALSE when the evaluation gives up
+ */
+static int eval(TreeNode *t, long *v) {
+  Binding b;
+  long i;
+
+  if (--fuel < 0)
+    return fail("runs out of fuel");
+  switch (t->kind.exp) {
+    case ConstK:
+      *v = t->attr.val;
+      return TRUE;
+    case IdK:
+      if ((b = lookup(t)) == NULL)
+        return fail("uses a variable that is not constant");
+      if (b->cells[0] == UNSET)
+        return fail("reads a variable never assigned");
+      *v = b->cells[0];
+      return TRUE;
+    case VectorIdK:
+      if ((b = evalIndex(t, &i)) == NULL)
+        return FALSE;
+      if (b->cells[i] == UNSET)
+        return fail("reads a variable never assigned");
+      *v = b->cells[i];
+      return TRUE;
+    case OpK:
+      return evalOp(t, v);
+    case AssignK:
+      return evalAssign(t, v);
+    case CallK:
+      return evalCall(t, v);
+    default:
+      return fail("uses an unknown expression");
+  }
+}
+
+/* Function run runs the statement list t; a return
+ * statement leaves its value in *v
+ */
+static RunResult run(TreeNode *t, long *v) {
+  RunResult r = RunNext;
+  Binding mark;
+  long c;
+
+  for (; t != NULL && r == RunNext; t = t->sibling) {
+    if (--fuel < 0) {
+      fail("runs out of fuel");
+      return RunFail;
+    }
+    if (t->nodekind == ExpK) {
+      if (!eval(t, &c))
+        return RunFail;
+      continue;
+    }
+    switch (t->kind.stmt) {
+      case CompK:
+        mark = env;
+        sc_push(t->attr.scope);
+        bindLocals(t->child[0]);
+        r = run(t->child[1], v);
+        unbind(mark);
+        sc_pop();
+        break;
+      case IfK:
+        if (!eval(t->child[0], &c))
+          return RunFail;
+        r = run(c ? t->child[1] : t->child[2], v);
+        break;
+      case WhileK:
+        for (;;) {
+          if (!eval(t->child[0], &c))
+            return RunFail;
+          if (!c)
+            break;
+          if ((r = run(t->child[1], v)) != RunNext)
+            break;
+        }
+        break;
+      case ReturnK:
+        if (t->child[0] != NULL && !eval(t->child[0], v))
+          return RunFail;
+        r = RunReturn;
+        break;
+      default:
+        break;
+    }
+  }
+  return r;
+}
+
+/********************************************/
+/*                 Folding                  */
+/********************************************/
+
+static void printFolded(TreeNode *t, long v) {
+  if (JsonListing) {
+    fprintf(listing, "{\"type\": \"fold\", \"function\": ");
+    printJsonString(listing, t->attr.name);
+    fprintf(listing, ", \"line\": %d, \"value\": ", t->lineno);
+    if (why == NULL)
+      fprintf(listing, "%ld, \"why\": null}\n", v);
+    else {
+      fprintf(listing, "null, \"why\": ");
+      printJsonString(listing, why);
+      fprintf(listing, "}\n");
+    }
+  }
+  else if (why == NULL)
+    fprintf(listing, "Call of %s at line %d folded to %ld\n", t->attr.name, t->lineno, v);
+  else
+    fprintf(listing, "Call of %s at line %d not folded: %s\n", t->attr.name, t->lineno, why);
+}
+
+/* Procedure tryFold replaces the call t of a pure
+ * int function with constant arguments by its value
+ */
+static void tryFold(TreeNode *t) {
+  TreeNode *decl = callee(t);
+  TreeNode *arg;
+  long v;
+
+  if (decl == NULL || !decl->callNode->pure || t->type != Integer)
+    return;
+  env = NULL;
+  fuel = FoldFuel;
+  callDepth = 0;
+  why = NULL;
+  /* calls with arguments that are not constant are
+   * no candidates
+   */
+  for (arg = t->child[0]; arg != NULL; arg = arg->sibling)
+    if (!eval(arg, &v))
+      return;
+  fuel = FoldFuel;
+  if (evalCall(t, &v))
+    why = NULL;
+  if (FoldReport)
+    printFolded(t, v);
+  if (why == NULL) {
+    t->kind.exp = ConstK;
+    t->attr.val = (int) v;
+    t->child[0] = NULL;
+    ++nFolded;
+  }
+}
+
+/* Procedure foldTree folds the calls in the tree
+ * list t, the innermost first
+ */
+static void foldTree(TreeNode *t) {
+  int i;
+
+  for (; t != NULL; t = t->sibling) {
+    if (t->nodekind == StmtK && t->kind.stmt == CompK) {
+      sc_push(t->attr.scope);
+      foldTree(t->child[1]);
+      sc_pop();
+      continue;
+    }
+    for (i = 0; i < MAXCHILDREN; ++i)
+      foldTree(t->child[i]);
+    if (isCall(t))
+      tryFold(t);
+  }
+}
+
+void foldCalls(TreeNode *syntaxTree) {
+  TreeNode *t;
+
+  nFolded = 0;
+  sc_push(globalScope);
+  findPure(syntaxTree);
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclK && t->kind.decl == FuncK && t->child[2] != NULL &&
+        intrinsic(t->attr.name) == NULL)
+      foldTree(t->child[2]);
+  sc_pop();
+}
+
+int foldCount(void) {
+  return nFolded;
+}
@@ -0,0 +1,30 @@
+/****************************************************/
+/* File: fold.h                                     */
+/* Compile-time evaluation of the calls of pure     */
+/* functions for the C- compiler                    */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _FOLD_H_
+#define _FOLD_H_
+
+/* Procedure foldCalls finds the pure functions of
+ * the checked program syntaxTree, those that use no
+ * global variable, call no built-in function and
+ * call only pure functions, and replaces each call
+ * of a pure int function whose arguments are
+ * constant by a ConstK node with its result. The
+ * calls are run by an interpreter over the syntax
+ * tree that gives up, leaving the call alone, when
+ * the call evaluates more than FoldFuel nodes,
+ * divides by zero, indexes outside an array or
+ * reads a variable never assigned
+ */
+void foldCalls(TreeNode *syntaxTree);
+
+/* Function foldCount returns the number of calls
+ * replaced by the last foldCalls
+ */
+int foldCount(void);
+
+#endif
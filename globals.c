@@ -0,0 +1,80 @@
+/****************************************************/
+/* File: globals.c                                  */
+/* Global variables for the C- compiler, shared by  */
+/* the command line driver and the JIT library      */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include "globals.h"
+
+/* allocate global variables */
+__thread int lineno = 0;
+__thread FILE *source;
+FILE *listing;
+FILE *code;
+
+/* allocate and set tracing flags */
+int EchoSource   = FALSE;
+int TraceScan    = FALSE;
+int TraceParse   = FALSE;
+int TraceAnalyze = TRUE;
+int TraceCode    = FALSE;
+
+int Error        = FALSE;
+
+/* call graph listing and pruning, set by
+ * --dump-callgraph and --prune
+ */
+int DumpCallGraph = FALSE;
+PruneKind Prune = NoPrune;
+
+/* peephole optimizer, turned off by --no-peephole */
+int Peephole = TRUE;
+
+/* loop optimizations, set by --no-strength-reduce,
+ * --unroll and --loop-report
+ */
+int StrengthReduce = TRUE;
+int Unroll = 4;
+int LoopReport = FALSE;
+
+/* loop vectorization, set by --vectorize */
+VectorKind Vectorize = VectorSSE2;
+
+/* compile-time evaluation of pure calls, set by
+ * --no-fold, --fold-fuel and --fold-report
+ */
+int FoldCalls = TRUE;
+int FoldFuel = 100000;
+int FoldReport = FALSE;
+
+/* scope recycling, set by --release-scopes */
+int ReleaseScopes = FALSE;
+
+/* streaming compilation, set by --stream */
+int Stream = FALSE;
+
+/* execution profile, set by --profile */
+int Profile = FALSE;
+
+/* separate compilation, set by --interface */
+int Module = FALSE;
+
+/* JSON lines listing, set by --json */
+int JsonListing  = FALSE;
+
+/* parsing and type checking threads, set by --jobs */
+int Jobs = 1;
+
+/* scanner thread ahead of the parser, set by --pipeline */
+int Pipeline = FALSE;
+
+/* code generation target, set by --target */
+TargetKind Target = NoTarget;
+
+/* runtime array bounds checks, set by --bounds-check */
+int BoundsCheck = FALSE;
+
+/* compiler statistics, set by --time-report and --stats-json */
+int TimeReport = FALSE;
+char *StatsFile = NULL;
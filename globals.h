@@ -52,11 +52,14 @@
  */
 typedef int TokenType;
 
-extern FILE* source; /* source code text file */
+/* source and lineno are per thread, so that parts
+ * of a program can be parsed concurrently
+ */
+extern __thread FILE* source; /* source code text file */
 extern FILE* listing; /* listing output text file */
 extern FILE* code; /* code text file for TM simulator */
 
-extern int lineno; /* source line number for listing */
+extern __thread int lineno; /* source line number for listing */
 
 /**************************************************/
 /***********   Syntax tree for parsing ************/
@@ -82,11 +85,13 @@ typedef struct vectorAttr {
 #define MAXCHILDREN 3
 
 struct ScopeRec;
+struct CallNodeRec;
 
 typedef struct treeNode {
   struct treeNode *child[MAXCHILDREN];
   struct treeNode *sibling;
   int lineno;
+  int colno; /* column of the identifier of name nodes */
   NodeKind nodekind;
   union {
     StmtKind stmt;
@@ -106,6 +111,8 @@ typedef struct treeNode {
   } attr;
 
   ExpType type; /* for type checking of exps */
+  int inBounds; /* VectorIdK index proven within the array */
+  struct CallNodeRec *callNode; /* FuncK node in the call graph */
 } TreeNode;
 
 /**************************************************/
@@ -142,4 +149,136 @@ extern int TraceCode;
 
 /* Error = TRUE prevents further passes if an error occurs */
 extern int Error;
+
+/**************************************************/
+/***********   Code generation target  ************/
+/**************************************************/
+
+/* Target selects the code generator; NoTarget
+ * stops the compiler after semantic analysis,
+ * TargetJit runs the x86-64 code in-process and
+ * TargetC writes the program as C (see csource.h)
+ */
+typedef enum { NoTarget, TargetX86, TargetJit, TargetC } TargetKind;
+
+extern TargetKind Target;
+
+/* BoundsCheck = TRUE makes the generated code check
+ * every array index that the bounds analysis could
+ * not prove to be within the array
+ */
+extern int BoundsCheck;
+
+/* Prune skips the functions that main never calls:
+ * PruneCode generates no code for them and
+ * PruneCheck also skips their type and bounds checks
+ */
+typedef enum { NoPrune, PruneCode, PruneCheck } PruneKind;
+
+extern PruneKind Prune;
+
+/* DumpCallGraph = TRUE causes the call graph to be
+ * printed to the listing file after analysis
+ */
+extern int DumpCallGraph;
+
+/* Peephole = TRUE rewrites the generated code with
+ * the patterns of peephole.c before it is written
+ * or loaded
+ */
+extern int Peephole;
+
+/* StrengthReduce = TRUE keeps the address of the
+ * array elements indexed by the induction variable
+ * of a loop in a register that moves with it, and
+ * Unroll is the number of copies of the body of the
+ * loops with a small constant trip count (see
+ * loops.h); LoopReport = TRUE prints what was done
+ * to each loop to the listing file
+ */
+extern int StrengthReduce;
+extern int Unroll;
+extern int LoopReport;
+
+/* Vectorize selects the instructions of the loops
+ * that loops.c proves safe to run several elements
+ * at a time: VectorSSE2 runs 4 per iteration,
+ * VectorAVX2 8, and VectorNone keeps every loop
+ * scalar
+ */
+typedef enum { VectorNone, VectorSSE2, VectorAVX2 } VectorKind;
+
+extern VectorKind Vectorize;
+
+/* FoldCalls = TRUE replaces the calls of pure
+ * functions with constant arguments by their value,
+ * which an interpreter computes evaluating at most
+ * FoldFuel syntax tree nodes for each call (see
+ * fold.h); FoldReport = TRUE prints each call that
+ * was folded or given up to the listing file
+ */
+extern int FoldCalls;
+extern int FoldFuel;
+extern int FoldReport;
+
+/* ReleaseScopes = TRUE frees the scopes of each
+ * function as soon as its code is generated, so
+ * that the symbol table does not keep the blocks of
+ * the whole program
+ */
+extern int ReleaseScopes;
+
+/* Stream = TRUE compiles each top-level declaration
+ * as soon as it is parsed and then frees it, keeping
+ * only the global variables and the function
+ * signatures (see stream.h); it implies ReleaseScopes
+ */
+extern int Stream;
+
+/* Profile = TRUE runs the program in the JIT with a
+ * counter in every basic block and prints where its
+ * time went (see profile.h)
+ */
+extern int Profile;
+
+/* Module = TRUE compiles the file as one module of
+ * a program made of several: it need not declare
+ * main, and the global declarations it defines are
+ * written to its interface file, for the modules
+ * that import it and for the link step (see iface.h)
+ */
+extern int Module;
+
+/* JsonListing = TRUE makes diagnostics and the
+ * symbol table listing JSON lines, one object per
+ * error or symbol, instead of text
+ */
+extern int JsonListing;
+
+/* Jobs is the number of threads that parse and
+ * type check the top-level declarations; 1 handles
+ * them one at a time
+ */
+extern int Jobs;
+
+/* Pipeline = TRUE scans the source file on a thread
+ * of its own, which runs ahead of the parser and
+ * hands it the tokens in batches (see scanpipe.h)
+ */
+extern int Pipeline;
+
+/**************************************************/
+/***********   Compiler statistics     ************/
+/**************************************************/
+
+/* TimeReport = TRUE causes the time of each phase
+ * and the size of the program representations to be
+ * printed to stderr after compilation
+ */
+extern int TimeReport;
+
+/* StatsFile, if set, names a file to which the
+ * same report is written as JSON
+ */
+extern char *StatsFile;
 #endif
@@ -0,0 +1,486 @@
+/****************************************************/
+/* File: iface.c                                    */
+/* Module interface files of the C- compiler:      */
+/* writes the global declarations of a module,      */
+/* declares those of the modules it imports and     */
+/* links the code of the modules of a program       */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "intrinsic.h"
+#include "iface.h"
+
+/* an interface file read into memory */
+typedef struct {
+  const char *path;
+  char *image;
+  IfaceFileHeader *header;
+  IfaceFileSymbol *symbols;
+  IfaceFileParam *params;
+  char *strings;
+} Iface;
+
+/* the declarations of the loaded interfaces, built
+ * outside the tree arena; their names point into
+ * the images, which are never freed
+ */
+static TreeNode **imports = NULL;
+static const char **importFrom = NULL;
+static int nImports = 0, maxImports = 0;
+
+/********************************************/
+/*             Writing the file             */
+/********************************************/
+
+/* the records of the interface being written */
+static IfaceFileSymbol *symbols;
+static int nSymbols, maxSymbols;
+static IfaceFileParam *params;
+static int nParams, maxParams;
+static char *strings;
+static uint32_t stringsLen, stringsCap;
+
+static uint32_t addString(const char *name) {
+  uint32_t len = strlen(name) + 1;
+  uint32_t off = stringsLen;
+
+  if (stringsLen + len > stringsCap) {
+    stringsCap = 2 * (stringsLen + len);
+    strings = (char *) realloc(strings, stringsCap);
+  }
+  memcpy(strings + stringsLen, name, len);
+  stringsLen += len;
+  return off;
+}
+
+/* Procedure addSymbol adds the record of the global
+ * declaration decl to the interface
+ */
+static void addSymbol(TreeNode *decl, int imported) {
+  IfaceFileSymbol *s;
+  TreeNode *p;
+
+  if (nSymbols == maxSymbols) {
+    maxSymbols = maxSymbols ? 2 * maxSymbols : 16;
+    symbols = (IfaceFileSymbol *) realloc(symbols, maxSymbols * sizeof(IfaceFileSymbol));
+  }
+  s = &symbols[nSymbols++];
+  memset(s, 0, sizeof(*s));
+  s->imported = imported;
+  s->firstParam = nParams;
+  switch (decl->kind.decl) {
+    case FuncK:
+      s->name = addString(decl->attr.name);
+      s->kind = IfaceFunction;
+      s->type = decl->child[0]->attr.type;
+      for (p = decl->child[1]; p != NULL; p = p->sibling) {
+        if (nParams == maxParams) {
+          maxParams = maxParams ? 2 * maxParams : 16;
+          params = (IfaceFileParam *) realloc(params, maxParams * sizeof(IfaceFileParam));
+        }
+        params[nParams].name = addString(p->attr.name);
+        params[nParams].kind = p->kind.param;
+        ++nParams;
+        ++s->nParams;
+      }
+      break;
+    case VectorVarK:
+      s->name = addString(decl->attr.vector.name);
+      s->kind = IfaceArray;
+      s->type = INT;
+      s->size = decl->attr.vector.size;
+      break;
+    default:
+      s->name = addString(decl->attr.name);
+      s->kind = IfaceVariable;
+      s->type = INT;
+      break;
+  }
+}
+
+/* Function sameFile tells if the file path holds
+ * exactly the size bytes of image
+ */
+static int sameFile(const char *path, const char *image, long size) {
+  FILE *f = fopen(path, "rb");
+  char *old;
+  int same;
+
+  if (f == NULL)
+    return FALSE;
+  old = (char *) malloc(size + 1);
+  same = fread(old, 1, size + 1, f) == (size_t) size && memcmp(old, image, size) == 0;
+  free(old);
+  fclose(f);
+  return same;
+}
+
+void writeInterface(const char *path, TreeNode *syntaxTree) {
+  IfaceFileHeader header;
+  TreeNode *t;
+  BucketList l;
+  char *image;
+  FILE *out;
+  int i;
+
+  nSymbols = nParams = 0;
+  stringsLen = 0;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    if (t->nodekind == DeclK &&
+        (t->kind.decl != FuncK || intrinsic(t->attr.name) == NULL))
+      addSymbol(t, FALSE);
+  /* the imported declarations the module uses */
+  for (i = 0; i < nImports; ++i) {
+    t = imports[i];
+    sc_push(globalScope);
+    l = st_bucket(t->kind.decl == VectorVarK ? t->attr.vector.name : t->attr.name);
+    sc_pop();
+    if (l != NULL && l->treeNode == t && l->nUses > 0)
+      addSymbol(t, TRUE);
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, IFACE_MAGIC, sizeof(IFACE_MAGIC));
+  header.nSymbols = nSymbols;
+  header.nParams = nParams;
+  header.symbolsOff = sizeof(header);
+  header.paramsOff = header.symbolsOff + nSymbols * sizeof(IfaceFileSymbol);
+  header.stringsOff = header.paramsOff + nParams * sizeof(IfaceFileParam);
+  header.size = header.stringsOff + stringsLen;
+
+  image = (char *) malloc(header.size);
+  memcpy(image, &header, sizeof(header));
+  memcpy(image + header.symbolsOff, symbols, nSymbols * sizeof(IfaceFileSymbol));
+  memcpy(image + header.paramsOff, params, nParams * sizeof(IfaceFileParam));
+  memcpy(image + header.stringsOff, strings, stringsLen);
+  if (!sameFile(path, image, header.size)) {
+    out = fopen(path, "wb");
+    if (out == NULL) {
+      fprintf(stderr, "Unable to open %s\n", path);
+      exit(1);
+    }
+    fwrite(image, 1, header.size, out);
+    fclose(out);
+  }
+  free(image);
+}
+
+/********************************************/
+/*             Reading the file             */
+/********************************************/
+
+/* Function readIface reads the interface file path
+ * into f; it prints the error and returns FALSE if
+ * the file cannot be read or is not well formed
+ */
+static int readIface(const char *path, Iface *f) {
+  FILE *in = fopen(path, "rb");
+  IfaceFileHeader *h;
+  uint32_t stringsLen, i, j;
+  long size;
+
+  f->image = NULL;
+  if (in == NULL) {
+    fprintf(stderr, "File %s not found\n", path);
+    return FALSE;
+  }
+  fseek(in, 0, SEEK_END);
+  size = ftell(in);
+  fseek(in, 0, SEEK_SET);
+  f->path = path;
+  f->image = (char *) malloc(size > 0 ? size : 1);
+  if (size < (long) sizeof(IfaceFileHeader) || fread(f->image, 1, size, in) != (size_t) size) {
+    fclose(in);
+    fprintf(stderr, "%s is not an interface file\n", path);
+    return FALSE;
+  }
+  fclose(in);
+
+  h = f->header = (IfaceFileHeader *) f->image;
+  if (memcmp(h->magic, IFACE_MAGIC, sizeof(IFACE_MAGIC)) != 0 || h->size != size ||
+      h->symbolsOff != sizeof(IfaceFileHeader) ||
+      h->nSymbols > (uint32_t) size / sizeof(IfaceFileSymbol) ||
+      h->nParams > (uint32_t) size / sizeof(IfaceFileParam) ||
+      h->paramsOff != h->symbolsOff + h->nSymbols * sizeof(IfaceFileSymbol) ||
+      h->stringsOff != h->paramsOff + h->nParams * sizeof(IfaceFileParam) ||
+      h->stringsOff > h->size) {
+    fprintf(stderr, "%s is not an interface file\n", path);
+    return FALSE;
+  }
+  f->symbols = (IfaceFileSymbol *) (f->image + h->symbolsOff);
+  f->params = (IfaceFileParam *) (f->image + h->paramsOff);
+  f->strings = f->image + h->stringsOff;
+
+  /* every name must end inside the string area */
+  stringsLen = h->size - h->stringsOff;
+  if (stringsLen > 0 && f->strings[stringsLen - 1] != '\0')
+    stringsLen = 0;
+  for (i = 0; i < h->nSymbols; ++i) {
+    IfaceFileSymbol *s = &f->symbols[i];
+    int ok = s->name < stringsLen && s->kind <= IfaceArray &&
+             s->firstParam <= h->nParams && s->nParams <= h->nParams - s->firstParam &&
+             (s->kind == IfaceFunction ? s->type == INT || s->type == VOID
+                                       : s->type == INT && s->nParams == 0);
+    for (j = 0; ok && j < s->nParams; ++j)
+      ok = f->params[s->firstParam + j].name < stringsLen &&
+           f->params[s->firstParam + j].kind <= NonVectorParamK;
+    if (!ok) {
+      fprintf(stderr, "%s is not an interface file\n", path);
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+static const char *symName(Iface *f, IfaceFileSymbol *s) {
+  return f->strings + s->name;
+}
+
+/* Function buildDecl returns a declaration of the
+ * symbol s of the interface f, as the parser would
+ * have built it and the analyzer typed it
+ */
+static TreeNode *buildDecl(Iface *f, IfaceFileSymbol *s) {
+  TreeNode *t = (TreeNode *) calloc(1, sizeof(TreeNode));
+  TreeNode *p, **next;
+  uint32_t i;
+
+  t->nodekind = DeclK;
+  t->child[0] = &intType;
+  switch (s->kind) {
+    case IfaceFunction:
+      t->kind.decl = FuncK;
+      t->attr.name = (char *) symName(f, s);
+      if (s->type == VOID)
+        t->child[0] = &voidType;
+      t->type = s->type == VOID ? Void : Integer;
+      next = &t->child[1];
+      for (i = 0; i < s->nParams; ++i) {
+        IfaceFileParam *q = &f->params[s->firstParam + i];
+        p = (TreeNode *) calloc(1, sizeof(TreeNode));
+        p->nodekind = ParamK;
+        p->kind.param = (ParamKind) q->kind;
+        p->attr.name = f->strings + q->name;
+        p->child[0] = &intType;
+        p->type = q->kind == VectorParamK ? IntegerArray : Integer;
+        *next = p;
+        next = &p->sibling;
+      }
+      break;
+    case IfaceArray:
+      t->kind.decl = VectorVarK;
+      t->attr.vector.type = INT;
+      t->attr.vector.name = (char *) symName(f, s);
+      t->attr.vector.size = s->size;
+      t->type = IntegerArray;
+      break;
+    default:
+      t->kind.decl = VarK;
+      t->attr.name = (char *) symName(f, s);
+      t->type = Integer;
+      break;
+  }
+  return t;
+}
+
+static const char *declName(TreeNode *t) {
+  return t->kind.decl == VectorVarK ? t->attr.vector.name : t->attr.name;
+}
+
+int loadInterface(const char *path) {
+  Iface f;
+  IfaceFileSymbol *s;
+  uint32_t i;
+  int j;
+
+  if (!readIface(path, &f))
+    return FALSE;
+  for (i = 0; i < f.header->nSymbols; ++i) {
+    s = &f.symbols[i];
+    /* main is only called by the runtime */
+    if (s->imported || strcmp(symName(&f, s), "main") == 0)
+      continue;
+    for (j = 0; j < nImports; ++j)
+      if (strcmp(declName(imports[j]), symName(&f, s)) == 0) {
+        fprintf(stderr, "%s defines %s, already defined by %s\n",
+                path, symName(&f, s), importFrom[j]);
+        return FALSE;
+      }
+    if (nImports == maxImports) {
+      maxImports = maxImports ? 2 * maxImports : 16;
+      imports = (TreeNode **) realloc(imports, maxImports * sizeof(TreeNode *));
+      importFrom = (const char **) realloc(importFrom, maxImports * sizeof(char *));
+    }
+    imports[nImports] = buildDecl(&f, s);
+    importFrom[nImports] = path;
+    ++nImports;
+  }
+  return TRUE;
+}
+
+void insertImports(void) {
+  int i;
+  for (i = 0; i < nImports; ++i)
+    st_insert((char *) declName(imports[i]), NOLINE, addLocation(), imports[i]);
+}
+
+/********************************************/
+/*                 Linking                  */
+/********************************************/
+
+/* a definition of the program: symbol sym of the
+ * interface of module
+ */
+typedef struct {
+  int module;
+  IfaceFileSymbol *sym;
+} Definition;
+
+static unsigned hashName(const char *s) {
+  unsigned h = 0;
+  while (*s != '\0')
+    h = h * 31 + (unsigned char) *s++;
+  return h;
+}
+
+/* Function sameSymbol tells if the symbols x of
+ * interface a and y of interface b have the same
+ * kind and type
+ */
+static int sameSymbol(Iface *a, IfaceFileSymbol *x, Iface *b, IfaceFileSymbol *y) {
+  uint32_t i;
+
+  if (x->kind != y->kind || x->type != y->type || x->size != y->size ||
+      x->nParams != y->nParams)
+    return FALSE;
+  for (i = 0; i < x->nParams; ++i)
+    if (a->params[x->firstParam + i].kind != b->params[y->firstParam + i].kind)
+      return FALSE;
+  return TRUE;
+}
+
+/* Function copyCode appends the code file path to
+ * out, renaming each local label .Ln to .Lm_n so
+ * that the labels of module m are its own
+ */
+static int copyCode(FILE *out, const char *path, int m) {
+  FILE *in = fopen(path, "r");
+  int c, prev = '\n';
+
+  if (in == NULL) {
+    fprintf(stderr, "File %s not found\n", path);
+    return FALSE;
+  }
+  while ((c = getc(in)) != EOF) {
+    putc(c, out);
+    if (c == '.' && !isalnum(prev) && prev != '_') {
+      c = getc(in);
+      if (c == 'L') {
+        putc(c, out);
+        c = getc(in);
+        if (isdigit(c))
+          fprintf(out, "%d_", m);
+      }
+      if (c == EOF)
+        break;
+      putc(c, out);
+    }
+    prev = c;
+  }
+  fclose(in);
+  return TRUE;
+}
+
+int linkModules(const char *out, char **ifaces, char **codes, int n) {
+  Iface *mods = (Iface *) malloc(n * sizeof(Iface));
+  Definition *defs;
+  IfaceFileSymbol *s;
+  FILE *code;
+  int nDefs = 0, cap, ok = TRUE, hasMain = FALSE;
+  int i, h;
+  uint32_t k;
+
+  for (i = 0; i < n; ++i) {
+    if (!readIface(ifaces[i], &mods[i])) {
+      while (i >= 0)
+        free(mods[i--].image);
+      free(mods);
+      return FALSE;
+    }
+    nDefs += mods[i].header->nSymbols;
+  }
+
+  /* the definitions, by name */
+  cap = 2 * nDefs + 1;
+  defs = (Definition *) calloc(cap, sizeof(Definition));
+  for (i = 0; i < n; ++i)
+    for (k = 0; k < mods[i].header->nSymbols; ++k) {
+      s = &mods[i].symbols[k];
+      if (s->imported)
+        continue;
+      if (strcmp(symName(&mods[i], s), "main") == 0)
+        hasMain = TRUE;
+      h = hashName(symName(&mods[i], s)) % cap;
+      while (defs[h].sym != NULL &&
+             strcmp(symName(&mods[defs[h].module], defs[h].sym), symName(&mods[i], s)) != 0)
+        h = (h + 1) % cap;
+      if (defs[h].sym != NULL) {
+        fprintf(stderr, "link: %s is defined by %s and %s\n",
+                symName(&mods[i], s), mods[defs[h].module].path, mods[i].path);
+        ok = FALSE;
+        continue;
+      }
+      defs[h].module = i;
+      defs[h].sym = s;
+    }
+  if (!hasMain) {
+    fprintf(stderr, "link: no module defines main\n");
+    ok = FALSE;
+  }
+
+  /* every use must find the definition it was
+   * compiled against
+   */
+  for (i = 0; i < n; ++i)
+    for (k = 0; k < mods[i].header->nSymbols; ++k) {
+      s = &mods[i].symbols[k];
+      if (!s->imported)
+        continue;
+      h = hashName(symName(&mods[i], s)) % cap;
+      while (defs[h].sym != NULL &&
+             strcmp(symName(&mods[defs[h].module], defs[h].sym), symName(&mods[i], s)) != 0)
+        h = (h + 1) % cap;
+      if (defs[h].sym == NULL) {
+        fprintf(stderr, "link: %s uses %s, which no module defines\n",
+                mods[i].path, symName(&mods[i], s));
+        ok = FALSE;
+      }
+      else if (!sameSymbol(&mods[i], s, &mods[defs[h].module], defs[h].sym)) {
+        fprintf(stderr, "link: %s was compiled against another declaration of %s in %s\n",
+                mods[i].path, symName(&mods[i], s), mods[defs[h].module].path);
+        ok = FALSE;
+      }
+    }
+  free(defs);
+
+  if (ok) {
+    code = fopen(out, "w");
+    if (code == NULL) {
+      fprintf(stderr, "Unable to open %s\n", out);
+      ok = FALSE;
+    }
+    else {
+      for (i = 0; i < n && ok; ++i)
+        ok = copyCode(code, codes[i], i);
+      fclose(code);
+      if (!ok)
+        remove(out);
+    }
+  }
+  for (i = 0; i < n; ++i)
+    free(mods[i].image);
+  free(mods);
+  return ok;
+}
@@ -0,0 +1,93 @@
+/****************************************************/
+/* File: iface.h                                    */
+/* Module interface files of the C- compiler, for   */
+/* separate compilation                             */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _IFACE_H_
+#define _IFACE_H_
+
+#include <stdint.h>
+
+/* The interface file of a module lists the global
+ * functions and variables it defines, for the
+ * modules that import it, and those it uses from
+ * other modules, for the link step. It holds, in
+ * this order:
+ *
+ *   an IfaceFileHeader
+ *   nSymbols IfaceFileSymbol records: the
+ *     definitions in source order, then the uses
+ *   nParams IfaceFileParam records; the parameters
+ *     of a function are contiguous
+ *   the NUL-terminated names
+ *
+ * All fields are 32-bit integers in the byte order
+ * of the compiling machine, and every offset counts
+ * from the start of the file
+ */
+
+#define IFACE_MAGIC "CMIFAC1"
+
+typedef enum { IfaceFunction, IfaceVariable, IfaceArray } IfaceSymKind;
+
+typedef struct {
+  char magic[8];        /* IFACE_MAGIC */
+  uint32_t nSymbols;
+  uint32_t nParams;
+  uint32_t symbolsOff;
+  uint32_t paramsOff;
+  uint32_t stringsOff;
+  uint32_t size;        /* size of the whole file */
+} IfaceFileHeader;
+
+typedef struct {
+  uint32_t name;        /* offset of the symbol name */
+  uint32_t kind;        /* IfaceSymKind */
+  uint32_t type;        /* INT or VOID: return type of a function */
+  uint32_t size;        /* number of elements of an array */
+  uint32_t firstParam;  /* index of the first parameter */
+  uint32_t nParams;
+  uint32_t imported;    /* used by the module, defined by another */
+} IfaceFileSymbol;
+
+typedef struct {
+  uint32_t name;
+  uint32_t kind;        /* ParamKind of globals.h */
+} IfaceFileParam;
+
+/* Procedure writeInterface writes the interface of
+ * the module syntaxTree to the file path; a file
+ * that already holds the same interface is left
+ * untouched, so that the modules that import it
+ * need not be compiled again
+ */
+void writeInterface(const char *path, TreeNode *syntaxTree);
+
+/* Function loadInterface reads the interface file
+ * path, whose definitions insertImports declares
+ * in every compilation that follows; it prints
+ * the error and returns FALSE if the file is not
+ * a valid interface or defines a name that an
+ * interface loaded before also defines
+ */
+int loadInterface(const char *path);
+
+/* Procedure insertImports declares the definitions
+ * of the loaded interfaces in the current scope
+ */
+void insertImports(void);
+
+/* Function linkModules checks that the n modules,
+ * with interface files ifaces and code files codes,
+ * make one program: each name is defined once, one
+ * module defines main and every use agrees with its
+ * definition. It then writes their code to the file
+ * out, with the local labels renamed apart, and
+ * returns TRUE; otherwise it prints the errors to
+ * stderr and returns FALSE
+ */
+int linkModules(const char *out, char **ifaces, char **codes, int n);
+
+#endif
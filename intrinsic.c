@@ -0,0 +1,65 @@
+/****************************************************/
+/* File: intrinsic.c                                */
+/* Built-in functions of the C- compiler            */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "intrinsic.h"
+
+/* the prebuilt declarations of
+ *   int input(void)
+ *   void output(int x)
+ * they are shared by every compilation and never
+ * freed, so they are not part of the tree arena
+ */
+TreeNode intType  = { .nodekind = TypeK, .kind.type = TypeNameK, .attr.type = INT };
+TreeNode voidType = { .nodekind = TypeK, .kind.type = TypeNameK, .attr.type = VOID };
+
+static TreeNode outputParam = {
+  .child = { &intType }, .nodekind = ParamK, .kind.param = NonVectorParamK,
+  .attr.name = "x", .type = Integer
+};
+
+static TreeNode inputDecl = {
+  .child = { &intType, NULL, NULL }, .nodekind = DeclK, .kind.decl = FuncK,
+  .attr.name = "input", .type = Integer
+};
+
+static TreeNode outputDecl = {
+  .child = { &voidType, &outputParam, NULL }, .nodekind = DeclK, .kind.decl = FuncK,
+  .attr.name = "output", .type = Void
+};
+
+static const Intrinsic intrinsics[] = {
+  { "input",  "cminus_input",  &inputDecl },
+  { "output", "cminus_output", &outputDecl },
+  { NULL, NULL, NULL }
+};
+
+const Intrinsic *intrinsic(const char *name) {
+  int i;
+  for (i = 0; intrinsics[i].name != NULL; ++i)
+    if (strcmp(intrinsics[i].name, name) == 0)
+      return &intrinsics[i];
+  return NULL;
+}
+
+void insertIntrinsics(void) {
+  int i;
+  for (i = 0; intrinsics[i].name != NULL; ++i)
+    st_insert(intrinsics[i].decl->attr.name, NOLINE, addLocation(), intrinsics[i].decl);
+}
+
+int intrinsicMatches(const Intrinsic *in, TreeNode *t) {
+  TreeNode *p = t->child[1];
+  TreeNode *q = in->decl->child[1];
+
+  if (t->child[0]->attr.type != in->decl->child[0]->attr.type)
+    return FALSE;
+  for (; p != NULL && q != NULL; p = p->sibling, q = q->sibling)
+    if (p->kind.param != q->kind.param || p->child[0]->attr.type != q->child[0]->attr.type)
+      return FALSE;
+  return p == NULL && q == NULL;
+}
@@ -0,0 +1,52 @@
+/****************************************************/
+/* File: intrinsic.h                                */
+/* Built-in functions of the C- compiler            */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _INTRINSIC_H_
+#define _INTRINSIC_H_
+
+/* a built-in function: its declaration is a static
+ * syntax tree, entered in the global scope before
+ * the program, and the code generators lower its
+ * calls to the buffered runtime routine
+ */
+typedef struct {
+  const char *name;
+  const char *routine;  /* runtime routine, see runtime/cminus_rt.h */
+  TreeNode *decl;       /* prebuilt FuncK declaration */
+} Intrinsic;
+
+/* the type nodes int and void of the declarations
+ * built outside the tree arena, here and by
+ * iface.c for the imported ones; they are never
+ * freed
+ */
+extern TreeNode intType;
+extern TreeNode voidType;
+
+/* the line of the symbols that have no declaration
+ * in the source
+ */
+#define NOLINE 0
+
+/* Function intrinsic returns the built-in function
+ * called name, or NULL
+ */
+const Intrinsic *intrinsic(const char *name);
+
+/* Procedure insertIntrinsics declares every
+ * built-in function in the current scope
+ */
+void insertIntrinsics(void);
+
+/* Function intrinsicMatches tells if the function
+ * declaration t has the same return and parameter
+ * types as the built-in function in, so that the
+ * stubs programs write for input and output are
+ * accepted
+ */
+int intrinsicMatches(const Intrinsic *in, TreeNode *t);
+
+#endif
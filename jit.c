@@ -0,0 +1,698 @@
+/****************************************************/
+/* File: jit.c                                      */
+/* In-process JIT for the C- compiler: encodes the  */
+/* x86-64 instruction buffer into machine code in   */
+/* executable memory                                */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "parse.h"
+#include "analyze.h"
+#include "bounds.h"
+#include "fold.h"
+#include "symtab.h"
+#include "code.h"
+#include "cgen.h"
+#include "jit.h"
+#include "runtime/cminus_rt.h"
+
+/* a global of a loaded program and its offset in
+ * mem; the name is a copy, since the asmName table
+ * is emptied by the next compilation
+ */
+typedef struct {
+  char *sym;
+  int off;
+} JitGlobal;
+
+struct CminusJitRec {
+  unsigned char *mem;  /* code pages followed by data pages */
+  size_t size;
+  void (*entry)(void); /* main of the program */
+  JitGlobal *globals;
+  int nGlobals;
+};
+
+/* routines of the runtime the generated code may call */
+static const struct {
+  const char *name;
+  void *addr;
+} runtimeSyms[] = {
+  { "cminus_input",  (void *) cminus_input },
+  { "cminus_output", (void *) cminus_output },
+  { "cminus_bounds_error", (void *) cminus_bounds_error },
+  { NULL, NULL }
+};
+
+/* relocation kinds: rel32 to a label, rel32 to a
+ * function, and RIP-relative disp32 to a global
+ */
+typedef enum { RelLabel, RelFunc, RelData } RelocKind;
+
+typedef struct {
+  RelocKind kind;
+  int at;          /* offset of the 32-bit field */
+  int end;         /* offset of the next instruction */
+  int label;
+  const char *sym;
+  long addend;
+} Reloc;
+
+static unsigned char *buf;
+static int len, cap;
+
+static Reloc *relocs;
+static int nRelocs, relocCap;
+
+/* offsets of labels, and of functions and globals
+ * keyed by their interned asmName pointer
+ */
+static int *labelOff;
+static int labelCap;
+
+#define SYMTABSIZE 1024
+
+typedef struct {
+  const char *sym;
+  int off;
+} SymOff;
+
+static SymOff *funcOff;
+static SymOff *dataOff;
+static int symCap;
+
+static void byte(int b) {
+  if (len == cap) {
+    cap = cap ? 2 * cap : 4096;
+    buf = (unsigned char *) realloc(buf, cap);
+  }
+  buf[len++] = (unsigned char) b;
+}
+
+static void dword(long v) {
+  int i;
+  for (i = 0; i < 4; ++i)
+    byte((v >> (8 * i)) & 0xff);
+}
+
+static void qword(long v) {
+  int i;
+  for (i = 0; i < 8; ++i)
+    byte((v >> (8 * i)) & 0xff);
+}
+
+static int fits8(long v) {
+  return v >= -128 && v <= 127;
+}
+
+static int fits32(long v) {
+  return v >= -2147483648L && v <= 2147483647L;
+}
+
+static void addReloc(RelocKind kind, int label, const char *sym, long addend) {
+  if (nRelocs == relocCap) {
+    relocCap = relocCap ? 2 * relocCap : 256;
+    relocs = (Reloc *) realloc(relocs, relocCap * sizeof(Reloc));
+  }
+  relocs[nRelocs].kind = kind;
+  relocs[nRelocs].at = len;
+  relocs[nRelocs].end = len + 4;
+  relocs[nRelocs].label = label;
+  relocs[nRelocs].sym = sym;
+  relocs[nRelocs].addend = addend;
+  nRelocs++;
+  dword(0);
+}
+
+/* symHash locates the slot of sym in an open
+ * addressing table of size symCap
+ */
+static int symHash(SymOff *table, const char *sym) {
+  unsigned long h = ((unsigned long) sym >> 4) % symCap;
+  while (table[h].sym != NULL && table[h].sym != sym)
+    h = (h + 1) % symCap;
+  return h;
+}
+
+static void setSym(SymOff *table, const char *sym, int off) {
+  int h = symHash(table, sym);
+  table[h].sym = sym;
+  table[h].off = off;
+}
+
+static int getSym(SymOff *table, const char *sym) {
+  int h = symHash(table, sym);
+  return table[h].sym == NULL ? -1 : table[h].off;
+}
+
+static int condBits(CondCode cc) {
+  switch (cc) {
+    case CondB:  return 0x2;
+    case CondAE: return 0x3;
+    case CondE:  return 0x4;
+    case CondNE: return 0x5;
+    case CondL:  return 0xc;
+    case CondGE: return 0xd;
+    case CondLE: return 0xe;
+    default:     return 0xf;
+  }
+}
+
+/* Procedure encodeModRM emits the ModRM (and SIB,
+ * displacement) bytes for reg field regf and the r/m
+ * operand rm
+ */
+static void encodeModRM(int regf, Operand rm) {
+  int mod;
+  long disp = rm.val;
+
+  if (rm.kind == OpdReg || rm.kind == OpdVec) {
+    byte(0xc0 | ((regf & 7) << 3) | (rm.reg & 7));
+    return;
+  }
+  if (rm.sym != NULL) {
+    byte(0x05 | ((regf & 7) << 3));
+    addReloc(RelData, 0, rm.sym, rm.val);
+    return;
+  }
+
+  if (disp == 0 && (rm.reg & 7) != RBP)
+    mod = 0;
+  else if (fits8(disp))
+    mod = 1;
+  else
+    mod = 2;
+
+  if (rm.index == NOREG && (rm.reg & 7) != RSP)
+    byte((mod << 6) | ((regf & 7) << 3) | (rm.reg & 7));
+  else {
+    int index = rm.index == NOREG ? 4 : (rm.index & 7);
+    int scale = rm.scale == 8 ? 3 : rm.scale == 4 ? 2 : rm.scale == 2 ? 1 : 0;
+    byte((mod << 6) | ((regf & 7) << 3) | 4);
+    byte((scale << 6) | (index << 3) | (rm.reg & 7));
+  }
+  if (mod == 1)
+    byte(disp);
+  else if (mod == 2)
+    dword(disp);
+}
+
+/* Function rexBits returns the R, X and B bits of
+ * the REX prefix (or their complement in VEX) for
+ * reg field regf and the r/m operand rm
+ */
+static int rexBits(int regf, Operand rm) {
+  int rex = (regf & 8) ? 4 : 0;
+
+  if (rm.kind == OpdReg || rm.kind == OpdVec)
+    rex |= (rm.reg & 8) ? 1 : 0;
+  else if (rm.sym == NULL) {
+    if (rm.reg != NOREG && (rm.reg & 8))
+      rex |= 1;
+    if (rm.index != NOREG && (rm.index & 8))
+      rex |= 2;
+  }
+  return rex;
+}
+
+/* Procedure encodeRM emits an optional REX prefix,
+ * the nop opcode bytes in op and the ModRM bytes for
+ * reg field regf and the r/m operand rm; rm8 marks
+ * rm as a byte register
+ */
+static void encodeRM(int w, const unsigned char *op, int nop,
+                     int regf, Operand rm, int rm8) {
+  int rex = (w ? 8 : 0) | rexBits(regf, rm);
+  int i;
+
+  if (rex != 0 || (rm8 && rm.kind == OpdReg && rm.reg >= RSP && rm.reg <= RDI))
+    byte(0x40 | rex);
+  for (i = 0; i < nop; ++i)
+    byte(op[i]);
+  encodeModRM(regf, rm);
+}
+
+static void encode1(int w, int op, int regf, Operand rm) {
+  unsigned char o = (unsigned char) op;
+  encodeRM(w, &o, 1, regf, rm, FALSE);
+}
+
+static void encode2(int w, int op1, int op2, int regf, Operand rm, int rm8) {
+  unsigned char o[2];
+  o[0] = (unsigned char) op1;
+  o[1] = (unsigned char) op2;
+  encodeRM(w, o, 2, regf, rm, rm8);
+}
+
+/* Procedure encodeSse emits an SSE2 instruction:
+ * the mandatory prefix pfx (0x66 or 0xf3) comes
+ * before the REX prefix, then 0x0f and op
+ */
+static void encodeSse(int pfx, int op, int regf, Operand rm) {
+  byte(pfx);
+  encode2(FALSE, 0x0f, op, regf, rm, FALSE);
+}
+
+/* Procedure encodeVex emits an AVX instruction with
+ * a three byte VEX prefix: map 1 is 0x0f and 2 is
+ * 0x0f38, pp 1 stands for 0x66 and 2 for 0xf3, l256
+ * selects the %ymm registers and vvvv is the extra
+ * source register (0 if none)
+ */
+static void encodeVex(int map, int pp, int l256, int vvvv,
+                      int op, int regf, Operand rm) {
+  int rex = rexBits(regf, rm);
+
+  byte(0xc4);
+  byte((~rex & 7) << 5 | map);
+  byte((~vvvv & 15) << 3 | (l256 ? 4 : 0) | pp);
+  byte(op);
+  encodeModRM(regf, rm);
+}
+
+/* Procedure encodeVector encodes the packed integer
+ * instruction in with opcode op of the 0x0f map, in
+ * its SSE2 or AVX2 form
+ */
+static void encodeVector(Instr *in, int op) {
+  if (in->size == 32)
+    encodeVex(1, 1, TRUE, in->dst.reg, op, in->dst.reg, in->src);
+  else
+    encodeSse(0x66, op, in->dst.reg, in->src);
+}
+
+/* Procedure encodeAlu encodes add, sub and cmp;
+ * ext is the opcode extension used with immediates
+ */
+static void encodeAlu(Instr *in, int ext) {
+  int w = in->size == 8;
+  int base = ext << 3;   /* 00 add, 28 sub, 38 cmp */
+
+  if (in->src.kind == OpdImm) {
+    if (fits8(in->src.val)) {
+      encode1(w, 0x83, ext, in->dst);
+      byte(in->src.val);
+    }
+    else {
+      encode1(w, 0x81, ext, in->dst);
+      dword(in->src.val);
+    }
+  }
+  else if (in->src.kind == OpdReg)
+    encode1(w, base | 0x01, in->src.reg, in->dst);
+  else
+    encode1(w, base | 0x03, in->dst.reg, in->src);
+}
+
+static void encodePushPop(Operand o, int opcode) {
+  if (o.reg & 8)
+    byte(0x41);
+  byte(opcode + (o.reg & 7));
+}
+
+/* Procedure encodeInstr appends the machine code for
+ * one instruction of the buffer
+ */
+static int encodeInstr(Instr *in) {
+  int w = in->size == 8;
+  int w256 = in->size == 32;
+  int firstReloc = nRelocs;
+  int i;
+
+  switch (in->op) {
+    case I_MOV:
+      if (in->src.kind == OpdImm) {
+        if (in->dst.kind == OpdReg && !w) {
+          if (in->dst.reg & 8)
+            byte(0x41);
+          byte(0xb8 + (in->dst.reg & 7));
+          dword(in->src.val);
+        }
+        else if (fits32(in->src.val)) {
+          encode1(w, 0xc7, 0, in->dst);
+          dword(in->src.val);
+        }
+        else {
+          byte(0x48 | ((in->dst.reg & 8) ? 1 : 0));
+          byte(0xb8 + (in->dst.reg & 7));
+          qword(in->src.val);
+        }
+      }
+      else if (in->src.kind == OpdReg)
+        encode1(w, 0x89, in->src.reg, in->dst);
+      else
+        encode1(w, 0x8b, in->dst.reg, in->src);
+      break;
+    case I_MOVSX:
+      encode1(TRUE, 0x63, in->dst.reg, in->src);
+      break;
+    case I_MOVZB:
+      encode2(FALSE, 0x0f, 0xb6, in->dst.reg, in->src, TRUE);
+      break;
+    case I_LEA:
+      encode1(w, 0x8d, in->dst.reg, in->src);
+      break;
+    case I_ADD:
+      encodeAlu(in, 0);
+      break;
+    case I_SUB:
+      encodeAlu(in, 5);
+      break;
+    case I_AND:
+      encodeAlu(in, 4);
+      break;
+    case I_CMP:
+      encodeAlu(in, 7);
+      break;
+    case I_TEST:
+      encode1(w, 0x85, in->src.reg, in->dst);
+      break;
+    case I_IMUL:
+      if (in->src.kind == OpdImm) {
+        encode1(w, 0x69, in->dst.reg, in->dst);
+        dword(in->src.val);
+      }
+      else
+        encode2(w, 0x0f, 0xaf, in->dst.reg, in->src, FALSE);
+      break;
+    case I_CDQ:
+      if (w)
+        byte(0x48);
+      byte(0x99);
+      break;
+    case I_IDIV:
+      encode1(w, 0xf7, 7, in->dst);
+      break;
+    case I_SETCC:
+      encode2(FALSE, 0x0f, 0x90 | condBits(in->cc), 0, in->dst, TRUE);
+      break;
+    case I_PUSH:
+      if (in->dst.kind == OpdReg)
+        encodePushPop(in->dst, 0x50);
+      else if (in->dst.kind == OpdImm) {
+        byte(0x68);
+        dword(in->dst.val);
+      }
+      else
+        encode1(FALSE, 0xff, 6, in->dst);
+      break;
+    case I_POP:
+      if (in->dst.kind == OpdReg)
+        encodePushPop(in->dst, 0x58);
+      else
+        encode1(FALSE, 0x8f, 0, in->dst);
+      break;
+    case I_JMP:
+      byte(0xe9);
+      addReloc(RelLabel, in->dst.label, NULL, 0);
+      break;
+    case I_JCC:
+      byte(0x0f);
+      byte(0x80 | condBits(in->cc));
+      addReloc(RelLabel, in->dst.label, NULL, 0);
+      break;
+    case I_CALL:
+      for (i = 0; runtimeSyms[i].name != NULL; ++i)
+        if (strcmp(runtimeSyms[i].name, in->dst.sym) == 0)
+          break;
+      if (runtimeSyms[i].name != NULL) {
+        /* movabs $addr, %r11; call *%r11 */
+        byte(0x49);
+        byte(0xbb);
+        qword((long) runtimeSyms[i].addr);
+        byte(0x41);
+        byte(0xff);
+        byte(0xd3);
+      }
+      else {
+        byte(0xe8);
+        addReloc(RelFunc, 0, in->dst.sym, 0);
+      }
+      break;
+    case I_RET:
+      byte(0xc3);
+      break;
+    case I_LEAVE:
+      byte(0xc9);
+      break;
+    case I_LABEL:
+      labelOff[in->dst.label] = len;
+      break;
+    case I_FUNC:
+      setSym(funcOff, in->dst.sym, len);
+      break;
+    case I_VMOV:
+      if (in->dst.kind == OpdVec && in->src.kind == OpdVec) {
+        if (w256)
+          encodeVex(1, 1, TRUE, 0, 0x6f, in->dst.reg, in->src);
+        else
+          encodeSse(0x66, 0x6f, in->dst.reg, in->src);
+      }
+      else if (in->dst.kind == OpdVec) {
+        if (w256)
+          encodeVex(1, 2, TRUE, 0, 0x6f, in->dst.reg, in->src);
+        else
+          encodeSse(0xf3, 0x6f, in->dst.reg, in->src);
+      }
+      else if (w256)
+        encodeVex(1, 2, TRUE, 0, 0x7f, in->src.reg, in->dst);
+      else
+        encodeSse(0xf3, 0x7f, in->src.reg, in->dst);
+      break;
+    case I_VADD:
+      encodeVector(in, 0xfe);
+      break;
+    case I_VSUB:
+      encodeVector(in, 0xfa);
+      break;
+    case I_VMUL:
+      encodeVex(2, 1, TRUE, in->dst.reg, 0x40, in->dst.reg, in->src);
+      break;
+    case I_PMULUDQ:
+      encodeVector(in, 0xf4);
+      break;
+    case I_PUNPCKLDQ:
+      encodeVector(in, 0x62);
+      break;
+    case I_PSRLQ:
+      encodeSse(0x66, 0x73, 2, in->dst);
+      byte(in->src.val);
+      break;
+    case I_PSHUFD:
+      encodeSse(0x66, 0x70, in->dst.reg, in->dst);
+      byte(in->src.val);
+      break;
+    case I_MOVD:
+      if (w256)
+        encodeVex(1, 1, FALSE, 0, 0x6e, in->dst.reg, in->src);
+      else
+        encodeSse(0x66, 0x6e, in->dst.reg, in->src);
+      break;
+    case I_VBROADCAST:
+      encodeVex(2, 1, TRUE, 0, 0x58, in->dst.reg, in->src);
+      break;
+    case I_VZEROUPPER:
+      byte(0xc5);
+      byte(0xf8);
+      byte(0x77);
+      break;
+    default:
+      return FALSE;
+  }
+  for (i = firstReloc; i < nRelocs; ++i)
+    relocs[i].end = len;
+  return TRUE;
+}
+
+static void patch(int at, long v) {
+  int i;
+  for (i = 0; i < 4; ++i)
+    buf[at + i] = (v >> (8 * i)) & 0xff;
+}
+
+/* Function jitLoad loads the instruction buffer of
+ * code.h into executable memory; it returns NULL if
+ * the buffer has no main or an unresolved symbol
+ */
+CminusJit jitLoad(void) {
+  long page = sysconf(_SC_PAGESIZE);
+  size_t codeSize, dataSize = 0;
+  CminusJit jit;
+  int maxLabel = 0;
+  int i, mainOff;
+
+  len = 0;
+  nRelocs = 0;
+  for (i = 0; i < codeLen; ++i)
+    if (codeBuf[i].op == I_LABEL && codeBuf[i].dst.label >= maxLabel)
+      maxLabel = codeBuf[i].dst.label + 1;
+  if (maxLabel > labelCap) {
+    labelCap = maxLabel;
+    labelOff = (int *) realloc(labelOff, labelCap * sizeof(int));
+  }
+  if (symCap < 2 * (codeLen + nGlobalVars) + SYMTABSIZE) {
+    symCap = 2 * (codeLen + nGlobalVars) + SYMTABSIZE;
+    free(funcOff);
+    free(dataOff);
+    funcOff = (SymOff *) malloc(symCap * sizeof(SymOff));
+    dataOff = (SymOff *) malloc(symCap * sizeof(SymOff));
+  }
+  memset(funcOff, 0, symCap * sizeof(SymOff));
+  memset(dataOff, 0, symCap * sizeof(SymOff));
+
+  for (i = 0; i < codeLen; ++i)
+    if (!encodeInstr(&codeBuf[i])) {
+      fprintf(listing, "JIT: cannot encode instruction %d\n", codeBuf[i].op);
+      return NULL;
+    }
+
+  codeSize = (len + page - 1) & ~(page - 1);
+  for (i = 0; i < nGlobalVars; ++i) {
+    setSym(dataOff, globalVars[i].name, codeSize + dataSize);
+    dataSize += (globalVars[i].size + 7) & ~7;
+  }
+
+  for (i = 0; i < nRelocs; ++i) {
+    Reloc *r = &relocs[i];
+    long target;
+    switch (r->kind) {
+      case RelLabel:
+        target = labelOff[r->label];
+        break;
+      case RelFunc:
+        target = getSym(funcOff, r->sym);
+        break;
+      default:
+        target = getSym(dataOff, r->sym);
+        if (target >= 0)
+          target += r->addend;
+        break;
+    }
+    if (target < 0) {
+      fprintf(listing, "JIT: unresolved symbol %s\n", r->sym);
+      return NULL;
+    }
+    patch(r->at, target - r->end);
+  }
+
+  mainOff = getSym(funcOff, asmName("main"));
+  if (mainOff < 0) {
+    fprintf(listing, "JIT: program has no main\n");
+    return NULL;
+  }
+
+  jit = (CminusJit) malloc(sizeof(struct CminusJitRec));
+  jit->size = codeSize + ((dataSize + page - 1) & ~(page - 1));
+  jit->mem = (unsigned char *) mmap(NULL, jit->size, PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (jit->mem == MAP_FAILED) {
+    fprintf(listing, "JIT: cannot map executable memory\n");
+    free(jit);
+    return NULL;
+  }
+  memcpy(jit->mem, buf, len);
+  if (mprotect(jit->mem, codeSize, PROT_READ | PROT_EXEC) != 0) {
+    fprintf(listing, "JIT: cannot map executable memory\n");
+    munmap(jit->mem, jit->size);
+    free(jit);
+    return NULL;
+  }
+  jit->entry = (void (*)(void)) (jit->mem + mainOff);
+  jit->nGlobals = nGlobalVars;
+  jit->globals = (JitGlobal *) malloc((nGlobalVars + 1) * sizeof(JitGlobal));
+  for (i = 0; i < nGlobalVars; ++i) {
+    jit->globals[i].sym = (char *) malloc(strlen(globalVars[i].name) + 1);
+    strcpy(jit->globals[i].sym, globalVars[i].name);
+    jit->globals[i].off = getSym(dataOff, globalVars[i].name);
+  }
+  return jit;
+}
+
+/* Function cminus_jit_compile scans, parses, checks
+ * and generates code for the C- program in source,
+ * and loads it into executable memory. Diagnostics
+ * go to the listing file (stderr when unset), with
+ * the traces of the command line driver off. It
+ * returns NULL if the program has errors
+ */
+CminusJit cminus_jit_compile(const char *text) {
+  FILE *savedSource = source;
+  int savedTrace[4];
+  TreeNode *syntaxTree;
+  CminusJit jit = NULL;
+
+  if (listing == NULL)
+    listing = stderr;
+  source = fmemopen((void *) text, strlen(text), "r");
+  if (source == NULL) {
+    source = savedSource;
+    return NULL;
+  }
+  /* the traces are for the command line driver;
+   * embedders get the diagnostics only
+   */
+  savedTrace[0] = TraceScan;
+  savedTrace[1] = TraceParse;
+  savedTrace[2] = TraceAnalyze;
+  savedTrace[3] = TraceCode;
+  TraceScan = TraceParse = TraceAnalyze = TraceCode = FALSE;
+  lineno = 0;
+  Error = FALSE;
+  resetScanner();
+
+  syntaxTree = parse();
+  fclose(source);
+  source = savedSource;
+
+  if (!Error) {
+    buildSymtab(syntaxTree);
+    typeCheck(syntaxTree);
+  }
+  if (!Error && FoldCalls)
+    foldCalls(syntaxTree);
+  if (!Error)
+    checkBounds(syntaxTree);
+  if (!Error) {
+    genProgram(syntaxTree);
+    jit = jitLoad();
+  }
+  freeTree(syntaxTree);
+  TraceScan = savedTrace[0];
+  TraceParse = savedTrace[1];
+  TraceAnalyze = savedTrace[2];
+  TraceCode = savedTrace[3];
+  return jit;
+}
+
+/* Procedure cminus_jit_run calls main of the program */
+void cminus_jit_run(CminusJit jit) {
+  jit->entry();
+  cminus_flush();
+}
+
+void *jitData(CminusJit jit, const char *sym) {
+  int i;
+
+  for (i = 0; i < jit->nGlobals; ++i)
+    if (strcmp(jit->globals[i].sym, sym) == 0)
+      return jit->mem + jit->globals[i].off;
+  return NULL;
+}
+
+/* Procedure cminus_jit_free unmaps the program */
+void cminus_jit_free(CminusJit jit) {
+  int i;
+
+  if (jit == NULL)
+    return;
+  munmap(jit->mem, jit->size);
+  for (i = 0; i < jit->nGlobals; ++i)
+    free(jit->globals[i].sym);
+  free(jit->globals);
+  free(jit);
+}
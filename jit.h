@@ -0,0 +1,42 @@
+/****************************************************/
+/* File: jit.h                                      */
+/* In-process JIT interface for the C- compiler     */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _JIT_H_
+#define _JIT_H_
+
+/* handle to a program loaded into executable memory */
+typedef struct CminusJitRec *CminusJit;
+
+/* Function cminus_jit_compile scans, parses, checks
+ * and generates code for the C- program in source,
+ * and loads it into executable memory. Diagnostics
+ * go to the listing file (stderr when unset); the
+ * TraceScan, TraceParse, TraceAnalyze and TraceCode
+ * traces are off whatever their settings. It
+ * returns NULL if the program has errors
+ */
+CminusJit cminus_jit_compile(const char *source);
+
+/* Procedure cminus_jit_run calls main of the program */
+void cminus_jit_run(CminusJit jit);
+
+/* Function jitData returns the address of the
+ * global of the program jit whose assembler name
+ * (see asmName) is sym, or NULL if it has no such
+ * global
+ */
+void *jitData(CminusJit jit, const char *sym);
+
+/* Procedure cminus_jit_free unmaps the program */
+void cminus_jit_free(CminusJit jit);
+
+/* Function jitLoad loads the instruction buffer of
+ * code.h into executable memory; it returns NULL if
+ * the buffer has no main or an unresolved symbol
+ */
+CminusJit jitLoad(void);
+
+#endif
@@ -0,0 +1,622 @@
+/****************************************************/
+/* File: loops.c                                    */
+/* Induction variable analysis of the while loops   */
+/* for the C- code generator                        */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include <limits.h>
+#include <stdarg.h>
+#include "globals.h"
+#include "util.h"
+#include "loops.h"
+
+/* MAXUNROLL bounds the unrolling factor and
+ * MAXUNROLLNODES the syntax tree nodes of a body
+ * that is copied by unrolling
+ */
+#define MAXUNROLL 16
+#define MAXUNROLLNODES 64
+
+/* MAXOFFSET bounds the constant added to the index
+ * of a strength-reduced access, so that 4 times it
+ * fits in a displacement
+ */
+#define MAXOFFSET (1L << 28)
+
+/* MAXVECDEPTH bounds the nesting of the expressions
+ * of a vectorized loop, whose values are held in
+ * the vector registers 0 to MAXVECDEPTH - 1
+ */
+#define MAXVECDEPTH 8
+
+/* registers handed out to pointers, in order */
+static const Reg ptrReg[NPTRREGS] = { RBX, R12, R13, R14, R15 };
+
+/* the loops of the function being analysed */
+static LoopInfo *loops;
+static int nLoops, maxLoops;
+static unsigned usedRegs;
+static const char *funcName;
+
+/* what scanBody found in the body of a loop
+ * with candidate induction variable iv
+ */
+typedef struct {
+  BucketList iv;
+  int valid;       /* every update is iv = iv + c */
+  int step;        /* c of the first update */
+  int updates;     /* assignments to iv */
+  int topUpdates;  /* those run once per iteration */
+  int calls;
+  int loops;
+  int nodes;
+  BucketList arrays[NPTRREGS];
+  int nArrays;
+} BodyScan;
+
+/* what vectorizeLoop found in the body of a loop
+ * that may be vectorized
+ */
+typedef struct {
+  LoopInfo loop;
+  BucketList arrays[NPTRREGS];
+  int nArrays;
+  int stores;
+} VecScan;
+
+static int isScalar(BucketList l) {
+  TreeNode *decl = l->treeNode;
+  return (decl->nodekind == DeclK && decl->kind.decl == VarK) ||
+         (decl->nodekind == ParamK && decl->kind.param == NonVectorParamK);
+}
+
+static int isExp(TreeNode *t, ExpKind kind) {
+  return t != NULL && t->nodekind == ExpK && t->kind.exp == kind;
+}
+
+static int isVar(TreeNode *t, BucketList l) {
+  return isExp(t, IdK) && st_bucket(t->attr.name) == l;
+}
+
+int ivStep(TreeNode *t, BucketList iv) {
+  TreeNode *rhs = t->child[1];
+
+  if (!isVar(t->child[0], iv) || !isExp(rhs, OpK))
+    return 0;
+  if (rhs->attr.op == PLUS) {
+    if (isVar(rhs->child[0], iv) && isExp(rhs->child[1], ConstK))
+      return rhs->child[1]->attr.val;
+    if (isExp(rhs->child[0], ConstK) && isVar(rhs->child[1], iv))
+      return rhs->child[0]->attr.val;
+  }
+  else if (rhs->attr.op == MINUS &&
+           isVar(rhs->child[0], iv) && isExp(rhs->child[1], ConstK))
+    return -rhs->child[1]->attr.val;
+  return 0;
+}
+
+int ivAccess(TreeNode *t, BucketList *iv, BucketList *array, long *k) {
+  TreeNode *index = t->child[0];
+  TreeNode *var = index;
+  TreeNode *c = NULL;
+  BucketList l;
+
+  *array = st_bucket(t->attr.name);
+  /* the same test as genBoundsCheck */
+  if (BoundsCheck && !t->inBounds && (*array)->treeNode->nodekind == DeclK)
+    return FALSE;
+  if (isExp(index, OpK) && (index->attr.op == PLUS || index->attr.op == MINUS)) {
+    var = index->child[0];
+    c = index->child[1];
+    if (index->attr.op == PLUS && isExp(var, ConstK)) {
+      var = index->child[1];
+      c = index->child[0];
+    }
+    if (!isExp(c, ConstK) || c->attr.val > MAXOFFSET)
+      return FALSE;
+  }
+  if (!isExp(var, IdK))
+    return FALSE;
+  l = st_bucket(var->attr.name);
+  if (!isScalar(l))
+    return FALSE;
+  *iv = l;
+  *k = c == NULL ? 0 : index->attr.op == MINUS ? -(long) c->attr.val : c->attr.val;
+  return TRUE;
+}
+
+/* Procedure scanBody records in s the updates of
+ * s->iv, the calls, the loops and the arrays indexed
+ * by s->iv in the tree list t; top tells if t runs
+ * exactly once per iteration
+ */
+static void scanBody(TreeNode *t, BodyScan *s, int top) {
+  BucketList iv, array;
+  long k;
+  int i, c;
+
+  for (; t != NULL; t = t->sibling) {
+    ++s->nodes;
+    if (t->nodekind == StmtK && t->kind.stmt == CompK) {
+      sc_push(t->attr.scope);
+      scanBody(t->child[1], s, top);
+      sc_pop();
+      continue;
+    }
+    if (t->nodekind == StmtK && t->kind.stmt == WhileK)
+      ++s->loops;
+    if (t->nodekind == ExpK) {
+      switch (t->kind.exp) {
+        case AssignK:
+          if (!isVar(t->child[0], s->iv))
+            break;
+          c = ivStep(t, s->iv);
+          if (c == 0)
+            s->valid = FALSE;
+          else if (s->step == 0)
+            s->step = c;
+          ++s->updates;
+          s->topUpdates += top;
+          break;
+        case CallK:
+          ++s->calls;
+          break;
+        case VectorIdK:
+          if (!ivAccess(t, &iv, &array, &k) || iv != s->iv)
+            break;
+          for (i = 0; i < s->nArrays && s->arrays[i] != array; ++i)
+            ;
+          if (i == s->nArrays && i < NPTRREGS)
+            s->arrays[s->nArrays++] = array;
+          break;
+        default:
+          break;
+      }
+    }
+    for (i = 0; i < MAXCHILDREN; ++i)
+      scanBody(t->child[i], s, FALSE);
+  }
+}
+
+/* Function tripCount returns how many times a loop
+ * with test iv op bound runs when iv starts at c0
+ * and grows by step, or -1 if it does not stop or
+ * iv would overflow
+ */
+static long tripCount(long c0, long bound, TokenType op, long step) {
+  long d = step > 0 ? step : -step;
+  long n = -1;
+
+  switch (op) {
+    case LT:
+      if (step > 0)
+        n = bound > c0 ? (bound - c0 + d - 1) / d : 0;
+      break;
+    case LET:
+      if (step > 0)
+        n = bound >= c0 ? (bound - c0) / d + 1 : 0;
+      break;
+    case GT:
+      if (step < 0)
+        n = c0 > bound ? (c0 - bound + d - 1) / d : 0;
+      break;
+    case GET:
+      if (step < 0)
+        n = c0 >= bound ? (c0 - bound) / d + 1 : 0;
+      break;
+    case NEQ:
+      if ((bound - c0) % step == 0 && (bound - c0) / step >= 0)
+        n = (bound - c0) / step;
+      break;
+    default:
+      break;
+  }
+  if (n < 0 || c0 + n * step > INT_MAX || c0 + n * step < INT_MIN)
+    return -1;
+  return n;
+}
+
+/* Function vecFail records in loop why it is not
+ * vectorized, unless a reason is already known, and
+ * returns FALSE
+ */
+static int vecFail(LoopInfo loop, const char *fmt, ...) {
+  va_list ap;
+
+  if (loop->why[0] == '\0') {
+    va_start(ap, fmt);
+    vsnprintf(loop->why, sizeof(loop->why), fmt, ap);
+    va_end(ap);
+  }
+  loop->lanes = 0;
+  return FALSE;
+}
+
+int splatIndex(LoopInfo loop, TreeNode *t) {
+  BucketList var = isExp(t, IdK) ? st_bucket(t->attr.name) : NULL;
+  int i;
+
+  for (i = 0; i < loop->nSplats; ++i)
+    if (loop->splats[i].var == var && (var != NULL || loop->splats[i].val == t->attr.val))
+      return i;
+  return -1;
+}
+
+/* Function vecSplat adds the constant or invariant
+ * variable t to the splats of the loop of v
+ */
+static int vecSplat(TreeNode *t, VecScan *v) {
+  LoopInfo loop = v->loop;
+  Splat *sp;
+
+  if (splatIndex(loop, t) >= 0)
+    return TRUE;
+  if (loop->nSplats == NSPLATS)
+    return vecFail(loop, "more than %d invariant operands", NSPLATS);
+  sp = &loop->splats[loop->nSplats++];
+  sp->var = isExp(t, IdK) ? st_bucket(t->attr.name) : NULL;
+  sp->val = sp->var == NULL ? t->attr.val : 0;
+  return TRUE;
+}
+
+/* Function vecAccess tells if the VectorIdK node t
+ * reads or writes element iv of its array, which
+ * only that iteration touches
+ */
+static int vecAccess(TreeNode *t, VecScan *v) {
+  LoopInfo loop = v->loop;
+  BucketList iv, array;
+  long k;
+  int i;
+
+  array = st_bucket(t->attr.name);
+  if (BoundsCheck && !t->inBounds && array->treeNode->nodekind == DeclK)
+    return vecFail(loop, "%s[] needs a bounds check", t->attr.name);
+  if (!ivAccess(t, &iv, &array, &k) || iv != loop->iv)
+    return vecFail(loop, "%s[] is not indexed by %s", t->attr.name, loop->iv->name);
+  if (k != 0)
+    return vecFail(loop, "%s[%s %c %ld] may cross iterations",
+                   t->attr.name, loop->iv->name, k < 0 ? '-' : '+', k < 0 ? -k : k);
+  for (i = 0; i < v->nArrays && v->arrays[i] != array; ++i)
+    ;
+  if (i == v->nArrays) {
+    if (i == NPTRREGS)
+      return vecFail(loop, "more than %d arrays", NPTRREGS);
+    v->arrays[v->nArrays++] = array;
+  }
+  return TRUE;
+}
+
+/* Function vecExp tells if the expression t, whose
+ * value goes to vector register depth, can be
+ * computed on every lane at once
+ */
+static int vecExp(TreeNode *t, VecScan *v, int depth) {
+  LoopInfo loop = v->loop;
+  BucketList l;
+
+  if (depth == MAXVECDEPTH)
+    return vecFail(loop, "an expression nests too deep");
+  switch (t->kind.exp) {
+    case ConstK:
+      return vecSplat(t, v);
+    case IdK:
+      l = st_bucket(t->attr.name);
+      if (l == loop->iv)
+        return vecFail(loop, "%s is used as a value", l->name);
+      if (!isScalar(l))
+        return vecFail(loop, "the array %s is used as a value", l->name);
+      return vecSplat(t, v);
+    case VectorIdK:
+      return vecAccess(t, v);
+    case OpK:
+      if (t->attr.op != PLUS && t->attr.op != MINUS && t->attr.op != TIMES)
+        return vecFail(loop, t->attr.op == OVER ? "divides" : "compares");
+      return vecExp(t->child[0], v, depth) && vecExp(t->child[1], v, depth + 1);
+    case AssignK:
+      return vecFail(loop, "an assignment is used as a value");
+    default:
+      return vecFail(loop, "calls %s", t->attr.name);
+  }
+}
+
+/* Procedure vectorizeLoop decides if the loop
+ * found by analyzeLoop, with test iv op bound, can
+ * run several iterations at a time. It can when the
+ * test is iv < bound or iv <= bound for a constant
+ * or invariant bound, and the body is a block of
+ * assignments a[iv] = e, with + - * of elements
+ * b[iv], constants and invariant variables in e,
+ * ended by iv = iv + 1. Each iteration then touches
+ * only the elements iv of its arrays, and arrays
+ * are either the same or disjoint, so no iteration
+ * depends on another
+ */
+static void vectorizeLoop(LoopInfo loop, BodyScan *s, TokenType op,
+                          TreeNode *bound, VecScan *v) {
+  TreeNode *body = loop->loop->child[1];
+  TreeNode *t;
+
+  memset(v, 0, sizeof(*v));
+  v->loop = loop;
+  loop->lanes = Vectorize == VectorAVX2 ? 8 : 4;
+  if (Vectorize == VectorNone) {
+    vecFail(loop, "vectorization is off");
+    return;
+  }
+  if (s->loops > 0) {
+    vecFail(loop, "contains a loop");
+    return;
+  }
+  if (s->calls > 0) {
+    vecFail(loop, "contains a call");
+    return;
+  }
+  if (s->step != 1 || s->updates != 1) {
+    vecFail(loop, "%s does not step by 1 once per iteration", loop->iv->name);
+    return;
+  }
+  if (op != LT && op != LET) {
+    vecFail(loop, "the test is not %s < or <= a bound", loop->iv->name);
+    return;
+  }
+  if (!isExp(bound, ConstK) &&
+      !(isExp(bound, IdK) && isScalar(st_bucket(bound->attr.name)) &&
+        st_bucket(bound->attr.name) != loop->iv)) {
+    vecFail(loop, "the bound is not invariant");
+    return;
+  }
+  if (body == NULL || body->nodekind != StmtK || body->kind.stmt != CompK) {
+    vecFail(loop, "the body is not a block");
+    return;
+  }
+  sc_push(body->attr.scope);
+  for (t = body->child[1]; t != NULL; t = t->sibling) {
+    if (t->sibling == NULL) {
+      if (!isExp(t, AssignK) || !isVar(t->child[0], loop->iv))
+        vecFail(loop, "%s is not updated at the end of the body", loop->iv->name);
+      break;
+    }
+    if (t->nodekind == StmtK) {
+      vecFail(loop, "contains a statement other than an assignment");
+      break;
+    }
+    if (!isExp(t, AssignK) || !isExp(t->child[0], VectorIdK)) {
+      if (isExp(t, AssignK))
+        vecFail(loop, "assigns the scalar %s", t->child[0]->attr.name);
+      else
+        vecFail(loop, "contains an expression statement");
+      break;
+    }
+    if (!vecAccess(t->child[0], v) || !vecExp(t->child[1], v, 0))
+      break;
+    ++v->stores;
+  }
+  sc_pop();
+  if (loop->lanes > 0 && v->stores == 0)
+    vecFail(loop, "assigns no array");
+  loop->test = op;
+  loop->bound = bound;
+}
+
+static TokenType mirror(TokenType op) {
+  switch (op) {
+    case LT:  return GT;
+    case LET: return GET;
+    case GT:  return LT;
+    case GET: return LET;
+    default:  return op;
+  }
+}
+
+static LoopInfo newLoop(TreeNode *w) {
+  LoopInfo loop = (LoopInfo) calloc(1, sizeof(struct LoopRec));
+  loop->loop = w;
+  loop->trip = -1;
+  loop->copies = 1;
+  if (nLoops == maxLoops) {
+    maxLoops = maxLoops ? 2 * maxLoops : 16;
+    loops = (LoopInfo *) realloc(loops, maxLoops * sizeof(LoopInfo));
+  }
+  loops[nLoops++] = loop;
+  return loop;
+}
+
+/* Function analyzeLoop finds the induction variable
+ * of the WhileK node w, whose previous statement is
+ * prev; the registers in inUse hold the pointers of
+ * the enclosing loops
+ */
+static LoopInfo analyzeLoop(TreeNode *w, TreeNode *prev, unsigned inUse) {
+  LoopInfo loop = newLoop(w);
+  TreeNode *test = w->child[0];
+  TreeNode *var, *bound;
+  TokenType op;
+  BodyScan s;
+  VecScan v;
+  int i, r, factor;
+
+  if (!isExp(test, OpK))
+    return loop;
+  op = test->attr.op;
+  if (op != EQ && op != NEQ && op != LT && op != LET && op != GT && op != GET)
+    return loop;
+  var = test->child[0];
+  bound = test->child[1];
+  if (!isExp(var, IdK)) {
+    var = test->child[1];
+    bound = test->child[0];
+    op = mirror(op);
+  }
+  if (!isExp(var, IdK) || !isScalar(st_bucket(var->attr.name)))
+    return loop;
+
+  memset(&s, 0, sizeof(s));
+  s.iv = st_bucket(var->attr.name);
+  s.valid = TRUE;
+  scanBody(w->child[1], &s, TRUE);
+  /* a call may change a global induction variable */
+  if (!s.valid || s.updates == 0 || (s.iv->scope == globalScope && s.calls > 0))
+    return loop;
+  loop->iv = s.iv;
+  loop->step = s.step;
+  vectorizeLoop(loop, &s, op, bound, &v);
+
+  /* a vectorized loop addresses its arrays from the
+   * pointer registers
+   */
+  if (StrengthReduce || loop->lanes > 0)
+    for (i = 0, r = 0; i < s.nArrays; ++i) {
+      while (r < NPTRREGS && (inUse & (1u << ptrReg[r])))
+        ++r;
+      if (r == NPTRREGS)
+        break;
+      loop->pointers[loop->nPointers].iv = s.iv;
+      loop->pointers[loop->nPointers].array = s.arrays[i];
+      loop->pointers[loop->nPointers].reg = ptrReg[r];
+      usedRegs |= 1u << ptrReg[r++];
+      ++loop->nPointers;
+    }
+
+  /* the trip count is known when the loop starts
+   * right after iv = constant, tests iv against a
+   * constant and updates iv once per iteration
+   */
+  if (prev != NULL && isExp(prev, AssignK) && isVar(prev->child[0], s.iv) &&
+      isExp(prev->child[1], ConstK) && isExp(bound, ConstK) &&
+      s.updates == 1 && s.topUpdates == 1)
+    loop->trip = tripCount(prev->child[1]->attr.val, bound->attr.val, op, s.step);
+  if (loop->lanes > 0 && loop->nPointers < v.nArrays)
+    vecFail(loop, "no register is free for every array");
+  if (loop->lanes > 0 && loop->trip >= 0 && loop->trip < loop->lanes)
+    vecFail(loop, "only %ld iterations", loop->trip);
+  if (loop->lanes > 0)
+    return loop;
+
+  factor = Unroll > MAXUNROLL ? MAXUNROLL : Unroll;
+  if (factor > 1 && loop->trip > 0 && s.loops == 0 && s.nodes <= MAXUNROLLNODES) {
+    if (loop->trip <= factor) {
+      loop->peel = loop->trip;
+      loop->copies = 0;
+    }
+    else {
+      loop->peel = loop->trip % factor;
+      loop->copies = factor;
+    }
+  }
+  return loop;
+}
+
+/* Procedure printLoop reports what analyzeLoop
+ * found about loop to the listing file
+ */
+static void printLoop(LoopInfo loop) {
+  int i;
+
+  if (JsonListing) {
+    fprintf(listing, "{\"type\": \"loop\", \"function\": ");
+    printJsonString(listing, funcName);
+    fprintf(listing, ", \"line\": %d, \"iv\": ", loop->loop->child[0]->lineno);
+    if (loop->iv != NULL)
+      printJsonString(listing, loop->iv->name);
+    else
+      fprintf(listing, "null");
+    fprintf(listing, ", \"step\": %d, \"trip\": ", loop->step);
+    if (loop->trip >= 0)
+      fprintf(listing, "%ld", loop->trip);
+    else
+      fprintf(listing, "null");
+    fprintf(listing, ", \"peel\": %d, \"copies\": %d, \"reduced\": [",
+            loop->peel, loop->copies);
+    for (i = 0; StrengthReduce && i < loop->nPointers; ++i) {
+      if (i > 0)
+        fprintf(listing, ", ");
+      printJsonString(listing, loop->pointers[i].array->name);
+    }
+    fprintf(listing, "], \"lanes\": %d, \"why\": ", loop->lanes);
+    if (loop->why[0] != '\0')
+      printJsonString(listing, loop->why);
+    else
+      fprintf(listing, "null");
+    fprintf(listing, "}\n");
+    return;
+  }
+
+  fprintf(listing, "Loop at line %d in %s: ", loop->loop->child[0]->lineno, funcName);
+  if (loop->iv == NULL) {
+    fprintf(listing, "no induction variable\n");
+    return;
+  }
+  fprintf(listing, "induction variable %s, step %d", loop->iv->name, loop->step);
+  if (loop->trip >= 0)
+    fprintf(listing, ", %ld iterations", loop->trip);
+  if (loop->copies == 0)
+    fprintf(listing, ", fully unrolled");
+  else if (loop->copies > 1)
+    fprintf(listing, ", unrolled %dx with %d peeled", loop->copies, loop->peel);
+  for (i = 0; StrengthReduce && i < loop->nPointers; ++i)
+    fprintf(listing, "%s%s", i ? ", " : "; strength reduced ",
+            loop->pointers[i].array->name);
+  if (loop->lanes > 0)
+    fprintf(listing, "; vectorized, %d lanes\n", loop->lanes);
+  else
+    fprintf(listing, "; not vectorized: %s\n", loop->why);
+}
+
+/* Procedure walkLoops analyses the loops in the
+ * statement list t
+ */
+static void walkLoops(TreeNode *t, unsigned inUse) {
+  TreeNode *prev = NULL;
+  LoopInfo loop;
+  int i;
+
+  for (; t != NULL; prev = t, t = t->sibling) {
+    if (t->nodekind != StmtK)
+      continue;
+    switch (t->kind.stmt) {
+      case CompK:
+        sc_push(t->attr.scope);
+        walkLoops(t->child[1], inUse);
+        sc_pop();
+        break;
+      case IfK:
+        walkLoops(t->child[1], inUse);
+        walkLoops(t->child[2], inUse);
+        break;
+      case WhileK:
+        loop = analyzeLoop(t, prev, inUse);
+        if (LoopReport)
+          printLoop(loop);
+        for (i = 0; i < loop->nPointers; ++i)
+          inUse |= 1u << loop->pointers[i].reg;
+        walkLoops(t->child[1], inUse);
+        for (i = 0; i < loop->nPointers; ++i)
+          inUse &= ~(1u << loop->pointers[i].reg);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+unsigned analyzeLoops(TreeNode *func) {
+  int i;
+
+  for (i = 0; i < nLoops; ++i)
+    free(loops[i]);
+  nLoops = 0;
+  usedRegs = 0;
+  funcName = func->attr.name;
+  walkLoops(func->child[2], 0);
+  return usedRegs;
+}
+
+LoopInfo loopInfo(TreeNode *loop) {
+  int i;
+  for (i = nLoops - 1; i >= 0; --i)
+    if (loops[i]->loop == loop)
+      return loops[i];
+  return NULL;
+}
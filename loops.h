@@ -0,0 +1,94 @@
+/****************************************************/
+/* File: loops.h                                    */
+/* Induction variable analysis of the while loops   */
+/* for the C- code generator                        */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _LOOPS_H_
+#define _LOOPS_H_
+
+#include "symtab.h"
+#include "code.h"
+
+/* NPTRREGS is the number of callee-saved registers
+ * that can hold the pointers of strength-reduced
+ * array accesses
+ */
+#define NPTRREGS 5
+
+/* NSPLATS is the number of vector registers that
+ * hold the loop invariant operands of a vectorized
+ * loop, one value in every lane
+ */
+#define NSPLATS 6
+
+/* a pointer register that follows &array[iv] */
+typedef struct {
+  BucketList iv;
+  BucketList array;
+  Reg reg;
+} IvPointer;
+
+/* a loop invariant operand of a vectorized loop:
+ * the scalar var, or the constant val if var is NULL
+ */
+typedef struct {
+  BucketList var;
+  int val;
+} Splat;
+
+/* what the analysis found about a WhileK loop */
+typedef struct LoopRec {
+  TreeNode *loop;
+  BucketList iv;   /* induction variable, NULL if none */
+  int step;        /* constant added to iv by each update */
+  long trip;       /* iterations, -1 if not constant */
+  int peel;        /* copies of the body run before the loop */
+  int copies;      /* copies of the body per test, 0 if none */
+  int nPointers;
+  IvPointer pointers[NPTRREGS];
+  int lanes;       /* elements per vector iteration, 0 if scalar */
+  char why[80];    /* why the loop is not vectorized */
+  TokenType test;  /* test iv test bound of a vectorized loop */
+  TreeNode *bound;
+  int nSplats;
+  Splat splats[NSPLATS];
+} *LoopInfo;
+
+/* Function analyzeLoops finds the induction
+ * variables of the while loops in the body of the
+ * function declaration func and decides how each
+ * loop is generated; it returns the set of
+ * registers (bit r for register r) that the
+ * strength-reduced loops use. The symbol table
+ * must be positioned at the global scope
+ */
+unsigned analyzeLoops(TreeNode *func);
+
+/* Function loopInfo returns what analyzeLoops found
+ * about the WhileK node loop, or NULL
+ */
+LoopInfo loopInfo(TreeNode *loop);
+
+/* Function ivAccess tells if the VectorIdK node t
+ * indexes its array with a variable plus a constant
+ * and needs no bounds check; it sets *iv to the
+ * variable, *array to the array and *k to the
+ * constant
+ */
+int ivAccess(TreeNode *t, BucketList *iv, BucketList *array, long *k);
+
+/* Function ivStep returns the constant c of an
+ * assignment t of the form iv = iv + c or
+ * iv = iv - c to the variable iv, or 0
+ */
+int ivStep(TreeNode *t, BucketList iv);
+
+/* Function splatIndex returns the index in the
+ * splats of the vectorized loop of the constant or
+ * invariant variable t
+ */
+int splatIndex(LoopInfo loop, TreeNode *t);
+
+#endif
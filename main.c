@@ -4,6 +4,7 @@
 /* Max Forasteiro                                   */
 /****************************************************/
 
+#include <unistd.h>
 #include "globals.h"
 
 /* set NO_PARSE to TRUE to get a scanner-only compiler */
@@ -14,44 +15,210 @@
 /* set NO_CODE to TRUE to get a compiler that does not
  * generate code
  */
-#define NO_CODE TRUE
+#define NO_CODE FALSE
 
 #include "util.h"
+#include "stats.h"
 #if NO_PARSE
 #include "scan.h"
 #else
 #include "parse.h"
 #if !NO_ANALYZE
 #include "analyze.h"
+#include "xref.h"
+#include "callgraph.h"
+#include "bounds.h"
+#include "fold.h"
+#include "iface.h"
 #if !NO_CODE
 #include "cgen.h"
+#include "csource.h"
+#include "jit.h"
+#include "profile.h"
+#include "server.h"
+#include "stream.h"
 #endif
 #endif
 #endif
 
-/* allocate global variables */
-int lineno = 0;
-FILE *source;
-FILE *listing;
-FILE *code;
+static void usage(char *prog) {
+  fprintf(stderr, "usage: %s [--target=x86-64 | --target=c | --jit | --profile] [--bounds-check] [--json]\n"
+                  "          [--time-report | --stats] [--stats-json=<file>]\n"
+                  "          [--jobs[=<n>]] [--xref=<file>] [--dump-callgraph]\n"
+                  "          [--prune[=check]] [--no-peephole] [--no-strength-reduce]\n"
+                  "          [--unroll=<n>] [--vectorize=none|sse2|avx2] [--loop-report]\n"
+                  "          [--no-fold] [--fold-fuel=<n>] [--fold-report]\n"
+                  "          [--release-scopes] [--stream] [--pipeline]\n"
+                  "          [--interface] [--import=<module>]...\n"
+                  "          <filename>\n"
+                  "       %s --link=<file> <module>...\n"
+                  "       %s [--json] [--bounds-check] --serve[=<socket>]\n", prog, prog, prog);
+  exit(1);
+}
 
-/* allocate and set tracing flags */
-int EchoSource   = FALSE;
-int TraceScan    = FALSE;
-int TraceParse   = FALSE;
-int TraceAnalyze = TRUE;
-int TraceCode    = FALSE;
+/* Function moduleFile returns the name of the file
+ * of the program or module pgm with the extension
+ * ext in place of its own
+ */
+static char *moduleFile(const char *pgm, const char *ext) {
+  char *name;
+  const char *dot = strrchr(pgm, '.');
+  int fnlen = (dot != NULL && strchr(dot, '/') == NULL) ? dot - pgm : strlen(pgm);
+  name = (char *) calloc(fnlen + strlen(ext) + 1, sizeof(char));
+  strncpy(name, pgm, fnlen);
+  strcat(name, ext);
+  return name;
+}
 
-int Error        = FALSE;
+#if !NO_PARSE && !NO_ANALYZE && !NO_CODE
+/* Function openCode opens the code file of the
+ * program pgm, with the extension .c for TargetC
+ * and .s otherwise, as code and returns its name
+ */
+static char *openCode(const char *pgm) {
+  char *codefile = moduleFile(pgm, Target == TargetC ? ".c" : ".s");
+  code = fopen(codefile, "w");
+  if (code == NULL) {
+    printf("Unable to open %s\n", codefile);
+    exit(1);
+  }
+  return codefile;
+}
+#endif
 
 int main(int argc, char *argv[]) {
-  TreeNode *syntaxTree;
+  TreeNode *syntaxTree = NULL;
   char pgm[120]; /* source code file name */
-  if (argc != 2) {
-    fprintf(stderr, "usage: %s <filename>\n", argv[0]);
-    exit(1);
+  char *file = NULL;
+  char *servePath = NULL;
+  char *xrefFile = NULL;
+  char *linkFile = NULL;
+  char **modules = (char **) malloc(argc * sizeof(char *));
+  char **imports = (char **) malloc(argc * sizeof(char *));
+  int nModules = 0, nImports = 0;
+  int i;
+  for (i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--target=x86-64") == 0)
+      Target = TargetX86;
+    else if (strcmp(argv[i], "--target=c") == 0)
+      Target = TargetC;
+    else if (strcmp(argv[i], "--jit") == 0)
+      Target = TargetJit;
+    else if (strcmp(argv[i], "--bounds-check") == 0)
+      BoundsCheck = TRUE;
+    else if (strcmp(argv[i], "--serve") == 0)
+      servePath = "cminus.sock";
+    else if (strncmp(argv[i], "--serve=", 8) == 0 && argv[i][8] != '\0')
+      servePath = argv[i] + 8;
+    else if (strncmp(argv[i], "--xref=", 7) == 0 && argv[i][7] != '\0')
+      xrefFile = argv[i] + 7;
+    else if (strcmp(argv[i], "--json") == 0)
+      JsonListing = TRUE;
+    else if (strcmp(argv[i], "--no-peephole") == 0)
+      Peephole = FALSE;
+    else if (strcmp(argv[i], "--no-strength-reduce") == 0)
+      StrengthReduce = FALSE;
+    else if (strncmp(argv[i], "--unroll=", 9) == 0 && atoi(argv[i] + 9) > 0)
+      Unroll = atoi(argv[i] + 9);
+    else if (strcmp(argv[i], "--vectorize=none") == 0)
+      Vectorize = VectorNone;
+    else if (strcmp(argv[i], "--vectorize=sse2") == 0)
+      Vectorize = VectorSSE2;
+    else if (strcmp(argv[i], "--vectorize=avx2") == 0)
+      Vectorize = VectorAVX2;
+    else if (strcmp(argv[i], "--no-fold") == 0)
+      FoldCalls = FALSE;
+    else if (strncmp(argv[i], "--fold-fuel=", 12) == 0 && atoi(argv[i] + 12) > 0)
+      FoldFuel = atoi(argv[i] + 12);
+    else if (strcmp(argv[i], "--fold-report") == 0)
+      FoldReport = TRUE;
+    else if (strcmp(argv[i], "--release-scopes") == 0)
+      ReleaseScopes = TRUE;
+    else if (strcmp(argv[i], "--stream") == 0)
+      Stream = TRUE;
+    else if (strcmp(argv[i], "--pipeline") == 0)
+      Pipeline = TRUE;
+    else if (strcmp(argv[i], "--interface") == 0)
+      Module = TRUE;
+    else if (strncmp(argv[i], "--import=", 9) == 0 && argv[i][9] != '\0')
+      imports[nImports++] = argv[i] + 9;
+    else if (strncmp(argv[i], "--link=", 7) == 0 && argv[i][7] != '\0')
+      linkFile = argv[i] + 7;
+    else if (strcmp(argv[i], "--loop-report") == 0)
+      LoopReport = TRUE;
+    else if (strcmp(argv[i], "--profile") == 0) {
+      Profile = TRUE;
+      Target = TargetJit;
+    }
+    else if (strcmp(argv[i], "--dump-callgraph") == 0)
+      DumpCallGraph = TRUE;
+    else if (strcmp(argv[i], "--prune") == 0)
+      Prune = PruneCode;
+    else if (strcmp(argv[i], "--prune=check") == 0)
+      Prune = PruneCheck;
+    else if (strcmp(argv[i], "--jobs") == 0)
+      Jobs = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? (int) sysconf(_SC_NPROCESSORS_ONLN) : 1;
+    else if (strncmp(argv[i], "--jobs=", 7) == 0 && atoi(argv[i] + 7) > 0)
+      Jobs = atoi(argv[i] + 7);
+    else if (strcmp(argv[i], "--time-report") == 0 ||
+             strcmp(argv[i], "--stats") == 0)
+      TimeReport = TRUE;
+    else if (strncmp(argv[i], "--stats-json=", 13) == 0 && argv[i][13] != '\0')
+      StatsFile = argv[i] + 13;
+    else if (argv[i][0] == '-')
+      usage(argv[0]);
+    else
+      file = modules[nModules++] = argv[i];
+  }
+  /* only the link step takes several files */
+  if (nModules > 1 && linkFile == NULL)
+    usage(argv[0]);
+#if !NO_PARSE && !NO_ANALYZE
+  if (linkFile != NULL) {
+    /* the link step reads the interface and the
+     * code file of each module
+     */
+    char **ifaces = (char **) malloc((nModules + 1) * sizeof(char *));
+    char **codes = (char **) malloc((nModules + 1) * sizeof(char *));
+    if (nModules == 0)
+      usage(argv[0]);
+    for (i = 0; i < nModules; ++i) {
+      ifaces[i] = moduleFile(modules[i], ".cmi");
+      codes[i] = moduleFile(modules[i], ".s");
+    }
+    return linkModules(linkFile, ifaces, codes, nModules) ? 0 : 1;
+  }
+  /* the code of a module with imports runs only
+   * once linked, and the link step reads x86-64 code
+   */
+  if (nImports > 0 && (Target == TargetJit || Target == TargetC))
+    usage(argv[0]);
+  for (i = 0; i < nImports; ++i)
+    if (!loadInterface(moduleFile(imports[i], ".cmi")))
+      exit(1);
+  if (Module) {
+    /* every function of a module may be called by
+     * another one
+     */
+    Prune = NoPrune;
+  }
+#endif
+  if (Stream) {
+    /* the index and the pruning need the whole program */
+    if (xrefFile != NULL)
+      usage(argv[0]);
+    Prune = NoPrune;
+    ReleaseScopes = TRUE;
   }
-  strcpy(pgm, argv[1]) ;
+#if !NO_PARSE && !NO_ANALYZE && !NO_CODE
+  if (servePath != NULL && file == NULL) {
+    serve(servePath);
+    return 0;
+  }
+#endif
+  if (file == NULL || strlen(file) + 8 > sizeof(pgm))
+    usage(argv[0]);
+  strcpy(pgm, file) ;
   if (strchr(pgm, '.') == NULL)
     strcat(pgm, ".cminus");
   source = fopen(pgm, "r");
@@ -59,45 +226,122 @@ int main(int argc, char *argv[]) {
     fprintf(stderr, "File %s not found\n", pgm);
     exit(1);
   }
-  listing = stdout; /* send listing to screen */
-  fprintf(listing, "\nC- COMPILATION: %s\n", pgm);
+  setListing(stdout); /* send listing to screen */
+  if (JsonListing) {
+    fprintf(listing, "{\"type\": \"compilation\", \"file\": ");
+    printJsonString(listing, pgm);
+    fprintf(listing, "}\n");
+  }
+  else
+    fprintf(listing, "\nC- COMPILATION: %s\n", pgm);
 #if NO_PARSE
   while (getToken() != ENDFILE);
 #else
-  syntaxTree = parse();
-  if (TraceParse) {
-    fprintf(listing, "\nSyntax tree:\n");
-    printTree(syntaxTree);
+#if !NO_ANALYZE && !NO_CODE
+  if (Stream) {
+    char *codefile = NULL;
+    if (Target == TargetX86 || Target == TargetC)
+      codefile = openCode(pgm);
+    syntaxTree = streamProgram(codefile);
+    if (codefile != NULL) {
+      fclose(code);
+      if (Error)
+        remove(codefile);
+    }
+  }
+#endif
+  if (!Stream) {
+    phaseStart(PhaseParse);
+    syntaxTree = parse();
+    phaseEnd(PhaseParse);
+    if (TraceParse) {
+      fprintf(listing, "\nSyntax tree:\n");
+      printTree(syntaxTree);
+    }
   }
 #if !NO_ANALYZE
-  if (!Error) {
-    if (TraceAnalyze)
+  if (!Error && !Stream) {
+    if (TraceAnalyze && !JsonListing)
       fprintf(listing, "\nBuilding Symbol Table...\n");
+    phaseStart(PhaseSymtab);
     buildSymtab(syntaxTree);
-    if (TraceAnalyze)
+    phaseEnd(PhaseSymtab);
+    if (TraceAnalyze && !JsonListing)
       fprintf(listing, "\nChecking Types...\n");
+    phaseStart(PhaseTypes);
     typeCheck(syntaxTree);
-    if (TraceAnalyze)
+    phaseEnd(PhaseTypes);
+    if (TraceAnalyze && !JsonListing)
       fprintf(listing, "\nType Checking Finished\n");
+    if (DumpCallGraph)
+      printCallGraph(listing);
+    if (xrefFile != NULL) {
+      FILE *xref = fopen(xrefFile, "wb");
+      if (xref == NULL) {
+        fprintf(stderr, "Unable to open %s\n", xrefFile);
+        exit(1);
+      }
+      writeXref(xref);
+      fclose(xref);
+    }
   }
+  if (!Error && !Stream && FoldCalls) {
+    phaseStart(PhaseFold);
+    foldCalls(syntaxTree);
+    phaseEnd(PhaseFold);
+  }
+  if (!Error && !Stream) {
+    phaseStart(PhaseBounds);
+    checkBounds(syntaxTree);
+    phaseEnd(PhaseBounds);
+  }
+  if (!Error && Module)
+    writeInterface(moduleFile(pgm, ".cmi"), syntaxTree);
 #if !NO_CODE
-  if (!Error) {
-    char * codefile;
-    int fnlen = strcspn(pgm, ".");
-    codefile = (char *) calloc(fnlen + 4, sizeof(char));
-    strncpy(codefile, pgm, fnlen);
-    strcat(codefile, ".tm");
-    code = fopen(codefile, "w");
-    if (code == NULL) {
-      printf("Unable to open %s\n", codefile);
-      exit(1);
+  if (!Error && Target == TargetJit) {
+    CminusJit jit;
+    phaseStart(PhaseCodegen);
+    /* streamProgram has already generated the code */
+    if (!Stream)
+      genProgram(syntaxTree);
+    if (Profile)
+      profileInstrument();
+    jit = jitLoad();
+    phaseEnd(PhaseCodegen);
+    if (jit != NULL) {
+      fflush(listing);
+      phaseStart(PhaseRun);
+      cminus_jit_run(jit);
+      phaseEnd(PhaseRun);
+      if (Profile)
+        printProfile(listing, (const long *) jitData(jit, profileSym));
+      cminus_jit_free(jit);
     }
-    codeGen(syntaxTree, codefile);
+  }
+  else if (!Error && Target != NoTarget && !Stream) {
+    char *codefile = openCode(pgm);
+    phaseStart(PhaseCodegen);
+    if (Target == TargetC)
+      cSourceGen(syntaxTree, codefile);
+    else
+      codeGen(syntaxTree, codefile);
     fclose(code);
+    phaseEnd(PhaseCodegen);
   }
 #endif
 #endif
 #endif
+  if (TimeReport)
+    printStats(stderr, pgm, syntaxTree);
+  if (StatsFile != NULL) {
+    FILE *stats = fopen(StatsFile, "w");
+    if (stats == NULL) {
+      fprintf(stderr, "Unable to open %s\n", StatsFile);
+      exit(1);
+    }
+    writeStatsJson(stats, pgm, syntaxTree);
+    fclose(stats);
+  }
   fclose(source);
   return 0;
 }
@@ -13,4 +13,12 @@
  */
 TreeNode *parse(void);
 
+/* Function parseStream parses the source file
+ * without building the syntax tree: each top-level
+ * declaration is passed to handler as soon as it is
+ * reduced, and its nodes may be freed on return.
+ * It returns FALSE on a syntax error
+ */
+int parseStream(void (*handler)(TreeNode *));
+
 #endif
@@ -0,0 +1,468 @@
+/****************************************************/
+/* File: peephole.c                                 */
+/* Peephole optimizer over the x86-64 instruction   */
+/* buffer of the C- compiler                        */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include "globals.h"
+#include "code.h"
+#include "peephole.h"
+
+/* MAXPASSES bounds the passes over the buffer;
+ * MAXSCAN bounds the look-ahead of deadAfter
+ */
+#define MAXPASSES 8
+#define MAXSCAN 64
+
+/* registers as bit sets */
+#define BIT(r) (1u << (r))
+#define ARGREGS (BIT(RDI) | BIT(RSI) | BIT(RDX) | BIT(RCX) | BIT(R8) | BIT(R9))
+#define CALLERSAVED (ARGREGS | BIT(RAX) | BIT(R10) | BIT(R11))
+
+/* the buffer being rewritten: every pass reads in
+ * (the buffer of code.h) and appends the result to out
+ */
+static Instr *in, *out;
+static int nIn, nOut, outCap;
+
+/* position in in of each label, and whether a jump
+ * refers to it, indexed from the lowest label in the
+ * buffer, firstLabel
+ */
+static int *labelPos, *labelUsed;
+static int labelCap, firstLabel;
+
+static void put(const Instr *i) {
+  if (nOut == outCap) {
+    outCap = outCap ? 2 * outCap : 1024;
+    out = (Instr *) realloc(out, outCap * sizeof(Instr));
+  }
+  out[nOut++] = *i;
+}
+
+static unsigned regBit(Operand o) {
+  return o.kind == OpdReg ? BIT(o.reg) : 0;
+}
+
+static unsigned memRegs(Operand o) {
+  unsigned r = 0;
+  if (o.kind != OpdMem || o.sym != NULL)
+    return 0;
+  if (o.reg != NOREG)
+    r |= BIT(o.reg);
+  if (o.index != NOREG)
+    r |= BIT(o.index);
+  return r;
+}
+
+/* Procedure regUse computes the registers the
+ * instruction i reads and writes
+ */
+static void regUse(const Instr *i, unsigned *rd, unsigned *wr) {
+  *rd = memRegs(i->dst) | memRegs(i->src);
+  *wr = 0;
+  switch (i->op) {
+    case I_MOV: case I_MOVSX: case I_MOVZB: case I_LEA:
+      *rd |= regBit(i->src);
+      *wr |= regBit(i->dst);
+      break;
+    case I_ADD: case I_SUB: case I_AND: case I_IMUL: case I_SETCC:
+      *rd |= regBit(i->src) | regBit(i->dst);
+      *wr |= regBit(i->dst);
+      break;
+    case I_CMP: case I_TEST:
+      *rd |= regBit(i->src) | regBit(i->dst);
+      break;
+    case I_CDQ:
+      *rd |= BIT(RAX);
+      *wr |= BIT(RDX);
+      break;
+    case I_IDIV:
+      *rd |= BIT(RAX) | BIT(RDX) | regBit(i->dst);
+      *wr |= BIT(RAX) | BIT(RDX);
+      break;
+    case I_PUSH:
+      *rd |= regBit(i->dst) | BIT(RSP);
+      *wr |= BIT(RSP);
+      break;
+    case I_POP:
+      *rd |= BIT(RSP);
+      *wr |= regBit(i->dst) | BIT(RSP);
+      break;
+    case I_CALL:
+      *rd |= ARGREGS | BIT(RSP);
+      *wr |= CALLERSAVED;
+      break;
+    case I_RET:
+      *rd |= BIT(RAX) | BIT(RSP);
+      break;
+    case I_LEAVE:
+      *rd |= BIT(RBP);
+      *wr |= BIT(RSP) | BIT(RBP);
+      break;
+    case I_MOVD:
+      *rd |= regBit(i->src);
+      break;
+    default:
+      break;
+  }
+}
+
+static int isBlockEnd(const Instr *i) {
+  return i->op == I_LABEL || i->op == I_FUNC || i->op == I_JMP || i->op == I_JCC;
+}
+
+/* Function deadAfter tells if register r is written
+ * before it is read from in[j] on. The code
+ * generator keeps values only in %rax, on the
+ * stack and, for loops, in callee-saved registers
+ * between expressions, so the other registers are
+ * dead where a basic block ends; the buffer holds
+ * whole functions, so its end is also a block end
+ */
+static int deadAfter(int j, Reg r) {
+  int k;
+  for (k = j; k < nIn && k < j + MAXSCAN; ++k) {
+    unsigned rd, wr;
+    if (isBlockEnd(&in[k]))
+      return r != RAX && (BIT(r) & CALLERSAVED);
+    regUse(&in[k], &rd, &wr);
+    if (rd & BIT(r))
+      return FALSE;
+    if (wr & BIT(r))
+      return TRUE;
+  }
+  if (k == nIn)
+    return r != RAX && (BIT(r) & CALLERSAVED);
+  return FALSE;
+}
+
+static int sameOperand(Operand a, Operand b) {
+  return a.kind == b.kind && a.reg == b.reg && a.index == b.index &&
+         a.scale == b.scale && a.val == b.val && a.sym == b.sym && a.label == b.label;
+}
+
+static int isMov(int j, OperandKind dst, OperandKind src) {
+  return j < nIn && in[j].op == I_MOV && in[j].dst.kind == dst && in[j].src.kind == src;
+}
+
+static int isReg(Operand o, Reg r) {
+  return o.kind == OpdReg && o.reg == r;
+}
+
+/* Function realAfter returns the position of the
+ * first instruction from in[j] on that is not a label
+ */
+static int realAfter(int j) {
+  while (j < nIn && in[j].op == I_LABEL)
+    ++j;
+  return j;
+}
+
+/* Each pattern tries to rewrite the instructions
+ * starting at in[i]: it appends the replacement to
+ * out and returns the number of instructions it
+ * replaced, or 0 if it does not apply
+ */
+
+/* push %r; pop %r  =>  (nothing) */
+static int pushPopSame(int i) {
+  if (i + 1 < nIn && in[i].op == I_PUSH && in[i + 1].op == I_POP &&
+      in[i].dst.kind == OpdReg && sameOperand(in[i].dst, in[i + 1].dst))
+    return 2;
+  return 0;
+}
+
+/* push %r1; pop %r2  =>  mov %r1, %r2 */
+static int pushPopMove(int i) {
+  Instr m;
+  if (i + 1 >= nIn || in[i].op != I_PUSH || in[i + 1].op != I_POP ||
+      in[i].dst.kind != OpdReg || in[i + 1].dst.kind != OpdReg)
+    return 0;
+  m = in[i + 1];
+  m.op = I_MOV;
+  m.size = 8;
+  m.dst = in[i + 1].dst;
+  m.src = in[i].dst;
+  put(&m);
+  return 2;
+}
+
+/* push %r; I; pop %r  =>  I, when I leaves %r and
+ * the stack alone
+ */
+static int pushOpPop(int i) {
+  unsigned rd, wr, r;
+  const Instr *op;
+
+  if (i + 2 >= nIn || in[i].op != I_PUSH || in[i + 2].op != I_POP ||
+      in[i].dst.kind != OpdReg || !sameOperand(in[i].dst, in[i + 2].dst))
+    return 0;
+  op = &in[i + 1];
+  switch (op->op) {
+    case I_MOV: case I_MOVSX: case I_MOVZB: case I_LEA:
+    case I_ADD: case I_SUB: case I_AND: case I_IMUL:
+      break;
+    default:
+      return 0;
+  }
+  regUse(op, &rd, &wr);
+  r = BIT(in[i].dst.reg);
+  if ((wr & (r | BIT(RSP))) || (rd & BIT(RSP)))
+    return 0;
+  put(op);
+  return 3;
+}
+
+/* mov X, %r1; mov %r1, %r2  =>  mov X, %r2, when
+ * %r1 is dead afterwards
+ */
+static int movChain(int i) {
+  Instr m;
+  if (i + 1 >= nIn || in[i].op != I_MOV || in[i + 1].op != I_MOV ||
+      in[i].dst.kind != OpdReg || in[i].src.kind == OpdReg ||
+      !isMov(i + 1, OpdReg, OpdReg) || in[i].size != in[i + 1].size ||
+      !isReg(in[i + 1].src, in[i].dst.reg) || isReg(in[i + 1].dst, in[i].dst.reg) ||
+      !deadAfter(i + 2, in[i].dst.reg))
+    return 0;
+  m = in[i];
+  m.dst = in[i + 1].dst;
+  put(&m);
+  return 2;
+}
+
+/* mov X, %r; op %r, %d  =>  op X, %d, when X is a
+ * constant or memory and %r is dead afterwards
+ */
+static int foldOperand(int i) {
+  Instr m;
+  const Instr *op = &in[i + 1];
+
+  if (i + 1 >= nIn || in[i].op != I_MOV || in[i].dst.kind != OpdReg ||
+      (in[i].src.kind != OpdImm && in[i].src.kind != OpdMem))
+    return 0;
+  switch (op->op) {
+    case I_ADD: case I_SUB: case I_AND: case I_CMP: case I_IMUL:
+      break;
+    default:
+      return 0;
+  }
+  if (op->size != in[i].size || op->dst.kind != OpdReg ||
+      !isReg(op->src, in[i].dst.reg) || isReg(op->dst, in[i].dst.reg) ||
+      (in[i].src.kind == OpdImm && (in[i].src.val < -2147483647L - 1 ||
+                                    in[i].src.val > 2147483647L)) ||
+      !deadAfter(i + 2, in[i].dst.reg))
+    return 0;
+  m = *op;
+  m.src = in[i].src;
+  put(&m);
+  return 2;
+}
+
+/* mov %r, M; mov M, %s  =>  mov %r, M (and
+ * mov %r, %s when %s is another register)
+ */
+static int storeReload(int i) {
+  Instr m;
+  if (!isMov(i, OpdMem, OpdReg) || !isMov(i + 1, OpdReg, OpdMem) ||
+      in[i].size != in[i + 1].size || !sameOperand(in[i].dst, in[i + 1].src) ||
+      (memRegs(in[i].dst) & BIT(in[i + 1].dst.reg)))
+    return 0;
+  put(&in[i]);
+  if (in[i + 1].dst.reg != in[i].src.reg) {
+    m = in[i + 1];
+    m.src = in[i].src;
+    put(&m);
+  }
+  return 2;
+}
+
+/* mov M, %r; mov %r, M  =>  mov M, %r */
+static int loadStore(int i) {
+  if (!isMov(i, OpdReg, OpdMem) || !isMov(i + 1, OpdMem, OpdReg) ||
+      in[i].size != in[i + 1].size || !sameOperand(in[i].src, in[i + 1].dst) ||
+      in[i].dst.reg != in[i + 1].src.reg || (memRegs(in[i].src) & BIT(in[i].dst.reg)))
+    return 0;
+  put(&in[i]);
+  return 2;
+}
+
+/* jmp L; L:  =>  L: */
+static int jumpToNext(int i) {
+  int j;
+  if (in[i].op != I_JMP)
+    return 0;
+  for (j = i + 1; j < nIn && in[j].op == I_LABEL; ++j)
+    if (in[j].dst.label == in[i].dst.label)
+      return 1;
+  return 0;
+}
+
+/* jmp L1 ... L1: jmp L2  =>  jmp L2 ... */
+static int jumpToJump(int i) {
+  Instr m;
+  int j, hops;
+
+  if (in[i].op != I_JMP && in[i].op != I_JCC)
+    return 0;
+  m = in[i];
+  for (hops = 0; hops < 8; ++hops) {
+    j = realAfter(labelPos[m.dst.label - firstLabel] + 1);
+    if (j >= nIn || in[j].op != I_JMP || in[j].dst.label == m.dst.label)
+      break;
+    m.dst = in[j].dst;
+  }
+  if (m.dst.label == in[i].dst.label)
+    return 0;
+  put(&m);
+  return 1;
+}
+
+/* jcc L1; jmp L2; L1:  =>  jncc L2; L1: */
+static int branchOverJump(int i) {
+  Instr m;
+  int j;
+
+  if (i + 2 >= nIn || in[i].op != I_JCC || in[i + 1].op != I_JMP)
+    return 0;
+  for (j = i + 2; j < nIn && in[j].op == I_LABEL; ++j)
+    if (in[j].dst.label == in[i].dst.label)
+      break;
+  if (j >= nIn || in[j].op != I_LABEL)
+    return 0;
+  m = in[i];
+  m.cc = negateCond(in[i].cc);
+  m.dst = in[i + 1].dst;
+  put(&m);
+  return 2;
+}
+
+/* jmp L; I ...  =>  jmp L, up to the next label */
+static int deadCode(int i) {
+  int j;
+  if (in[i].op != I_JMP && in[i].op != I_RET)
+    return 0;
+  for (j = i + 1; j < nIn && in[j].op != I_LABEL && in[j].op != I_FUNC; ++j)
+    ;
+  if (j == i + 1)
+    return 0;
+  put(&in[i]);
+  return j - i;
+}
+
+/* L:  =>  (nothing), when no jump refers to L */
+static int unusedLabel(int i) {
+  if (in[i].op == I_LABEL && !labelUsed[in[i].dst.label - firstLabel])
+    return 1;
+  return 0;
+}
+
+static struct {
+  const char *name;
+  int (*rewrite)(int i);
+  int count;
+} patterns[] = {
+  { "push-pop",         pushPopSame,    0 },
+  { "push-op-pop",      pushOpPop,      0 },
+  { "push-pop-move",    pushPopMove,    0 },
+  { "mov-chain",        movChain,       0 },
+  { "fold-operand",     foldOperand,    0 },
+  { "store-reload",     storeReload,    0 },
+  { "load-store",       loadStore,      0 },
+  { "jump-to-next",     jumpToNext,     0 },
+  { "jump-to-jump",     jumpToJump,     0 },
+  { "branch-over-jump", branchOverJump, 0 },
+  { "dead-code",        deadCode,       0 },
+  { "unused-label",     unusedLabel,    0 },
+  { NULL, NULL, 0 }
+};
+
+/* Procedure indexLabels records the position of
+ * every label of in and the labels jumped to
+ */
+static void indexLabels(void) {
+  int i, maxLabel = 0, n;
+
+  firstLabel = -1;
+  for (i = 0; i < nIn; ++i)
+    if (in[i].op == I_LABEL || in[i].op == I_JMP || in[i].op == I_JCC) {
+      if (in[i].dst.label >= maxLabel)
+        maxLabel = in[i].dst.label + 1;
+      if (firstLabel < 0 || in[i].dst.label < firstLabel)
+        firstLabel = in[i].dst.label;
+    }
+  if (firstLabel < 0)
+    firstLabel = 0;
+  n = maxLabel - firstLabel;
+  if (n > labelCap) {
+    labelCap = n;
+    labelPos = (int *) realloc(labelPos, labelCap * sizeof(int));
+    labelUsed = (int *) realloc(labelUsed, labelCap * sizeof(int));
+  }
+  memset(labelUsed, 0, n * sizeof(int));
+  for (i = 0; i < nIn; ++i)
+    if (in[i].op == I_LABEL)
+      labelPos[in[i].dst.label - firstLabel] = i;
+    else if (in[i].op == I_JMP || in[i].op == I_JCC)
+      labelUsed[in[i].dst.label - firstLabel] = TRUE;
+}
+
+/* Procedure resetPeephole zeroes the rewrite
+ * counts of the patterns
+ */
+void resetPeephole(void) {
+  int p;
+
+  for (p = 0; patterns[p].name != NULL; ++p)
+    patterns[p].count = 0;
+}
+
+void peephole(void) {
+  int pass, p, i, n, changed = TRUE;
+
+  for (pass = 0; pass < MAXPASSES && changed; ++pass) {
+    in = codeBuf;
+    nIn = codeLen;
+    nOut = 0;
+    changed = FALSE;
+    indexLabels();
+    for (i = 0; i < nIn; i += n) {
+      n = 0;
+      for (p = 0; patterns[p].name != NULL && n == 0; ++p)
+        if ((n = patterns[p].rewrite(i)) > 0)
+          patterns[p].count++;
+      if (n > 0)
+        changed = TRUE;
+      else {
+        put(&in[i]);
+        n = 1;
+      }
+    }
+    /* no pattern makes the code longer, so the result
+     * fits in the buffer
+     */
+    memcpy(codeBuf, out, nOut * sizeof(Instr));
+    codeLen = nOut;
+  }
+}
+
+void printPeephole(FILE *out) {
+  int p, total = 0;
+
+  for (p = 0; patterns[p].name != NULL; ++p)
+    total += patterns[p].count;
+  fprintf(out, "  peephole     %12d rewrites\n", total);
+  for (p = 0; patterns[p].name != NULL; ++p)
+    if (patterns[p].count > 0)
+      fprintf(out, "    %-18s %8d\n", patterns[p].name, patterns[p].count);
+}
+
+void writePeepholeJson(FILE *out) {
+  int p;
+
+  fprintf(out, "{");
+  for (p = 0; patterns[p].name != NULL; ++p)
+    fprintf(out, "%s\"%s\": %d", p ? ", " : "", patterns[p].name, patterns[p].count);
+  fprintf(out, "}");
+}
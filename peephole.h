@@ -0,0 +1,31 @@
+/****************************************************/
+/* File: peephole.h                                 */
+/* Peephole optimizer over the x86-64 instruction   */
+/* buffer of the C- compiler                        */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _PEEPHOLE_H_
+#define _PEEPHOLE_H_
+
+/* Procedure peephole rewrites the instruction
+ * buffer of code.h with the patterns of its table
+ * until none of them applies; the buffer may hold
+ * any run of whole functions
+ */
+void peephole(void);
+
+/* Procedure resetPeephole zeroes the rewrite
+ * counts of the patterns
+ */
+void resetPeephole(void);
+
+/* Procedure printPeephole prints the number of
+ * rewrites of each pattern since the last
+ * resetPeephole;
+ * writePeepholeJson prints them as a JSON object
+ */
+void printPeephole(FILE *out);
+void writePeepholeJson(FILE *out);
+
+#endif
@@ -0,0 +1,138 @@
+/****************************************************/
+/* File: pool.c                                     */
+/* Work-stealing thread pool for the C- compiler    */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include <pthread.h>
+#include "globals.h"
+#include "pool.h"
+
+/* stack size of the worker threads; the tree
+ * traversals recurse along statement lists
+ */
+#define WORKERSTACK (64 * 1024 * 1024)
+
+/* the indexes [lo, hi) not yet taken from a worker */
+typedef struct {
+  pthread_mutex_t lock;
+  int lo, hi;
+} Range;
+
+typedef struct {
+  Range *ranges;
+  int nThreads;
+  void (*work)(int, void *);
+  void *arg;
+} Job;
+
+typedef struct {
+  Job *job;
+  int self;
+} Worker;
+
+/* Function take removes the next index of range r,
+ * or returns -1 if r is empty
+ */
+static int take(Range *r) {
+  int i = -1;
+  pthread_mutex_lock(&r->lock);
+  if (r->lo < r->hi)
+    i = r->lo++;
+  pthread_mutex_unlock(&r->lock);
+  return i;
+}
+
+/* Function steal moves the upper half of the
+ * indexes left in victim to thief; it returns FALSE
+ * if victim had nothing left
+ */
+static int steal(Range *thief, Range *victim) {
+  int lo, hi, mid;
+
+  pthread_mutex_lock(&victim->lock);
+  lo = victim->lo;
+  hi = victim->hi;
+  mid = lo + (hi - lo) / 2;
+  if (lo < hi)
+    victim->hi = mid;
+  pthread_mutex_unlock(&victim->lock);
+  if (lo >= hi)
+    return FALSE;
+
+  pthread_mutex_lock(&thief->lock);
+  thief->lo = mid;
+  thief->hi = hi;
+  pthread_mutex_unlock(&thief->lock);
+  return TRUE;
+}
+
+static void *runWorker(void *p) {
+  Worker *w = (Worker *) p;
+  Job *job = w->job;
+  Range *own = &job->ranges[w->self];
+  int i, k;
+
+  for (;;) {
+    while ((i = take(own)) >= 0)
+      job->work(i, job->arg);
+    for (k = 1; k < job->nThreads; ++k)
+      if (steal(own, &job->ranges[(w->self + k) % job->nThreads]))
+        break;
+    if (k == job->nThreads)
+      return NULL;
+  }
+}
+
+void parallelFor(int n, int nThreads, void (*work)(int i, void *arg), void *arg) {
+  Job job;
+  Worker *workers;
+  pthread_t *threads;
+  int *running;
+  pthread_attr_t attr;
+  int t;
+
+  if (nThreads > n)
+    nThreads = n;
+  if (nThreads <= 1) {
+    for (t = 0; t < n; ++t)
+      work(t, arg);
+    return;
+  }
+
+  job.ranges = (Range *) malloc(nThreads * sizeof(Range));
+  job.nThreads = nThreads;
+  job.work = work;
+  job.arg = arg;
+  workers = (Worker *) malloc(nThreads * sizeof(Worker));
+  threads = (pthread_t *) malloc(nThreads * sizeof(pthread_t));
+  running = (int *) malloc(nThreads * sizeof(int));
+  for (t = 0; t < nThreads; ++t) {
+    pthread_mutex_init(&job.ranges[t].lock, NULL);
+    job.ranges[t].lo = (long) n * t / nThreads;
+    job.ranges[t].hi = (long) n * (t + 1) / nThreads;
+    workers[t].job = &job;
+    workers[t].self = t;
+  }
+
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, WORKERSTACK);
+  /* a thread that fails to start leaves its share
+   * to be stolen by the others
+   */
+  for (t = 1; t < nThreads; ++t)
+    running[t] = pthread_create(&threads[t], &attr, runWorker, &workers[t]) == 0;
+  pthread_attr_destroy(&attr);
+
+  runWorker(&workers[0]);
+  for (t = 1; t < nThreads; ++t)
+    if (running[t])
+      pthread_join(threads[t], NULL);
+
+  for (t = 0; t < nThreads; ++t)
+    pthread_mutex_destroy(&job.ranges[t].lock);
+  free(job.ranges);
+  free(workers);
+  free(threads);
+  free(running);
+}
@@ -0,0 +1,19 @@
+/****************************************************/
+/* File: pool.h                                     */
+/* Work-stealing thread pool for the C- compiler    */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _POOL_H_
+#define _POOL_H_
+
+/* Procedure parallelFor calls work(i, arg) once for
+ * every i in [0, n), on up to nThreads threads (the
+ * calling thread is one of them). Each thread starts
+ * with a contiguous share of the indexes and, when
+ * it runs out, steals half of the indexes left to
+ * another thread. It returns when all calls are done
+ */
+void parallelFor(int n, int nThreads, void (*work)(int i, void *arg), void *arg);
+
+#endif
@@ -0,0 +1,201 @@
+/****************************************************/
+/* File: profile.c                                  */
+/* Execution profiler (--profile) for the C-        */
+/* compiler                                         */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "code.h"
+#include "profile.h"
+
+/* PROFTOP is the number of rows of each table */
+#define PROFTOP 10
+
+/* the runtime prefix of the assembler names of the
+ * I/O routines
+ */
+#define RTPREFIX "cminus_"
+
+const char profileSym[] = "cminus_profile";
+
+static int nCounters = 0;
+
+/* Function isCounter tells the counter increments
+ * apart from the instructions of the program
+ */
+static int isCounter(const Instr *in) {
+  return in->op == I_ADD && in->dst.kind == OpdMem && in->dst.sym == profileSym;
+}
+
+void profileInstrument(void) {
+  Instr *old = (Instr *) malloc(codeLen * sizeof(Instr));
+  int n = codeLen;
+  int i, leader = FALSE;
+
+  memcpy(old, codeBuf, n * sizeof(Instr));
+  codeLen = 0;
+  nCounters = 0;
+  for (i = 0; i < n; ++i) {
+    Instr *in = &old[i];
+    if (in->op == I_FUNC || in->op == I_LABEL) {
+      /* a run of labels starts a single block */
+      leader = TRUE;
+      *emit(in->op, in->size, in->dst, in->src) = *in;
+      continue;
+    }
+    if (leader) {
+      /* flags are never live across a block start,
+       * so the add cannot disturb the program
+       */
+      Operand counter = opGlobal(profileSym);
+      counter.val = 8L * nCounters++;
+      emit(I_ADD, 8, counter, opImm(1))->lineno = in->lineno;
+      leader = FALSE;
+    }
+    *emit(in->op, in->size, in->dst, in->src) = *in;
+    if (in->op == I_JMP || in->op == I_JCC || in->op == I_RET)
+      leader = TRUE;
+  }
+  free(old);
+  emitGlobal(profileSym, 8 * (nCounters > 0 ? nCounters : 1));
+}
+
+/* the execution figures of a line, a function or
+ * a call site
+ */
+typedef struct {
+  const char *name;  /* function or callee */
+  int lineno;
+  long count;        /* calls */
+  long instrs;       /* instructions executed */
+} ProfRow;
+
+typedef struct {
+  ProfRow *rows;
+  int n, cap;
+} ProfTable;
+
+static ProfRow *addRow(ProfTable *t, const char *name, int lineno) {
+  if (t->n == t->cap) {
+    t->cap = t->cap ? 2 * t->cap : 64;
+    t->rows = (ProfRow *) realloc(t->rows, t->cap * sizeof(ProfRow));
+  }
+  t->rows[t->n].name = name;
+  t->rows[t->n].lineno = lineno;
+  t->rows[t->n].count = t->rows[t->n].instrs = 0;
+  return &t->rows[t->n++];
+}
+
+static int byInstrs(const void *a, const void *b) {
+  long x = ((const ProfRow *) a)->instrs, y = ((const ProfRow *) b)->instrs;
+  return x > y ? -1 : x < y;
+}
+
+static int byCount(const void *a, const void *b) {
+  long x = ((const ProfRow *) a)->count, y = ((const ProfRow *) b)->count;
+  return x > y ? -1 : x < y;
+}
+
+static int byLine(const void *a, const void *b) {
+  return ((const ProfRow *) a)->lineno - ((const ProfRow *) b)->lineno;
+}
+
+/* Function calleeName returns the C- name of the
+ * function called by the call instruction in, or
+ * NULL if it is not a call of the source program
+ */
+static const char *calleeName(const Instr *in) {
+  const char *sym = in->dst.sym;
+  if (strcmp(sym, RTPREFIX "input") == 0 || strcmp(sym, RTPREFIX "output") == 0)
+    return sym + strlen(RTPREFIX);
+  return sourceName(sym);
+}
+
+static void printRowJson(FILE *out, const char *kind, ProfRow *r) {
+  fprintf(out, "{\"type\": \"profile\", \"kind\": \"%s\"", kind);
+  if (r->name != NULL) {
+    fprintf(out, ", \"name\": ");
+    printJsonString(out, r->name);
+  }
+  fprintf(out, ", \"line\": %d", r->lineno);
+  if (r->name != NULL)
+    fprintf(out, ", \"calls\": %ld", r->count);
+  fprintf(out, ", \"instructions\": %ld}\n", r->instrs);
+}
+
+void printProfile(FILE *out, const long *counters) {
+  ProfTable lines = { NULL, 0, 0 }, funcs = { NULL, 0, 0 }, calls = { NULL, 0, 0 };
+  ProfRow *func = NULL;
+  long count = 0, total = 0;
+  int i, k = -1, entry = FALSE;
+
+  /* every instruction runs as many times as the
+   * counter of its block; the lines are gathered
+   * in source order and merged
+   */
+  for (i = 0; i < codeLen; ++i) {
+    Instr *in = &codeBuf[i];
+    if (in->op == I_FUNC) {
+      func = addRow(&funcs, sourceName(in->dst.sym), in->lineno);
+      entry = TRUE;
+      continue;
+    }
+    if (isCounter(in)) {
+      count = counters[++k];
+      if (entry && func != NULL)
+        func->count = count;
+      entry = FALSE;
+      continue;
+    }
+    if (in->op == I_LABEL || count == 0)
+      continue;
+    total += count;
+    if (func != NULL)
+      func->instrs += count;
+    addRow(&lines, NULL, in->lineno)->instrs = count;
+    if (in->op == I_CALL && calleeName(in) != NULL)
+      addRow(&calls, calleeName(in), in->lineno)->count = count;
+  }
+  qsort(lines.rows, lines.n, sizeof(ProfRow), byLine);
+  for (i = 0, k = 0; i < lines.n; ++i)
+    if (k > 0 && lines.rows[k - 1].lineno == lines.rows[i].lineno)
+      lines.rows[k - 1].instrs += lines.rows[i].instrs;
+    else
+      lines.rows[k++] = lines.rows[i];
+  lines.n = k;
+  qsort(lines.rows, lines.n, sizeof(ProfRow), byInstrs);
+  qsort(funcs.rows, funcs.n, sizeof(ProfRow), byInstrs);
+  qsort(calls.rows, calls.n, sizeof(ProfRow), byCount);
+
+  if (JsonListing) {
+    for (i = 0; i < lines.n; ++i)
+      printRowJson(out, "line", &lines.rows[i]);
+    for (i = 0; i < funcs.n; ++i)
+      printRowJson(out, "function", &funcs.rows[i]);
+    for (i = 0; i < calls.n; ++i)
+      printRowJson(out, "call", &calls.rows[i]);
+  }
+  else {
+    fprintf(out, "\nProfile: %ld instructions executed\n\n", total);
+    fprintf(out, "Line    Instructions    Share\n");
+    fprintf(out, "------  --------------  -------\n");
+    for (i = 0; i < lines.n && i < PROFTOP; ++i)
+      fprintf(out, "%6d  %14ld  %6.2f%%\n", lines.rows[i].lineno, lines.rows[i].instrs,
+              total > 0 ? 100.0 * lines.rows[i].instrs / total : 0.0);
+    fprintf(out, "\nFunction        Calls           Instructions\n");
+    fprintf(out, "--------------  --------------  --------------\n");
+    for (i = 0; i < funcs.n && i < PROFTOP; ++i)
+      fprintf(out, "%-14s  %14ld  %14ld\n", funcs.rows[i].name, funcs.rows[i].count,
+              funcs.rows[i].instrs);
+    fprintf(out, "\nCall site  Callee          Calls\n");
+    fprintf(out, "---------  --------------  --------------\n");
+    for (i = 0; i < calls.n && i < PROFTOP; ++i)
+      fprintf(out, "line %4d  %-14s  %14ld\n", calls.rows[i].lineno, calls.rows[i].name,
+              calls.rows[i].count);
+  }
+  free(lines.rows);
+  free(funcs.rows);
+  free(calls.rows);
+}
@@ -0,0 +1,30 @@
+/****************************************************/
+/* File: profile.h                                  */
+/* Execution profiler (--profile) for the C-        */
+/* compiler                                         */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+/* profileSym is the global array of execution
+ * counters, one per basic block of the program
+ */
+extern const char profileSym[];
+
+/* Procedure profileInstrument adds an increment of
+ * a counter at the start of every basic block of the
+ * instruction buffer of code.h, and reserves the
+ * counters as the global profileSym
+ */
+void profileInstrument(void);
+
+/* Procedure printProfile prints the source lines
+ * and the functions that executed the most
+ * instructions and the calls of each call site,
+ * from the counters of the instrumented buffer
+ */
+void printProfile(FILE *out, const long *counters);
+
+#endif
@@ -0,0 +1,455 @@
+/****************************************************/
+/* File: rdparse.c                                  */
+/* Recursive-descent parser for the C- compiler:    */
+/* direct loops for the lists and precedence        */
+/* climbing for the expressions                     */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "parse.h"
+#include "rdparse.h"
+
+/* The parser reads a token only when it has to
+ * look at it, as the Bison parser does, so that
+ * each node is created with the line of the same
+ * last token read, TraceScan prints the same
+ * tokens and a syntax error stops at the same one
+ */
+
+int yyerror(char *message);
+
+/* the parser state is per thread, as in cminus.y */
+static __thread int (*nextToken)(void);
+static __thread TokenType token;   /* the token read last */
+static __thread int haveToken;     /* token is not consumed yet */
+static __thread int failed;
+
+/* the precedence of the binary operators; the
+ * relations do not associate
+ */
+#define RELPREC 1
+#define SUMPREC 2
+#define MULPREC 3
+
+/* Function peek returns the next token, reading
+ * it if needed
+ */
+static TokenType peek(void) {
+  if (!haveToken) {
+    token = nextToken();
+    haveToken = TRUE;
+  }
+  return token;
+}
+
+/* Procedure syntaxError reports the error at the
+ * token; from then on the next token is always
+ * ENDFILE, which ends every list and matches no
+ * expected token, so no more tokens are read
+ */
+static void syntaxError(void) {
+  if (!failed) {
+    yyerror("syntax error");
+    failed = TRUE;
+  }
+  token = ENDFILE;
+  haveToken = TRUE;
+}
+
+/* Function match consumes the next token, which
+ * must be expected
+ */
+static int match(TokenType expected) {
+  if (peek() != expected) {
+    syntaxError();
+    return FALSE;
+  }
+  haveToken = FALSE;
+  return TRUE;
+}
+
+/* Procedure append links the node t, if any, at
+ * the end of the list whose ends are *first and
+ * *last
+ */
+static void append(TreeNode **first, TreeNode **last, TreeNode *t) {
+  if (t == NULL)
+    return;
+  if (*first == NULL)
+    *first = t;
+  else
+    (*last)->sibling = t;
+  *last = t;
+}
+
+static TreeNode *expression(void);
+static TreeNode *statement(void);
+
+/* Function typeSpec parses int or void */
+static TreeNode *typeSpec(void) {
+  TokenType type = peek();
+  TreeNode *t;
+
+  if (type != INT && type != VOID) {
+    syntaxError();
+    return NULL;
+  }
+  haveToken = FALSE;
+  t = newTypeNode(TypeNameK);
+  t->attr.type = type;
+  return t;
+}
+
+/* a name, as the save_name rule of cminus.y keeps it */
+typedef struct {
+  char *name;
+  int lineno;
+  int colno;
+} Name;
+
+static int name(Name *n) {
+  if (peek() != ID) {
+    syntaxError();
+    return FALSE;
+  }
+  n->name = copyString(tokenString);
+  n->lineno = lineno;
+  n->colno = tokenColumn;
+  haveToken = FALSE;
+  return TRUE;
+}
+
+/* Function varDecl parses the rest of a variable
+ * declaration of type type and name n
+ */
+static TreeNode *varDecl(TreeNode *type, Name *n) {
+  TreeNode *t;
+  int size;
+
+  if (peek() == LBRACKET) {
+    haveToken = FALSE;
+    if (peek() != NUM) {
+      syntaxError();
+      return NULL;
+    }
+    size = atoi(tokenString);
+    haveToken = FALSE;
+    if (!match(RBRACKET) || !match(SEMI))
+      return NULL;
+    t = newDeclNode(VectorVarK);
+    t->attr.vector.name = n->name;
+    t->attr.vector.size = size;
+  }
+  else {
+    if (!match(SEMI))
+      return NULL;
+    t = newDeclNode(VarK);
+    t->attr.name = n->name;
+  }
+  t->child[0] = type;
+  t->colno = n->colno;
+  return t;
+}
+
+/* Function param parses a parameter of type type,
+ * or returns NULL for the empty one
+ */
+static TreeNode *param(TreeNode *type) {
+  TreeNode *t;
+  Name n;
+
+  if (type == NULL) {
+    if (peek() == COMMA || peek() == RPAREN)
+      return NULL;
+    if ((type = typeSpec()) == NULL)
+      return NULL;
+  }
+  if (!name(&n))
+    return NULL;
+  if (peek() == LBRACKET) {
+    haveToken = FALSE;
+    if (!match(RBRACKET))
+      return NULL;
+    t = newParamNode(VectorParamK);
+  }
+  else
+    t = newParamNode(NonVectorParamK);
+  t->child[0] = type;
+  t->attr.name = n.name;
+  t->colno = n.colno;
+  t->lineno = n.lineno;
+  return t;
+}
+
+/* Function params parses the parameter list: void
+ * alone, or parameters, any of them empty,
+ * separated by commas
+ */
+static TreeNode *params(void) {
+  TreeNode *first = NULL, *last = NULL, *type = NULL;
+
+  if (peek() == VOID) {
+    haveToken = FALSE;
+    if (peek() == RPAREN)
+      return NULL;
+    type = newTypeNode(TypeNameK);
+    type->attr.type = VOID;
+  }
+  append(&first, &last, param(type));
+  while (peek() == COMMA) {
+    haveToken = FALSE;
+    append(&first, &last, param(NULL));
+  }
+  return first;
+}
+
+static TreeNode *compound(void) {
+  TreeNode *decls = NULL, *lastDecl = NULL;
+  TreeNode *stmts = NULL, *lastStmt = NULL;
+  TreeNode *t, *type;
+  Name n;
+
+  if (!match(LBRACE))
+    return NULL;
+  while (peek() == INT || peek() == VOID) {
+    type = typeSpec();
+    if (!name(&n))
+      break;
+    append(&decls, &lastDecl, varDecl(type, &n));
+  }
+  for (;;) {
+    switch (peek()) {
+      case ID: case NUM: case LPAREN: case SEMI:
+      case LBRACE: case IF: case WHILE: case RETURN:
+        append(&stmts, &lastStmt, statement());
+        continue;
+      default:
+        break;
+    }
+    break;
+  }
+  if (!match(RBRACE))
+    return NULL;
+  t = newStmtNode(CompK);
+  t->child[0] = decls;
+  t->child[1] = stmts;
+  return t;
+}
+
+/* Function statement parses a statement; the
+ * empty statement is NULL
+ */
+static TreeNode *statement(void) {
+  TreeNode *t, *test, *body, *alt = NULL;
+
+  switch (peek()) {
+    case LBRACE:
+      return compound();
+    case SEMI:
+      haveToken = FALSE;
+      return NULL;
+    case IF:
+      haveToken = FALSE;
+      if (!match(LPAREN))
+        return NULL;
+      test = expression();
+      if (!match(RPAREN))
+        return NULL;
+      body = statement();
+      /* else goes with the nearest if */
+      if (peek() == ELSE) {
+        haveToken = FALSE;
+        alt = statement();
+      }
+      t = newStmtNode(IfK);
+      t->child[0] = test;
+      t->child[1] = body;
+      t->child[2] = alt;
+      return t;
+    case WHILE:
+      haveToken = FALSE;
+      if (!match(LPAREN))
+        return NULL;
+      test = expression();
+      if (!match(RPAREN))
+        return NULL;
+      body = statement();
+      t = newStmtNode(WhileK);
+      t->child[0] = test;
+      t->child[1] = body;
+      return t;
+    case RETURN:
+      haveToken = FALSE;
+      test = peek() == SEMI ? NULL : expression();
+      if (!match(SEMI))
+        return NULL;
+      t = newStmtNode(ReturnK);
+      t->child[0] = test;
+      return t;
+    default:
+      t = expression();
+      match(SEMI);
+      return t;
+  }
+}
+
+/* Function variable parses the variable or call
+ * that starts with the name at the token, which
+ * the caller has seen
+ */
+static TreeNode *variable(void) {
+  TreeNode *t, *last = NULL;
+  Name n = { NULL, 0, 0 };
+
+  name(&n);
+  switch (peek()) {
+    case LBRACKET:
+      t = newExpNode(VectorIdK);
+      haveToken = FALSE;
+      t->child[0] = expression();
+      match(RBRACKET);
+      break;
+    case LPAREN:
+      t = newExpNode(CallK);
+      haveToken = FALSE;
+      if (peek() != RPAREN) {
+        append(&t->child[0], &last, expression());
+        while (peek() == COMMA) {
+          haveToken = FALSE;
+          append(&t->child[0], &last, expression());
+        }
+      }
+      match(RPAREN);
+      break;
+    default:
+      t = newExpNode(IdK);
+      break;
+  }
+  t->attr.name = n.name;
+  t->colno = n.colno;
+  t->lineno = n.lineno;
+  return t;
+}
+
+static TreeNode *factor(void) {
+  TreeNode *t;
+
+  switch (peek()) {
+    case LPAREN:
+      haveToken = FALSE;
+      t = expression();
+      match(RPAREN);
+      return t;
+    case NUM:
+      t = newExpNode(ConstK);
+      t->attr.val = atoi(tokenString);
+      haveToken = FALSE;
+      return t;
+    case ID:
+      return variable();
+    default:
+      syntaxError();
+      return NULL;
+  }
+}
+
+static int precedence(TokenType op) {
+  switch (op) {
+    case EQ: case NEQ: case LT: case LET: case GT: case GET:
+      return RELPREC;
+    case PLUS: case MINUS:
+      return SUMPREC;
+    case TIMES: case OVER:
+      return MULPREC;
+    default:
+      return 0;
+  }
+}
+
+/* Function binary parses the operators of at least
+ * precedence prec that follow the operand left
+ */
+static TreeNode *binary(TreeNode *left, int prec) {
+  TreeNode *t, *right;
+  int p;
+
+  while ((p = precedence(peek())) >= prec) {
+    t = newExpNode(OpK);
+    t->attr.op = token;
+    t->type = p == RELPREC ? Boolean : Integer;
+    haveToken = FALSE;
+    right = factor();
+    while (precedence(peek()) > p)
+      right = binary(right, p + 1);
+    t->child[0] = left;
+    t->child[1] = right;
+    left = t;
+    if (p == RELPREC)
+      break;
+  }
+  return left;
+}
+
+static TreeNode *expression(void) {
+  TreeNode *t, *var, *value;
+
+  if (peek() != ID)
+    return binary(factor(), RELPREC);
+  var = variable();
+  if (var->kind.exp != CallK && peek() == ASSIGN) {
+    haveToken = FALSE;
+    value = expression();
+    t = newExpNode(AssignK);
+    t->child[0] = var;
+    t->child[1] = value;
+    return t;
+  }
+  return binary(var, RELPREC);
+}
+
+int rdParse(int (*lex)(void), void (*handler)(TreeNode *), TreeNode **tree) {
+  TreeNode *first = NULL, *last = NULL, *t, *type;
+  Name n;
+  int nDecls = 0;
+
+  nextToken = lex;
+  haveToken = failed = FALSE;
+  do {
+    type = typeSpec();
+    if (type == NULL && nDecls > 0) {
+      /* Bison reduces the whole program before it
+       * finds that the token cannot start a
+       * declaration, so the list is kept
+       */
+      *tree = first;
+      return 1;
+    }
+    if (!name(&n))
+      break;
+    if (peek() == LPAREN) {
+      t = newDeclNode(FuncK);
+      t->attr.name = n.name;
+      t->colno = n.colno;
+      haveToken = FALSE;
+      t->child[0] = type;
+      t->child[1] = params();
+      if (!match(RPAREN))
+        break;
+      t->child[2] = compound();
+    }
+    else
+      t = varDecl(type, &n);
+    if (failed)
+      break;
+    if (handler != NULL)
+      handler(t);
+    else
+      append(&first, &last, t);
+    ++nDecls;
+  } while (peek() != ENDFILE);
+  *tree = failed ? NULL : first;
+  return failed;
+}
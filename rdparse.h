@@ -0,0 +1,23 @@
+/****************************************************/
+/* File: rdparse.h                                  */
+/* Recursive-descent parser for the C- compiler,    */
+/* used by the drivers of cminus.y in place of      */
+/* yyparse when built with -DRD_PARSER              */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _RDPARSE_H_
+#define _RDPARSE_H_
+
+/* Function rdParse parses the source file as
+ * yyparse does: it reads the tokens with lex,
+ * reports a syntax error with yyerror and gives
+ * each top-level declaration to handler or, when
+ * handler is NULL, links it into the list *tree.
+ * The tree, its line numbers and the tokens read
+ * are those of the Bison parser. It returns 0, or
+ * 1 on a syntax error
+ */
+int rdParse(int (*lex)(void), void (*handler)(TreeNode *), TreeNode **tree);
+
+#endif
@@ -0,0 +1,16 @@
+/****************************************************/
+/* File: cminus_main.c                              */
+/* Entry point for compiled C- programs             */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include "cminus_rt.h"
+
+/* main of the C- program, mangled by the compiler */
+extern void cm_main(void);
+
+int main(void) {
+  cm_main();
+  cminus_flush();
+  return 0;
+}
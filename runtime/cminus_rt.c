@@ -0,0 +1,84 @@
+/****************************************************/
+/* File: cminus_rt.c                                */
+/* Runtime support for compiled C- programs         */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cminus_rt.h"
+
+/* OUTBUFSIZE is the size of the buffer of output();
+ * MAXLINE is the longest line output() writes
+ */
+#define OUTBUFSIZE 65536
+#define MAXLINE 12
+
+static char outBuf[OUTBUFSIZE];
+static int outLen = 0;
+
+void cminus_flush(void) {
+  fwrite(outBuf, 1, outLen, stdout);
+  fflush(stdout);
+  outLen = 0;
+}
+
+/* Function cminus_input implements the built-in
+ * input(): it reads one integer from stdin, after
+ * writing the pending output so that prompts are
+ * seen before the program waits
+ */
+int cminus_input(void) {
+  int c, neg = 0;
+  unsigned x = 0;
+
+  cminus_flush();
+  do
+    c = getchar_unlocked();
+  while (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+  if (c == '-' || c == '+') {
+    neg = c == '-';
+    c = getchar_unlocked();
+  }
+  if (c < '0' || c > '9') {
+    fprintf(stderr, "input: integer expected\n");
+    exit(1);
+  }
+  for (; c >= '0' && c <= '9'; c = getchar_unlocked())
+    x = 10 * x + (c - '0');
+  if (c != EOF)
+    ungetc(c, stdin);
+  return neg ? (int) -x : (int) x;
+}
+
+/* Procedure cminus_output implements the built-in
+ * output(x): it appends x and a newline to the
+ * output buffer
+ */
+void cminus_output(int x) {
+  char digits[MAXLINE];
+  unsigned u = x < 0 ? -(unsigned) x : (unsigned) x;
+  int n = 0;
+
+  if (outLen > OUTBUFSIZE - MAXLINE)
+    cminus_flush();
+  do {
+    digits[n++] = '0' + u % 10;
+    u /= 10;
+  } while (u != 0);
+  if (x < 0)
+    outBuf[outLen++] = '-';
+  while (n > 0)
+    outBuf[outLen++] = digits[--n];
+  outBuf[outLen++] = '\n';
+}
+
+/* Procedure cminus_bounds_error stops a program
+ * built with --bounds-check whose array index on
+ * source line line is out of bounds
+ */
+void cminus_bounds_error(int line) {
+  cminus_flush();
+  fprintf(stderr, "line %d: array index out of bounds\n", line);
+  exit(1);
+}
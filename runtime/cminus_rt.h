@@ -0,0 +1,34 @@
+/****************************************************/
+/* File: cminus_rt.h                                */
+/* Runtime support interface for compiled           */
+/* C- programs                                      */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _CMINUS_RT_H_
+#define _CMINUS_RT_H_
+
+/* Function cminus_input implements the built-in
+ * input(): it reads one integer from stdin
+ */
+int cminus_input(void);
+
+/* Procedure cminus_output implements the built-in
+ * output(x): it writes x and a newline to stdout.
+ * The output is buffered until cminus_flush, the
+ * next input() or the end of the program
+ */
+void cminus_output(int x);
+
+/* Procedure cminus_flush writes the buffered output
+ * of the program to stdout
+ */
+void cminus_flush(void);
+
+/* Procedure cminus_bounds_error stops a program
+ * built with --bounds-check whose array index on
+ * source line line is out of bounds
+ */
+void cminus_bounds_error(int line);
+
+#endif
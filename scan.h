@@ -10,12 +10,48 @@
 /* MAXTOKENLEN is the maximum size of a token */
 #define MAXTOKENLEN 40
 
+/* the scanner state is per thread, so that each
+ * thread can scan its own part of a program
+ */
+
 /* tokenString array stores the lexeme of each token */
-extern char tokenString[MAXTOKENLEN + 1];
+extern __thread char tokenString[MAXTOKENLEN + 1];
+
+/* tokenColumn is the column of the first
+ * character of the last token, counting from 1
+ */
+extern __thread int tokenColumn;
+
+/* tokenCount counts the tokens returned by
+ * getToken since the last resetScanner
+ */
+extern __thread int tokenCount;
 
 /* function getToken returns the
  * next token in source file
  */
 TokenType getToken(void);
 
+/* Function scanToken is getToken without the
+ * TraceScan listing, for the scanner thread of
+ * scanpipe.c
+ */
+TokenType scanToken(void);
+
+/* Procedure resetScanner makes the next call to
+ * getToken start reading a new source file
+ */
+void resetScanner(void);
+
+/* Procedure resetScannerAt is resetScanner for a
+ * source that starts at the given line and column
+ * of a program
+ */
+void resetScannerAt(int line, int column);
+
+/* Procedure freeScanner releases the scanner of
+ * the calling thread
+ */
+void freeScanner(void);
+
 #endif
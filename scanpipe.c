@@ -0,0 +1,201 @@
+/****************************************************/
+/* File: scanpipe.c                                 */
+/* Pipelined scanning for the C- compiler: a        */
+/* scanner thread feeds the parser with batches of  */
+/* tokens through a lock-free ring                  */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "scanpipe.h"
+
+/* the ring holds NBATCHES batches of at most
+ * BATCHTOKENS tokens each; the text of a batch holds
+ * the lexemes of its tokens and, with TraceScan,
+ * their lines of the listing
+ */
+#define NBATCHES 8
+#define BATCHTOKENS 1024
+#define BATCHTEXT 32768
+
+/* the longest TraceScan line of a token */
+#define MAXTRACE (MAXTOKENTEXT + 16)
+
+/* a waiting thread spins SPINS times before it
+ * starts to give its processor away
+ */
+#define SPINS 1000
+
+/* a token read by the scanner thread: its lexeme
+ * and its TraceScan line are slices of the text of
+ * its batch
+ */
+typedef struct {
+  int type;
+  int lineno;
+  int column;
+  int text;                /* offset of the lexeme in the batch text */
+  unsigned char len;       /* length of the lexeme */
+  unsigned char traceLen;  /* length of the TraceScan line after it */
+} TokenRec;
+
+typedef struct {
+  TokenRec tokens[BATCHTOKENS];
+  int nTokens;
+  char text[BATCHTEXT];
+} Batch;
+
+/* The ring has one producer, the scanner thread,
+ * and one consumer, the parser. filled counts the
+ * batches the scanner has published and taken those
+ * the parser has given back; each is written by one
+ * side only, with release order, so that a batch is
+ * never read while it is being filled or the other
+ * way round
+ */
+typedef struct {
+  Batch batches[NBATCHES];
+  atomic_uint filled;
+  atomic_uint taken;
+  atomic_int stop;       /* the parser needs no more tokens */
+  pthread_t thread;
+  FILE *source;          /* where the scanner starts */
+  int lineno;
+  Batch *current;        /* the batch the parser reads, or NULL */
+  int next;              /* its next token */
+} ScanPipe;
+
+/* the pipe of the parser of the calling thread */
+static __thread ScanPipe *scanPipe = NULL;
+
+/* Procedure backOff waits a little for the other
+ * side of the ring, after spins tries
+ */
+static void backOff(int spins) {
+  if (spins > SPINS)
+    sched_yield();
+}
+
+/* Function scanAhead is the scanner thread: it
+ * fills the batches of the ring until the end of the
+ * file, or until the parser stops it
+ */
+static void *scanAhead(void *arg) {
+  ScanPipe *p = (ScanPipe *) arg;
+  unsigned filled = 0;
+  TokenType token = ERROR;
+  int spins;
+
+  source = p->source;
+  lineno = p->lineno;
+  resetScanner();
+  while (token != ENDFILE) {
+    Batch *b;
+    int len = 0;
+
+    for (spins = 0; ; ++spins) {
+      if (atomic_load_explicit(&p->stop, memory_order_relaxed))
+        goto done;
+      if (filled - atomic_load_explicit(&p->taken, memory_order_acquire) < NBATCHES)
+        break;
+      backOff(spins);
+    }
+    b = &p->batches[filled % NBATCHES];
+    b->nTokens = 0;
+    do {
+      TokenRec *r = &b->tokens[b->nTokens++];
+      token = scanToken();
+      r->type = token;
+      r->lineno = lineno;
+      r->column = tokenColumn;
+      r->text = len;
+      r->len = strlen(tokenString);
+      memcpy(b->text + len, tokenString, r->len);
+      len += r->len;
+      r->traceLen = 0;
+      if (TraceScan) {
+        r->traceLen = snprintf(b->text + len, MAXTRACE, "\t%d: ", lineno);
+        r->traceLen += formatToken(b->text + len + r->traceLen, MAXTRACE - r->traceLen,
+                                   token, tokenString);
+        len += r->traceLen;
+      }
+    } while (token != ENDFILE && b->nTokens < BATCHTOKENS &&
+             len + MAXTOKENLEN + MAXTRACE <= BATCHTEXT);
+    atomic_store_explicit(&p->filled, ++filled, memory_order_release);
+  }
+done:
+  freeScanner();
+  return NULL;
+}
+
+int startScanPipe(void) {
+  ScanPipe *p;
+
+  /* on one processor the two threads would only
+   * take turns
+   */
+  if (sysconf(_SC_NPROCESSORS_ONLN) < 2)
+    return FALSE;
+  p = (ScanPipe *) malloc(sizeof(ScanPipe));
+  if (p == NULL)
+    return FALSE;
+  atomic_init(&p->filled, 0);
+  atomic_init(&p->taken, 0);
+  atomic_init(&p->stop, FALSE);
+  p->source = source;
+  p->lineno = lineno;
+  p->current = NULL;
+  p->next = 0;
+  if (pthread_create(&p->thread, NULL, scanAhead, p) != 0) {
+    free(p);
+    return FALSE;
+  }
+  scanPipe = p;
+  tokenCount = 0;
+  return TRUE;
+}
+
+TokenType pipedToken(void) {
+  ScanPipe *p = scanPipe;
+  TokenRec *r;
+  TokenType token;
+  int spins;
+
+  if (p->current == NULL) {
+    unsigned taken = atomic_load_explicit(&p->taken, memory_order_relaxed);
+    for (spins = 0; atomic_load_explicit(&p->filled, memory_order_acquire) == taken; ++spins)
+      backOff(spins);
+    p->current = &p->batches[taken % NBATCHES];
+    p->next = 0;
+  }
+  r = &p->current->tokens[p->next++];
+  lineno = r->lineno;
+  tokenColumn = r->column;
+  memcpy(tokenString, p->current->text + r->text, r->len);
+  tokenString[r->len] = '\0';
+  if (r->traceLen > 0)
+    fwrite(p->current->text + r->text + r->len, 1, r->traceLen, listing);
+  ++tokenCount;
+  token = r->type;
+  if (p->next == p->current->nTokens) {
+    /* give the batch back to the scanner */
+    p->current = NULL;
+    atomic_fetch_add_explicit(&p->taken, 1, memory_order_release);
+  }
+  return token;
+}
+
+void stopScanPipe(void) {
+  ScanPipe *p = scanPipe;
+
+  atomic_store_explicit(&p->stop, TRUE, memory_order_relaxed);
+  pthread_join(p->thread, NULL);
+  free(p);
+  scanPipe = NULL;
+}
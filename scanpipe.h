@@ -0,0 +1,34 @@
+/****************************************************/
+/* File: scanpipe.h                                 */
+/* Pipelined scanning for the C- compiler: a        */
+/* scanner thread runs ahead of the parser          */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _SCANPIPE_H_
+#define _SCANPIPE_H_
+
+/* Function startScanPipe starts a thread that scans
+ * the source file of the calling thread, from its
+ * current line, into a ring of token batches. It
+ * returns FALSE on a single processor or if the
+ * thread cannot be started, and the tokens must
+ * then come from getToken
+ */
+int startScanPipe(void);
+
+/* Function pipedToken returns the next token of the
+ * scanner thread, setting tokenString, tokenColumn,
+ * lineno and tokenCount as getToken does, and
+ * writes its TraceScan line, which the scanner
+ * thread formatted, to the listing file
+ */
+TokenType pipedToken(void);
+
+/* Procedure stopScanPipe stops the scanner thread,
+ * which may not have reached the end of the file,
+ * and waits for it
+ */
+void stopScanPipe(void);
+
+#endif
@@ -0,0 +1,274 @@
+/****************************************************/
+/* File: server.c                                   */
+/* Compile server for the C- compiler: compiles     */
+/* source buffers sent over a Unix socket in one    */
+/* long-lived process                               */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "parse.h"
+#include "analyze.h"
+#include "bounds.h"
+#include "fold.h"
+#include "cgen.h"
+#include "server.h"
+
+/* the largest source buffer a request may carry */
+#define MAXREQUEST (64 * 1024 * 1024)
+
+typedef enum { CmdCheck, CmdSymtab, CmdAsm, CmdStats, CmdShutdown } Command;
+
+static const struct {
+  const char *name;
+  Command cmd;
+} commands[] = {
+  { "check",    CmdCheck },
+  { "symtab",   CmdSymtab },
+  { "asm",      CmdAsm },
+  { "stats",    CmdStats },
+  { "shutdown", CmdShutdown },
+  { NULL, CmdCheck }
+};
+
+/* latency of every compile request, in milliseconds */
+static double *latency;
+static int nLatency, latencyCap;
+
+static volatile sig_atomic_t stopping = FALSE;
+
+static void stop(int sig) {
+  stopping = TRUE;
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+static void addLatency(double ms) {
+  if (nLatency == latencyCap) {
+    latencyCap = latencyCap ? 2 * latencyCap : 256;
+    latency = (double *) realloc(latency, latencyCap * sizeof(double));
+  }
+  latency[nLatency++] = ms;
+}
+
+static int compareDouble(const void *a, const void *b) {
+  double x = *(const double *) a;
+  double y = *(const double *) b;
+  return x < y ? -1 : x > y;
+}
+
+/* Procedure printLatency prints the count and the
+ * latency percentiles of the compile requests
+ */
+static void printLatency(FILE *out) {
+  static const int pct[] = { 50, 90, 99 };
+  double *sorted;
+  int i;
+
+  fprintf(out, "requests %d\n", nLatency);
+  if (nLatency == 0)
+    return;
+  sorted = (double *) malloc(nLatency * sizeof(double));
+  memcpy(sorted, latency, nLatency * sizeof(double));
+  qsort(sorted, nLatency, sizeof(double), compareDouble);
+  for (i = 0; i < 3; ++i)
+    fprintf(out, "p%d %.3f ms\n", pct[i],
+            sorted[(nLatency - 1) * pct[i] / 100]);
+  fprintf(out, "max %.3f ms\n", sorted[nLatency - 1]);
+  free(sorted);
+}
+
+/* Function compile runs the compiler over the len
+ * bytes of text and leaves the reply in a buffer
+ * of out; it returns FALSE if the program has errors
+ */
+static int compile(Command cmd, char *text, size_t len, char **out, size_t *outLen) {
+  FILE *savedListing = listing;
+  FILE *savedSource = source;
+  int savedTrace = TraceAnalyze;
+  TreeNode *syntaxTree = NULL;
+  FILE *result = open_memstream(out, outLen);
+
+  if (result == NULL)
+    return FALSE;
+  listing = result;
+  TraceAnalyze = cmd == CmdSymtab;
+  lineno = 0;
+  Error = FALSE;
+  resetScanner();
+
+  source = fmemopen(text, len, "r");
+  if (source != NULL) {
+    syntaxTree = parse();
+    fclose(source);
+  }
+  else
+    Error = TRUE;
+
+  if (!Error) {
+    buildSymtab(syntaxTree);
+    typeCheck(syntaxTree);
+  }
+  if (!Error && FoldCalls)
+    foldCalls(syntaxTree);
+  if (!Error)
+    checkBounds(syntaxTree);
+  if (!Error && cmd == CmdAsm) {
+    code = result;
+    codeGen(syntaxTree, "request.s");
+  }
+  freeTree(syntaxTree);
+
+  fclose(result);
+  listing = savedListing;
+  source = savedSource;
+  TraceAnalyze = savedTrace;
+  return !Error;
+}
+
+static int writeAll(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, buf, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return FALSE;
+    buf += n;
+    len -= n;
+  }
+  return TRUE;
+}
+
+static int reply(int fd, int ok, const char *text, size_t len) {
+  char header[64];
+  snprintf(header, sizeof(header), "%s %lu\n", ok ? "ok" : "error",
+           (unsigned long) len);
+  return writeAll(fd, header, strlen(header)) && writeAll(fd, text, len);
+}
+
+/* Procedure serveClient answers the requests of one
+ * connection until the client closes it
+ */
+static void serveClient(int fd) {
+  FILE *in = fdopen(dup(fd), "r");
+  char line[128], name[32];
+  unsigned long len;
+  char *text = NULL;
+  size_t textCap = 0;
+  char *out;
+  size_t outLen;
+  int i, ok;
+
+  if (in == NULL)
+    return;
+  while (!stopping && fgets(line, sizeof(line), in) != NULL) {
+    if (sscanf(line, "%31s %lu", name, &len) != 2 || len > MAXREQUEST) {
+      reply(fd, FALSE, "bad request\n", 12);
+      break;
+    }
+    for (i = 0; commands[i].name != NULL; ++i)
+      if (strcmp(commands[i].name, name) == 0)
+        break;
+    /* fmemopen needs a non-empty buffer, so an empty
+     * source is passed as a single newline
+     */
+    if (len + 1 > textCap) {
+      textCap = len + 1;
+      text = (char *) realloc(text, textCap);
+    }
+    if (fread(text, 1, len, in) != len)
+      break;
+    text[len] = '\n';
+
+    if (commands[i].name == NULL) {
+      reply(fd, FALSE, "unknown command\n", 16);
+      continue;
+    }
+    out = NULL;
+    outLen = 0;
+    switch (commands[i].cmd) {
+      case CmdStats: {
+          FILE *f = open_memstream(&out, &outLen);
+          printLatency(f);
+          fclose(f);
+          ok = TRUE;
+        }
+        break;
+      case CmdShutdown:
+        stopping = TRUE;
+        ok = TRUE;
+        break;
+      default: {
+          double start = now();
+          ok = compile(commands[i].cmd, text, len > 0 ? len : 1, &out, &outLen);
+          addLatency(now() - start);
+        }
+        break;
+    }
+    ok = reply(fd, ok, out != NULL ? out : "", outLen);
+    free(out);
+    if (!ok)
+      break;
+  }
+  free(text);
+  fclose(in);
+}
+
+void serve(const char *path) {
+  struct sockaddr_un addr;
+  struct sigaction sa;
+  int fd, conn;
+
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Socket path too long: %s\n", path);
+    exit(1);
+  }
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    perror("socket");
+    exit(1);
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  unlink(path);
+  if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+    perror(path);
+    exit(1);
+  }
+
+  /* no SA_RESTART, so that a signal interrupts accept */
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = stop;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  fprintf(stderr, "cminus: serving on %s\n", path);
+  while (!stopping) {
+    conn = accept(fd, NULL, NULL);
+    if (conn < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("accept");
+      break;
+    }
+    serveClient(conn);
+    close(conn);
+  }
+  close(fd);
+  unlink(path);
+  printLatency(stderr);
+}
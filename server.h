@@ -0,0 +1,31 @@
+/****************************************************/
+/* File: server.h                                   */
+/* Compile server interface for the C- compiler     */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+/* Procedure serve listens on the Unix socket path
+ * and compiles the source buffers clients send,
+ * until a client sends "shutdown" or the process is
+ * interrupted. Each request is a line
+ *
+ *     <command> <length>
+ *
+ * followed by length bytes of C- source, where
+ * command is one of
+ *
+ *     check     diagnostics only
+ *     symtab    diagnostics and the symbol table
+ *     asm       x86-64 assembly, or the diagnostics
+ *     stats     latency percentiles of the requests
+ *     shutdown  stop the server
+ *
+ * and each reply is a line "ok <length>" or
+ * "error <length>" followed by length bytes of text
+ */
+void serve(const char *path);
+
+#endif
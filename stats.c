@@ -0,0 +1,161 @@
+/****************************************************/
+/* File: stats.c                                    */
+/* Compiler statistics (--time-report) for the      */
+/* C- compiler: wall and CPU time per phase, size   */
+/* of the tree and symbol table, and peak memory    */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include <time.h>
+#include <sys/resource.h>
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "symtab.h"
+#include "code.h"
+#include "peephole.h"
+#include "fold.h"
+#include "stats.h"
+
+static const char *phaseName[NPHASES] = {
+  "parse", "symtab", "typecheck", "fold", "bounds", "codegen", "run"
+};
+
+/* accumulated and starting times of each phase, in
+ * seconds of wall clock and of process CPU time
+ */
+static double wallTime[NPHASES], cpuTime[NPHASES];
+static double wallStart[NPHASES], cpuStart[NPHASES];
+static int phaseRan[NPHASES];
+
+/* the nodes of the declarations compiled by --stream */
+static long streamedNodes;
+
+static double clockSeconds(clockid_t id) {
+  struct timespec ts;
+  clock_gettime(id, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void phaseStart(Phase p) {
+  wallStart[p] = clockSeconds(CLOCK_MONOTONIC);
+  cpuStart[p] = clockSeconds(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+void phaseEnd(Phase p) {
+  wallTime[p] += clockSeconds(CLOCK_MONOTONIC) - wallStart[p];
+  cpuTime[p] += clockSeconds(CLOCK_PROCESS_CPUTIME_ID) - cpuStart[p];
+  phaseRan[p] = TRUE;
+}
+
+/* Function countNodes returns the number of nodes
+ * of the syntax tree
+ */
+static long countNodes(TreeNode *tree) {
+  long n = 0;
+  int i;
+  for (; tree != NULL; tree = tree->sibling) {
+    ++n;
+    for (i = 0; i < MAXCHILDREN; ++i)
+      n += countNodes(tree->child[i]);
+  }
+  return n;
+}
+
+void countStreamed(TreeNode *t) {
+  streamedNodes += countNodes(t);
+}
+
+/* Function treeNodes returns the AST nodes of the
+ * report
+ */
+static long treeNodes(TreeNode *syntaxTree) {
+  return Stream ? streamedNodes : countNodes(syntaxTree);
+}
+
+/* Function peakRss returns the peak resident set
+ * size of the process, in kilobytes
+ */
+static long peakRss(void) {
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) != 0)
+    return 0;
+  return ru.ru_maxrss;
+}
+
+void printStats(FILE *out, const char *file, TreeNode *syntaxTree) {
+  SymtabStats st;
+  double wall = 0, cpu = 0;
+  int p, i;
+
+  st_stats(&st);
+  fprintf(out, "\nTime report: %s\n", file);
+  fprintf(out, "  %-12s %12s %12s\n", "phase", "wall (ms)", "cpu (ms)");
+  fprintf(out, "  ------------ ------------ ------------\n");
+  for (p = 0; p < NPHASES; ++p) {
+    if (!phaseRan[p])
+      continue;
+    fprintf(out, "  %-12s %12.3f %12.3f\n", phaseName[p],
+            1e3 * wallTime[p], 1e3 * cpuTime[p]);
+    wall += wallTime[p];
+    cpu += cpuTime[p];
+  }
+  fprintf(out, "  %-12s %12.3f %12.3f\n", "total", 1e3 * wall, 1e3 * cpu);
+
+  fprintf(out, "\n  tokens       %12d\n", tokenCount);
+  fprintf(out, "  AST nodes    %12ld\n", treeNodes(syntaxTree));
+  fprintf(out, "  scopes       %12d\n", st.scopes);
+  fprintf(out, "  symbols      %12d\n", st.symbols);
+  fprintf(out, "  hash chains  %12d used of %d, longest %d, average %.2f\n",
+          st.usedBuckets, st.buckets, st.maxChain,
+          st.usedBuckets ? (double) st.symbols / st.usedBuckets : 0.0);
+  fprintf(out, "  chain length");
+  for (i = 0; i < CHAINHIST; ++i)
+    fprintf(out, "  %d%s: %d", i + 1, i == CHAINHIST - 1 ? "+" : "",
+            st.chainHist[i]);
+  fputc('\n', out);
+  if (phaseRan[PhaseFold])
+    fprintf(out, "  folded calls %12d\n", foldCount());
+  if (phaseRan[PhaseCodegen]) {
+    fprintf(out, "  instructions %12d\n", codeLen);
+    if (Peephole)
+      printPeephole(out);
+  }
+  fprintf(out, "  peak RSS     %12ld KB\n", peakRss());
+}
+
+void writeStatsJson(FILE *out, const char *file, TreeNode *syntaxTree) {
+  SymtabStats st;
+  int p, i, first = TRUE;
+
+  st_stats(&st);
+  fprintf(out, "{\"file\": ");
+  printJsonString(out, file);
+  fprintf(out, ", \"phases\": {");
+  for (p = 0; p < NPHASES; ++p) {
+    if (!phaseRan[p])
+      continue;
+    fprintf(out, "%s\"%s\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f}",
+            first ? "" : ", ", phaseName[p],
+            1e3 * wallTime[p], 1e3 * cpuTime[p]);
+    first = FALSE;
+  }
+  fprintf(out, "}, \"tokens\": %d, \"ast_nodes\": %ld", tokenCount,
+          treeNodes(syntaxTree));
+  fprintf(out, ", \"scopes\": %d, \"symbols\": %d", st.scopes, st.symbols);
+  fprintf(out, ", \"hash_chains\": {\"buckets\": %d, \"used\": %d, \"longest\": %d"
+               ", \"histogram\": [", st.buckets, st.usedBuckets, st.maxChain);
+  for (i = 0; i < CHAINHIST; ++i)
+    fprintf(out, "%s%d", i ? ", " : "", st.chainHist[i]);
+  fprintf(out, "]}");
+  if (phaseRan[PhaseFold])
+    fprintf(out, ", \"folded_calls\": %d", foldCount());
+  if (phaseRan[PhaseCodegen]) {
+    fprintf(out, ", \"instructions\": %d", codeLen);
+    if (Peephole) {
+      fprintf(out, ", \"peephole\": ");
+      writePeepholeJson(out);
+    }
+  }
+  fprintf(out, ", \"peak_rss_kb\": %ld}\n", peakRss());
+}
@@ -0,0 +1,47 @@
+/****************************************************/
+/* File: stats.h                                    */
+/* Compiler statistics (--time-report) for the      */
+/* C- compiler                                      */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+/* compiler phases timed by the time report */
+typedef enum {
+  PhaseParse,    /* scanning and parsing, interleaved */
+  PhaseSymtab,   /* buildSymtab */
+  PhaseTypes,    /* typeCheck */
+  PhaseFold,     /* foldCalls */
+  PhaseBounds,   /* checkBounds */
+  PhaseCodegen,  /* code generation and JIT loading */
+  PhaseRun,      /* execution of JIT code */
+  NPHASES
+} Phase;
+
+/* Procedures phaseStart and phaseEnd delimit a run
+ * of phase p; the times of repeated runs add up
+ */
+void phaseStart(Phase p);
+void phaseEnd(Phase p);
+
+/* Procedure countStreamed adds the nodes of the
+ * top-level declaration t, which --stream compiles
+ * and frees, to the AST nodes of the report; with
+ * --stream the tree given to printStats holds only
+ * what stream.c keeps of each declaration
+ */
+void countStreamed(TreeNode *t);
+
+/* Procedure printStats prints the phase times and
+ * the size figures of the compilation of file to out
+ */
+void printStats(FILE *out, const char *file, TreeNode *syntaxTree);
+
+/* Procedure writeStatsJson writes the same report
+ * as printStats as a JSON object
+ */
+void writeStatsJson(FILE *out, const char *file, TreeNode *syntaxTree);
+
+#endif
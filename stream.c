@@ -0,0 +1,177 @@
+/****************************************************/
+/* File: stream.c                                   */
+/* Streaming compilation for the C- compiler: each  */
+/* top-level declaration is compiled and freed as   */
+/* soon as the parser reduces it                    */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "symtab.h"
+#include "parse.h"
+#include "analyze.h"
+#include "callgraph.h"
+#include "bounds.h"
+#include "code.h"
+#include "cgen.h"
+#include "csource.h"
+#include "peephole.h"
+#include "stats.h"
+#include "stream.h"
+
+/* the declarations kept once compiled, in source
+ * order: global variables and function signatures
+ */
+static TreeNode *kept = NULL, *lastKept = NULL;
+
+/* Function keepNode returns a copy of the node t
+ * outside the tree arena, without its sibling
+ */
+static TreeNode *keepNode(TreeNode *t) {
+  TreeNode *k;
+
+  if (t == NULL)
+    return NULL;
+  k = (TreeNode *) malloc(sizeof(TreeNode));
+  *k = *t;
+  k->sibling = NULL;
+  return k;
+}
+
+static char *keepString(const char *s) {
+  return strcpy((char *) malloc(strlen(s) + 1), s);
+}
+
+/* Function keepDecl copies the declaration t out of
+ * the tree arena with its type and parameters; the
+ * copy of a function shares the body of t
+ */
+static TreeNode *keepDecl(TreeNode *t) {
+  TreeNode *k = keepNode(t);
+  TreeNode *p, **next;
+
+  k->child[0] = keepNode(t->child[0]);
+  switch (t->kind.decl) {
+    case FuncK:
+      k->attr.name = keepString(t->attr.name);
+      next = &k->child[1];
+      for (p = t->child[1]; p != NULL; p = p->sibling) {
+        *next = keepNode(p);
+        (*next)->attr.name = keepString(p->attr.name);
+        (*next)->child[0] = keepNode(p->child[0]);
+        next = &(*next)->sibling;
+      }
+      break;
+    case VarK:
+      k->attr.name = keepString(t->attr.name);
+      break;
+    case VectorVarK:
+      k->attr.vector.name = keepString(t->attr.vector.name);
+      break;
+    default:
+      break;
+  }
+  return k;
+}
+
+/* Procedure compileDecl runs every pass over the
+ * top-level declaration t that the parser has just
+ * reduced, then frees its nodes
+ */
+static void compileDecl(TreeNode *t) {
+  TreeNode *decl;
+  int first = st_count();
+  int generated = FALSE;
+
+  phaseEnd(PhaseParse);
+  if (TimeReport || StatsFile != NULL)
+    countStreamed(t);
+  if (TraceParse)
+    printTree(t);
+  decl = keepDecl(t);
+  if (lastKept == NULL)
+    kept = decl;
+  else
+    lastKept->sibling = decl;
+  lastKept = decl;
+
+  phaseStart(PhaseSymtab);
+  insertDecl(decl);
+  phaseEnd(PhaseSymtab);
+  if (TraceAnalyze)
+    printScopes(listing, first);
+  phaseStart(PhaseTypes);
+  checkDecls(decl);
+  phaseEnd(PhaseTypes);
+  if (!Error) {
+    phaseStart(PhaseBounds);
+    checkBoundsDecl(decl);
+    phaseEnd(PhaseBounds);
+  }
+  if (!Error && Target == TargetC) {
+    phaseStart(PhaseCodegen);
+    cSourceDecl(decl);
+    generated = TRUE;
+    phaseEnd(PhaseCodegen);
+  }
+  else if (!Error && Target != NoTarget) {
+    phaseStart(PhaseCodegen);
+    genDecl(decl);
+    generated = TRUE;
+    if (Target == TargetX86) {
+      if (Peephole)
+        peephole();
+      writeText(code);
+      codeLen = 0;
+    }
+    phaseEnd(PhaseCodegen);
+  }
+
+  if (decl->kind.decl == FuncK) {
+    /* genDecl releases the scopes it generates */
+    if (!generated)
+      releaseScopes(decl);
+    decl->child[2] = NULL;
+  }
+  freeTree(t);
+  phaseStart(PhaseParse);
+}
+
+TreeNode *streamProgram(char *codefile) {
+  int parsed;
+
+  kept = lastKept = NULL;
+  beginSymtab();
+  if (TraceAnalyze && !JsonListing)
+    fprintf(listing, "\nSymbol table:\n\n");
+  codeReset();
+  resetPeephole();
+  if (Target == TargetX86) {
+    fprintf(code, "# C- Compilation to x86-64 Code\n");
+    fprintf(code, "# File: %s\n", codefile);
+    fprintf(code, "\t.text\n");
+  }
+  else if (Target == TargetC)
+    cSourceHeader(codefile);
+
+  phaseStart(PhaseParse);
+  parsed = parseStream(compileDecl);
+  phaseEnd(PhaseParse);
+
+  endSymtab();
+  if (!parsed)
+    return kept;
+  if (TraceAnalyze)
+    printScopes(listing, 0);
+  if (kept != NULL)
+    checkMain(kept);
+  if (DumpCallGraph)
+    printCallGraph(listing);
+  printBounds();
+  if (!Error && Target == TargetJit && Peephole)
+    peephole();
+  if (!Error && Target == TargetX86)
+    writeData(code);
+  return kept;
+}
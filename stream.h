@@ -0,0 +1,23 @@
+/****************************************************/
+/* File: stream.h                                   */
+/* Streaming compilation for the C- compiler        */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _STREAM_H_
+#define _STREAM_H_
+
+/* Function streamProgram parses the source file and
+ * analyses, generates code for and frees each
+ * top-level declaration as soon as it is parsed.
+ * Only the global variables and the signatures of
+ * the functions are kept, and they are returned as
+ * the declaration list. With TargetX86 and TargetC
+ * each declaration is written to the code file as it
+ * is done, with codefile named in its header; with
+ * TargetJit the code of the whole program is left
+ * in the instruction buffer of code.h
+ */
+TreeNode *streamProgram(char *codefile);
+
+#endif
@@ -12,13 +12,13 @@
 #include <string.h>
 #include "globals.h"
 #include "symtab.h"
+#include "util.h"
 
 
 /* SHIFT is the power of two used as multiplier
    in hash function  */
 #define SHIFT 4
 
-#define MAX_SCOPE 1000
 
 /* the hash function */
 static int hash(const char *key) {
@@ -31,44 +31,208 @@ static int hash(const char *key) {
   return temp;
 }
 
-static Scope scopes[MAX_SCOPE];
+Scope globalScope;
+
+/* the registry of the scopes created since the last
+ * st_reset, in creation order; it doubles when full
+ * and a released scope leaves a NULL slot, which is
+ * given back when it is at the end
+ */
+static Scope *scopes = NULL;
 static int nScope = 0;
-static Scope scopeStack[MAX_SCOPE];
-static int nScopeStack = 0;
-static int location[MAX_SCOPE];
+static int maxScope = 0;
+
+/* released scopes, kept for sc_create to reuse */
+static Scope freeScopes = NULL;
+
+/* the size figures of the released scopes */
+static SymtabStats released;
+
+/* a scope shares this table until its first symbol
+ * is inserted, so that blocks that declare nothing
+ * cost no hash table
+ */
+static BucketList emptyTable[SIZE];
+
+/* the scope stack is per thread, so that function
+ * bodies can be type checked concurrently; each entry
+ * holds the next location of its scope. The stack
+ * grows with the nesting depth and is freed when it
+ * is emptied
+ */
+typedef struct {
+  Scope scope;
+  int location;
+} StackEntry;
+
+static __thread StackEntry *scopeStack = NULL;
+static __thread int nScopeStack = 0;
+static __thread int maxScopeStack = 0;
 
 Scope sc_top(void) {
-  return scopeStack[nScopeStack - 1];
+  if (nScopeStack == 0)
+    return NULL;
+  return scopeStack[nScopeStack - 1].scope;
 }
 
 void sc_pop(void) {
-  // printf("pop %s\n", sc_top()->funcName);
-  --nScopeStack;
+  if (--nScopeStack == 0) {
+    free(scopeStack);
+    scopeStack = NULL;
+    maxScopeStack = 0;
+  }
 }
 
 int addLocation(void) {
-  return location[nScopeStack - 1]++;
+  return scopeStack[nScopeStack - 1].location++;
 }
 
 void sc_push(Scope scope) {
-  // printf("push %s\n", scope->funcName);
-  scopeStack[nScopeStack] = scope;
-  location[nScopeStack++] = 0;
+  if (nScopeStack == maxScopeStack) {
+    maxScopeStack = maxScopeStack ? 2 * maxScopeStack : 16;
+    scopeStack = (StackEntry *)
+      realloc(scopeStack, maxScopeStack * sizeof(StackEntry));
+  }
+  scopeStack[nScopeStack].scope = scope;
+  scopeStack[nScopeStack++].location = 0;
+}
+
+/* Procedure freeSymbols frees the symbols and the
+ * hash table of scope sc
+ */
+static void freeSymbols(Scope sc) {
+  int j;
+
+  if (sc->hashTable == emptyTable)
+    return;
+  for (j = 0; j < SIZE; ++j) {
+    BucketList l = sc->hashTable[j];
+    while (l != NULL) {
+      BucketList next = l->next;
+      free(l->uses);
+      free(l);
+      l = next;
+    }
+  }
+  free(sc->hashTable);
+}
+
+/* Procedure st_reset discards every scope and
+ * symbol so that a new program can be analysed
+ */
+void st_reset(void) {
+  int i;
+
+  for (i = 0; i < nScope; ++i)
+    if (scopes[i] != NULL) {
+      freeSymbols(scopes[i]);
+      free(scopes[i]);
+    }
+  while (freeScopes != NULL) {
+    Scope next = freeScopes->parent;
+    free(freeScopes);
+    freeScopes = next;
+  }
+  free(scopes);
+  scopes = NULL;
+  nScope = maxScope = 0;
+  memset(&released, 0, sizeof(SymtabStats));
+  free(scopeStack);
+  scopeStack = NULL;
+  nScopeStack = maxScopeStack = 0;
+  globalScope = NULL;
+}
+
+/* Procedure addStats adds the size figures of
+ * scope sc to s
+ */
+static void addStats(SymtabStats *s, Scope sc) {
+  int j, n;
+  BucketList l;
+
+  s->scopes++;
+  if (sc->hashTable == emptyTable)
+    return;
+  s->buckets += SIZE;
+  for (j = 0; j < SIZE; ++j) {
+    n = 0;
+    for (l = sc->hashTable[j]; l != NULL; l = l->next)
+      ++n;
+    if (n == 0)
+      continue;
+    s->symbols += n;
+    s->usedBuckets++;
+    if (n > s->maxChain)
+      s->maxChain = n;
+    s->chainHist[(n < CHAINHIST ? n : CHAINHIST) - 1]++;
+  }
+}
+
+/* Procedure st_stats fills s with the size figures
+ * of the scopes created since the last st_reset
+ */
+void st_stats(SymtabStats *s) {
+  int i;
+
+  *s = released;
+  for (i = 0; i < nScope; ++i)
+    if (scopes[i] != NULL)
+      addStats(s, scopes[i]);
+}
+
+/* Function st_scope returns the i-th scope created
+ * since the last st_reset, or NULL past the last one
+ * or if it was released
+ */
+Scope st_scope(int i) {
+  return i >= 0 && i < nScope ? scopes[i] : NULL;
+}
+
+/* Function st_count returns the number of slots
+ * of the scope registry, the index of the next
+ * scope to be created
+ */
+int st_count(void) {
+  return nScope;
 }
 
 Scope sc_create(char *funcName) {
   Scope newScope;
 
-  newScope = (Scope) malloc(sizeof(struct ScopeRec));
+  if (freeScopes != NULL) {
+    newScope = freeScopes;
+    freeScopes = newScope->parent;
+  }
+  else
+    newScope = (Scope) malloc(sizeof(struct ScopeRec));
   newScope->funcName = funcName;
   newScope->nestedLevel = nScopeStack;
   newScope->parent = sc_top();
+  newScope->hashTable = emptyTable;
 
+  if (nScope == maxScope) {
+    maxScope = maxScope ? 2 * maxScope : 64;
+    scopes = (Scope *) realloc(scopes, maxScope * sizeof(Scope));
+  }
+  newScope->id = nScope;
   scopes[nScope++] = newScope;
 
   return newScope;
 }
 
+/* Procedure st_release frees the symbols of scope
+ * sc and keeps the scope for sc_create to reuse
+ */
+void st_release(Scope sc) {
+  addStats(&released, sc);
+  freeSymbols(sc);
+  scopes[sc->id] = NULL;
+  while (nScope > 0 && scopes[nScope - 1] == NULL)
+    --nScope;
+  sc->parent = freeScopes;
+  freeScopes = sc;
+}
+
 BucketList st_bucket(const char *name) {
   int h = hash(name);
   Scope sc = sc_top();
@@ -89,20 +253,41 @@ BucketList st_bucket(const char *name) {
  * loc = memory location is inserted only the
  * first time, otherwise ignored
  */
+/* Procedure addUse appends a use to the uses of l,
+ * doubling the array when it is full
+ */
+static void addUse(BucketList l, int lineno, int colno, UseKind kind) {
+  if (l->nUses == l->maxUses) {
+    l->maxUses = l->maxUses ? 2 * l->maxUses : 4;
+    l->uses = (XrefUse *) realloc(l->uses, l->maxUses * sizeof(XrefUse));
+  }
+  l->uses[l->nUses].lineno = lineno;
+  l->uses[l->nUses].colno = colno;
+  l->uses[l->nUses].kind = kind;
+  l->nUses++;
+}
+
 void st_insert(char *name, int lineno, int loc, TreeNode *treeNode) {
   int h = hash(name);
   Scope top = sc_top();
-  BucketList l =  top->hashTable[h];
+  BucketList l;
+
+  if (top->hashTable == emptyTable)
+    top->hashTable = (BucketList *) calloc(SIZE, sizeof(BucketList));
+  l = top->hashTable[h];
   while ((l != NULL) && (strcmp(name,l->name) != 0))
     l = l->next;
   if (l == NULL) { /* variable not yet in table */
     l = (BucketList) malloc(sizeof(struct BucketListRec));
     l->name = name;
     l->treeNode = treeNode;
-    l->lines = (LineList) malloc(sizeof(struct LineListRec));
-    l->lines->lineno = lineno;
+    l->uses = NULL;
+    l->nUses = l->maxUses = 0;
+    if (lineno > 0)
+      addUse(l, lineno, treeNode->colno, UseDecl);
     l->memloc = loc;
-    l->lines->next = NULL;
+    l->offset = 0;
+    l->scope = top;
     l->next = top->hashTable[h];
     top->hashTable[h] = l;
   }
@@ -137,7 +322,7 @@ int st_lookup_top(char *name) {
 
 int st_lookup_top_func(char *name) {
   int h = hash(name);
-  Scope sc = scopeStack[0];
+  Scope sc = scopeStack[0].scope;
   while(sc) {
     BucketList l = sc->hashTable[h];
     while ((l != NULL) && (strcmp(name, l->name) != 0))
@@ -150,100 +335,116 @@ int st_lookup_top_func(char *name) {
   return -1;
 }
 
-int st_add_lineno(char *name, int lineno) {
-  BucketList l = st_bucket(name);
-  LineList ll = l->lines;
-  while (ll->next != NULL)
-    ll = ll->next;
-  ll->next = (LineList) malloc(sizeof(struct LineListRec));
-  ll->next->lineno = lineno;
-  ll->next->next = NULL;
+/* Procedure st_add_use records a use of the
+ * symbol name by the tree node t
+ */
+void st_add_use(char *name, TreeNode *t, UseKind kind) {
+  addUse(st_bucket(name), t->lineno, t->colno, kind);
+}
+
+/* Function symKindName returns the Sym.Type
+ * column for the declaration node
+ */
+static const char *symKindName(TreeNode *node) {
+  switch (node->nodekind) {
+    case DeclK:
+      switch (node->kind.decl) {
+        case FuncK:      return "Function";
+        case VarK:       return "Variable";
+        case VectorVarK: return "Vector V";
+        default:         return "";
+      }
+    case ParamK:
+      switch (node->kind.param) {
+        case NonVectorParamK: return "Variable";
+        case VectorParamK:    return "Vector V";
+        default:              return "";
+      }
+    default:
+      return "";
+  }
+}
+
+/* Function dataTypeName returns the Data Type
+ * column for the expression type type
+ */
+static const char *dataTypeName(ExpType type) {
+  switch (type) {
+    case Void:         return "Void";
+    case Integer:      return "Integer";
+    case IntegerArray: return "IntegerArray";
+    case Boolean:      return "Boolean";
+    default:           return "";
+  }
 }
 
 void printSymTabRows(BucketList *hashTable, FILE *listing) {
   int j;
 
   for (j = 0; j < SIZE; ++j) {
-    if (hashTable[j] != NULL) {
-      BucketList l = hashTable[j];
+    BucketList l;
+    for (l = hashTable[j]; l != NULL; l = l->next) {
       TreeNode *node = l->treeNode;
+      int k;
 
-      while (l != NULL) {
-        LineList t = l->lines;
-
-        fprintf(listing, "%-14s ", l->name);
-
-        switch (node->nodekind) {
-          case DeclK:
-            switch (node->kind.decl) {
-              case FuncK:
-                fprintf(listing, "Function  ");
-                break;
-              case VarK:
-                fprintf(listing, "Variable  ");
-                break;
-              case VectorVarK:
-                fprintf(listing, "Vector V  ");
-                break;
-              default:
-                break;
-            }
-            break;
-          case ParamK:
-            switch (node->kind.param) {
-              case NonVectorParamK:
-                fprintf(listing, "Variable  ");
-                break;
-              case VectorParamK:
-                fprintf(listing, "Vector V  ");
-                break;
-              default:
-                break;
-            }
-            break;
-          default:
-            break;
-        }
-
-        switch (node->type) {
-          case Void:
-            fprintf(listing, "Void         ");
-            break;
-          case Integer:
-            fprintf(listing, "Integer      ");
-            break;
-          case IntegerArray:
-            fprintf(listing, "IntegerArray ");
-            break;
-          case Boolean:
-            fprintf(listing, "Boolean      ");
-            break;
-          default:
-            break;
-        }
-
-        while (t != NULL) {
-          fprintf(listing, "%4d ", t->lineno);
-          t = t->next;
-        }
-
-        fprintf(listing, "\n");
-        l = l->next;
+      fprintf(listing, "%-14s %-8s  %-12s ", l->name, symKindName(node),
+              dataTypeName(node->type));
+      for (k = 0; k < l->nUses; ++k)
+        fprintf(listing, "%4d ", l->uses[k].lineno);
+      fputc('\n', listing);
+    }
+  }
+}
+
+/* Procedure printSymTabJson prints each symbol of
+ * the table as one JSON line
+ */
+static void printSymTabJson(FILE *listing, int first) {
+  int i, j;
+
+  for (i = first; i < nScope; ++i) {
+    Scope scope = scopes[i];
+    if (scope == NULL)
+      continue;
+    for (j = 0; j < SIZE; ++j) {
+      BucketList l;
+      for (l = scope->hashTable[j]; l != NULL; l = l->next) {
+        int k;
+        fprintf(listing, "{\"type\": \"symbol\", \"scope\": ");
+        if (i == 0)
+          fprintf(listing, "null");
+        else
+          printJsonString(listing, scope->funcName);
+        fprintf(listing, ", \"level\": %d, \"name\": ", scope->nestedLevel);
+        printJsonString(listing, l->name);
+        fprintf(listing, ", \"kind\": \"%s\", \"datatype\": \"%s\", \"lines\": [",
+                symKindName(l->treeNode), dataTypeName(l->treeNode->type));
+        for (k = 0; k < l->nUses; ++k)
+          fprintf(listing, k ? ", %d" : "%d", l->uses[k].lineno);
+        fprintf(listing, "]}\n");
       }
     }
   }
 }
 
-/* Procedure printSymTab prints a formatted
- * listing of the symbol table contents
- * to the listing file
+/* Procedure printScopes prints the scopes from
+ * the first-th on as printSymTab does
  */
-void printSymTab(FILE *listing) {
+void printScopes(FILE *listing, int first) {
   int i;
 
-  for (i = 0; i < nScope; ++i) {
+  if (JsonListing) {
+    printSymTabJson(listing, first);
+    return;
+  }
+
+  for (i = first; i < nScope; ++i) {
     Scope scope = scopes[i];
-    BucketList *hashTable = scope->hashTable;
+    BucketList *hashTable;
+
+    if (scope == NULL)
+      continue;
+    hashTable = scope->hashTable;
 
     if (i == 0) {     // global scope
       fprintf(listing, "<global scope> ");
@@ -261,4 +462,12 @@ void printSymTab(FILE *listing) {
 
     fputc('\n', listing);
   }
-} /* printSymTab */
\ No newline at end of file
+}
+
+/* Procedure printSymTab prints a formatted
+ * listing of the symbol table contents
+ * to the listing file
+ */
+void printSymTab(FILE *listing) {
+  printScopes(listing, 0);
+} /* printSymTab */
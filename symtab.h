@@ -13,25 +13,31 @@
 /* SIZE is the size of the hash table */
 #define SIZE 211
 
-/* the list of line numbers of the source
- * code in which a variable is referenced
- */
-typedef struct LineListRec {
+/* the ways a symbol is used in the source code */
+typedef enum { UseDecl, UseRead, UseWrite, UseCall } UseKind;
+
+/* one use of a symbol in the source code */
+typedef struct {
   int lineno;
-  struct LineListRec *next;
-} *LineList;
+  int colno;
+  UseKind kind;
+} XrefUse;
 
 /* The record in the bucket lists for
  * each variable, including name,
  * assigned memory location, and
- * the list of line numbers in which
- * it appears in the source code
+ * the uses of the symbol in the
+ * source code, in source order
  */
 typedef struct BucketListRec {
   char *name;
-  LineList lines;
+  XrefUse *uses;  /* growable array of nUses uses */
+  int nUses;
+  int maxUses;
   TreeNode *treeNode;
   int memloc ; /* memory location for variable */
+  int offset; /* frame offset assigned by the code generator */
+  struct ScopeRec *scope; /* scope in which the symbol is declared */
   struct BucketListRec *next;
 } *BucketList;
 
@@ -39,17 +45,18 @@ typedef struct BucketListRec {
 typedef struct ScopeRec {
   char *funcName;
   int nestedLevel;
+  int id; /* index in the scope registry */
   struct ScopeRec *parent;
-  BucketList hashTable[SIZE]; /* the hash table */
+  BucketList *hashTable; /* the hash table, SIZE chains */
 } *Scope;
 
-
-Scope globalScope;
+extern Scope globalScope;
 
 /* Procedure st_insert inserts line numbers and
  * memory locations into the symbol table
  * loc = memory location is inserted only the
- * first time, otherwise ignored
+ * first time, otherwise ignored; lineno 0 inserts
+ * a built-in symbol, which has no declaration line
  */
 void st_insert(char *name, int lineno, int loc, TreeNode *treeNode);
 
@@ -57,16 +64,65 @@ void st_insert(char *name, int lineno, int loc, TreeNode *treeNode);
  * location of a variable or -1 if not found
  */
 int st_lookup (char *name);
-int st_add_lineno(char *name, int lineno);
+
+/* Procedure st_add_use records a use of the
+ * symbol name by the tree node t
+ */
+void st_add_use(char *name, TreeNode *t, UseKind kind);
+
 BucketList st_bucket(const char *name);
 int st_lookup_top (char *name);
 
+/* Function st_scope returns the i-th scope created
+ * since the last st_reset, or NULL past the last one
+ * or if it was released
+ */
+Scope st_scope(int i);
+
+/* Function st_count returns the number of slots
+ * of the scope registry, the index of the next
+ * scope to be created
+ */
+int st_count(void);
+
+/* Procedure st_release frees the symbols of scope
+ * sc, which no pass may use again, and keeps the
+ * scope for sc_create to reuse; the size figures of
+ * st_stats still count it
+ */
+void st_release(Scope sc);
+
 Scope sc_create(char *funcName);
 Scope sc_top(void);
 void sc_pop(void);
 void sc_push(Scope scope);
 int addLocation(void);
 
+/* Procedure st_reset discards every scope and
+ * symbol so that a new program can be analysed
+ */
+void st_reset(void);
+
+/* CHAINHIST is the number of rows in the histogram
+ * of hash chain lengths; the last row counts the
+ * chains of CHAINHIST or more symbols
+ */
+#define CHAINHIST 4
+
+/* size figures of the symbol table */
+typedef struct {
+  int scopes;
+  int symbols;
+  int buckets;               /* hash table slots in all scopes */
+  int usedBuckets;           /* slots with a non-empty chain */
+  int maxChain;              /* length of the longest chain */
+  int chainHist[CHAINHIST];  /* chains of length 1 .. CHAINHIST */
+} SymtabStats;
+
+/* Procedure st_stats fills s with the size figures
+ * of the scopes created since the last st_reset
+ */
+void st_stats(SymtabStats *s);
 
 /* Procedure printSymTab prints a formatted
  * listing of the symbol table contents
@@ -74,4 +130,9 @@ int addLocation(void);
  */
 void printSymTab(FILE *listing);
 
+/* Procedure printScopes prints the scopes from
+ * the first-th on as printSymTab does
+ */
+void printScopes(FILE *listing, int first);
+
 #endif
\ No newline at end of file
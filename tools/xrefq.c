@@ -0,0 +1,85 @@
+/****************************************************/
+/* File: xrefq.c                                    */
+/* Queries a cross-reference index written by       */
+/* cminus --xref: prints the declarations and uses  */
+/* of a symbol                                      */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../xref.h"
+
+static const char *kindName[] = {
+  "function", "variable", "array", "parameter", "array parameter"
+};
+
+/* in the order of UseKind in symtab.h */
+static const char *useName[] = { "decl", "read", "write", "call" };
+
+int main(int argc, char *argv[]) {
+  const XrefFileHeader *h;
+  const XrefFileSymbol *syms;
+  const XrefFileUse *uses;
+  const char *strings;
+  struct stat st;
+  char *map;
+  int fd, lo, hi, mid, i, j;
+
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <index> <symbol>\n", argv[0]);
+    return 1;
+  }
+  fd = open(argv[1], O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    perror(argv[1]);
+    return 1;
+  }
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED || st.st_size < (off_t) sizeof(XrefFileHeader)) {
+    fprintf(stderr, "%s: not an index\n", argv[1]);
+    return 1;
+  }
+  h = (const XrefFileHeader *) map;
+  if (memcmp(h->magic, XREF_MAGIC, sizeof(XREF_MAGIC)) != 0 ||
+      h->size != (uint32_t) st.st_size) {
+    fprintf(stderr, "%s: not an index\n", argv[1]);
+    return 1;
+  }
+  syms = (const XrefFileSymbol *) (map + h->symbolsOff);
+  uses = (const XrefFileUse *) (map + h->usesOff);
+  strings = map + h->stringsOff;
+
+  /* first symbol whose name is not below argv[2] */
+  lo = 0;
+  hi = h->nSymbols;
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (strcmp(strings + syms[mid].name, argv[2]) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == (int) h->nSymbols || strcmp(strings + syms[lo].name, argv[2]) != 0) {
+    fprintf(stderr, "%s: not found\n", argv[2]);
+    return 1;
+  }
+  for (i = lo; i < (int) h->nSymbols &&
+              strcmp(strings + syms[i].name, argv[2]) == 0; ++i) {
+    printf("%s %s in %s (level %u)\n", kindName[syms[i].kind], argv[2],
+           syms[i].scope == XREF_GLOBAL ? "<global>" : strings + syms[i].scope,
+           syms[i].level);
+    for (j = 0; j < (int) syms[i].nUses; ++j) {
+      const XrefFileUse *u = &uses[syms[i].firstUse + j];
+      printf("  %u:%u %s\n", u->lineno, u->colno, useName[u->kind]);
+    }
+  }
+  munmap(map, st.st_size);
+  close(fd);
+  return 0;
+}
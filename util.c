@@ -8,10 +8,60 @@
 #include "globals.h"
 #include "util.h"
 
-/* Procedure printToken prints a token
- * and its lexeme to the listing file
+/* LISTBUFSIZE is the size of the listing buffer */
+#define LISTBUFSIZE (1 << 20)
+
+/* Procedure setListing makes f the listing file and
+ * gives it a large buffer, so that the listing
+ * reaches the file in a few big writes
  */
-void printToken(TokenType token, const char *tokenString) {
+void setListing(FILE *f) {
+  static char *buffer = NULL;
+  if (buffer == NULL)
+    buffer = (char *) malloc(LISTBUFSIZE);
+  if (buffer != NULL)
+    setvbuf(f, buffer, _IOFBF, LISTBUFSIZE);
+  listing = f;
+}
+
+/* Procedure printJsonString writes a string
+ * to a file as a quoted JSON string
+ */
+void printJsonString(FILE *out, const char *s) {
+  fputc('"', out);
+  for (; *s != '\0'; ++s) {
+    if (*s == '"' || *s == '\\')
+      fprintf(out, "\\%c", *s);
+    else if ((unsigned char) *s < 0x20)
+      fprintf(out, "\\u%04x", *s);
+    else
+      fputc(*s, out);
+  }
+  fputc('"', out);
+}
+
+/* Procedure printError reports an error that a
+ * compiler phase found on a source line, as text
+ * or as a JSON line (see JsonListing)
+ */
+void printError(const char *phase, int lineno, const char *message) {
+  if (JsonListing) {
+    fprintf(listing, "{\"type\": \"error\", \"phase\": \"%s\", \"line\": %d, \"message\": ",
+            phase, lineno);
+    printJsonString(listing, message);
+    fprintf(listing, "}\n");
+  }
+  else
+    fprintf(listing, "line %d: %s\n", lineno, message);
+}
+
+/* Function formatToken writes the line that
+ * printToken prints for the token to buf, of size
+ * bytes, and returns its length as snprintf does
+ */
+int formatToken(char *buf, size_t size, TokenType token, const char *tokenString) {
+  const char *text;
+
   switch (token) {
     case IF:
     case ELSE:
@@ -19,48 +69,109 @@ void printToken(TokenType token, const char *tokenString) {
     case INT:
     case RETURN:
     case WHILE:
-      fprintf(listing, "reserved word: %s\n", tokenString);
-      break;
-    case ASSIGN:     fprintf(listing, "=\n");   break;
-    case LT:         fprintf(listing, "<\n");   break;
-    case LET:        fprintf(listing, "<=\n");  break;
-    case GT:         fprintf(listing, ">\n");   break;
-    case GET:        fprintf(listing, ">=\n");  break;
-    case EQ:         fprintf(listing, "==\n");  break;
-    case NEQ:        fprintf(listing, "!=\n");  break;
-    case LPAREN:     fprintf(listing, "(\n");   break;
-    case RPAREN:     fprintf(listing, ")\n");   break;
-    case LBRACKET:   fprintf(listing, "[\n");   break;
-    case RBRACKET:   fprintf(listing, "]\n");   break;
-    case LBRACE:     fprintf(listing, "{\n");   break;
-    case RBRACE:     fprintf(listing, "}\n");   break;
-    case SEMI:       fprintf(listing, ";\n");   break;
-    case PLUS:       fprintf(listing, "+\n");   break;
-    case MINUS:      fprintf(listing, "-\n");   break;
-    case TIMES:      fprintf(listing, "*\n");   break;
-    case OVER:       fprintf(listing, "/\n");   break;
-    case COMMA:      fprintf(listing, ",\n");   break;
-    case ENDFILE:    fprintf(listing, "EOF\n"); break;
+      return snprintf(buf, size, "reserved word: %s\n", tokenString);
+    case ASSIGN:     text = "=";   break;
+    case LT:         text = "<";   break;
+    case LET:        text = "<=";  break;
+    case GT:         text = ">";   break;
+    case GET:        text = ">=";  break;
+    case EQ:         text = "==";  break;
+    case NEQ:        text = "!=";  break;
+    case LPAREN:     text = "(";   break;
+    case RPAREN:     text = ")";   break;
+    case LBRACKET:   text = "[";   break;
+    case RBRACKET:   text = "]";   break;
+    case LBRACE:     text = "{";   break;
+    case RBRACE:     text = "}";   break;
+    case SEMI:       text = ";";   break;
+    case PLUS:       text = "+";   break;
+    case MINUS:      text = "-";   break;
+    case TIMES:      text = "*";   break;
+    case OVER:       text = "/";   break;
+    case COMMA:      text = ",";   break;
+    case ENDFILE:    text = "EOF"; break;
 
     case NUM:
-      fprintf(listing, "NUM, val= %s\n", tokenString);
-      break;
+      return snprintf(buf, size, "NUM, val= %s\n", tokenString);
     case ID:
-      fprintf(listing, "ID, name= %s\n", tokenString);
-      break;
+      return snprintf(buf, size, "ID, name= %s\n", tokenString);
     case ERROR:
-      fprintf(listing, "ERROR: %s\n", tokenString);
-      break;
+      return snprintf(buf, size, "ERROR: %s\n", tokenString);
     default: /* should never happen */
-      fprintf(listing, "Unknown token: %d\n", token);
+      return snprintf(buf, size, "Unknown token: %d\n", token);
   }
+  return snprintf(buf, size, "%s\n", text);
+}
+
+/* Procedure printToken prints a token
+ * and its lexeme to the listing file
+ */
+void printToken(TokenType token, const char *tokenString) {
+  char buf[MAXTOKENTEXT];
+
+  formatToken(buf, sizeof(buf), token, tokenString);
+  fputs(buf, listing);
+}
+
+/* The nodes and identifier strings of the syntax
+ * tree are carved out of blocks of at least
+ * ARENABLOCK bytes. Only one tree is alive at a
+ * time, so freeTree releases them all at once and
+ * keeps the blocks warm for the next parse
+ */
+#define ARENABLOCK (64 * 1024)
+
+typedef struct ArenaBlockRec {
+  struct ArenaBlockRec *next;
+  size_t used, size;
+  char *data;
+} *ArenaBlock;
+
+/* each thread allocates from its own arena; the
+ * blocks used by another thread are joined to this
+ * one with attachArena
+ */
+static __thread ArenaBlock arenaFirst = NULL;
+static __thread ArenaBlock arenaCur = NULL; /* NULL when the arena is empty */
+
+/* Function treeAlloc returns n bytes from the tree
+ * arena, or NULL if out of memory
+ */
+static void *treeAlloc(size_t n) {
+  ArenaBlock b;
+
+  n = (n + 15) & ~(size_t) 15;
+  if (arenaCur != NULL && arenaCur->used + n <= arenaCur->size) {
+    arenaCur->used += n;
+    return arenaCur->data + arenaCur->used - n;
+  }
+  b = arenaCur != NULL ? arenaCur->next : arenaFirst;
+  if (b == NULL || b->size < n) {
+    size_t size = n > ARENABLOCK ? n : ARENABLOCK;
+    b = (ArenaBlock) malloc(sizeof(struct ArenaBlockRec) + size);
+    if (b == NULL)
+      return NULL;
+    b->size = size;
+    b->data = (char *) (b + 1);
+    if (arenaCur == NULL) {
+      b->next = arenaFirst;
+      arenaFirst = b;
+    }
+    else {
+      b->next = arenaCur->next;
+      arenaCur->next = b;
+    }
+  }
+  arenaCur = b;
+  b->used = n;
+  return b->data;
 }
 
 /* Function newStmtNode creates a new statement
  * node for syntax tree construction
  */
 TreeNode * newStmtNode(StmtKind kind) {
-  TreeNode *t = (TreeNode *) malloc(sizeof(TreeNode));
+  TreeNode *t = (TreeNode *) treeAlloc(sizeof(TreeNode));
   int i;
   if (t == NULL)
     fprintf(listing, "Out of memory error at line %d\n", lineno);
@@ -71,6 +182,7 @@ TreeNode * newStmtNode(StmtKind kind) {
     t->nodekind  = StmtK;
     t->kind.stmt = kind;
     t->lineno    = lineno;
+    t->colno     = 0;
   }
   return t;
 }
@@ -79,7 +191,7 @@ TreeNode * newStmtNode(StmtKind kind) {
  * node for syntax tree construction
  */
 TreeNode * newExpNode(ExpKind kind) {
-  TreeNode *t = (TreeNode *) malloc(sizeof(TreeNode));
+  TreeNode *t = (TreeNode *) treeAlloc(sizeof(TreeNode));
   int i;
   if (t == NULL)
     fprintf(listing, "Out of memory error at line %d\n", lineno);
@@ -90,7 +202,9 @@ TreeNode * newExpNode(ExpKind kind) {
     t->nodekind  = ExpK;
     t->kind.exp  = kind;
     t->lineno    = lineno;
+    t->colno     = 0;
     t->type      = Void;
+    t->inBounds  = FALSE;
   }
   return t;
 }
@@ -99,7 +213,7 @@ TreeNode * newExpNode(ExpKind kind) {
  * node for syntax tree construction
  */
 TreeNode * newDeclNode(DeclKind kind) {
-  TreeNode *t = (TreeNode *) malloc(sizeof(TreeNode));
+  TreeNode *t = (TreeNode *) treeAlloc(sizeof(TreeNode));
   int i;
   if (t == NULL)
     fprintf(listing, "Out of memory error at line %d\n", lineno);
@@ -110,6 +224,8 @@ TreeNode * newDeclNode(DeclKind kind) {
     t->nodekind  = DeclK;
     t->kind.decl = kind;
     t->lineno    = lineno;
+    t->colno     = 0;
+    t->callNode  = NULL;
   }
   return t;
 }
@@ -118,7 +234,7 @@ TreeNode * newDeclNode(DeclKind kind) {
  * node for syntax tree construction
  */
 TreeNode * newParamNode(ParamKind kind) {
-  TreeNode *t = (TreeNode *) malloc(sizeof(TreeNode));
+  TreeNode *t = (TreeNode *) treeAlloc(sizeof(TreeNode));
   int i;
   if (t == NULL)
     fprintf(listing, "Out of memory error at line %d\n", lineno);
@@ -129,6 +245,7 @@ TreeNode * newParamNode(ParamKind kind) {
     t->nodekind   = ParamK;
     t->kind.param = kind;
     t->lineno     = lineno;
+    t->colno      = 0;
   }
   return t;
 }
@@ -137,7 +254,7 @@ TreeNode * newParamNode(ParamKind kind) {
  * node for syntax tree construction
  */
 TreeNode * newTypeNode(TypeKind kind)
-{ TreeNode *t = (TreeNode *) malloc(sizeof(TreeNode));
+{ TreeNode *t = (TreeNode *) treeAlloc(sizeof(TreeNode));
   int i;
   if (t == NULL)
     fprintf(listing,"Out of memory error at line %d\n",lineno);
@@ -148,12 +265,13 @@ TreeNode * newTypeNode(TypeKind kind)
     t->nodekind  = TypeK;
     t->kind.type = kind;
     t->lineno    = lineno;
+    t->colno     = 0;
   }
   return t;
 }
 
 /* Function copyString allocates and makes a new
- * copy of an existing string
+ * copy of an existing string in the tree arena
  */
 char * copyString(char *s) {
   int n;
@@ -161,7 +279,7 @@ char * copyString(char *s) {
   if (s == NULL)
     return NULL;
   n = strlen(s) + 1;
-  t = malloc(n);
+  t = treeAlloc(n);
   if (t == NULL)
     fprintf(listing, "Out of memory error at line %d\n", lineno);
   else
@@ -169,6 +287,50 @@ char * copyString(char *s) {
   return t;
 }
 
+/* Procedure freeTree releases the syntax tree,
+ * with every other node and string allocated since
+ * the last call; the arena blocks are kept for
+ * the next parse
+ */
+void freeTree(TreeNode *tree) {
+  arenaCur = NULL;
+}
+
+void *detachArena(void) {
+  ArenaBlock blocks = arenaCur != NULL ? arenaFirst : NULL;
+  /* the blocks after arenaCur hold no nodes */
+  ArenaBlock b = arenaCur != NULL ? arenaCur->next : arenaFirst;
+
+  if (arenaCur != NULL)
+    arenaCur->next = NULL;
+  while (b != NULL) {
+    ArenaBlock next = b->next;
+    free(b);
+    b = next;
+  }
+  arenaFirst = arenaCur = NULL;
+  return blocks;
+}
+
+void attachArena(void *blocks) {
+  ArenaBlock last = (ArenaBlock) blocks;
+
+  if (last == NULL)
+    return;
+  while (last->next != NULL)
+    last = last->next;
+  /* the blocks in use are the ones up to arenaCur */
+  if (arenaCur == NULL) {
+    last->next = arenaFirst;
+    arenaFirst = (ArenaBlock) blocks;
+  }
+  else {
+    last->next = arenaCur->next;
+    arenaCur->next = (ArenaBlock) blocks;
+  }
+  arenaCur = last;
+}
+
 /* Variable indentno is used by printTree to
  * store current number of spaces to indent
  */
@@ -7,11 +7,40 @@
 #ifndef _UTIL_H_
 #define _UTIL_H_
 
+/* Procedure setListing makes f the listing file and
+ * gives it a large buffer, so that the listing
+ * reaches the file in a few big writes
+ */
+void setListing( FILE * );
+
+/* Procedure printJsonString writes a string
+ * to a file as a quoted JSON string
+ */
+void printJsonString( FILE *, const char * );
+
+/* Procedure printError reports an error that a
+ * compiler phase found on a source line, as text
+ * or as a JSON line (see JsonListing)
+ */
+void printError( const char *phase, int lineno, const char *message );
+
+/* MAXTOKENTEXT is the size of a buffer that holds
+ * any line printToken prints for a token of the
+ * scanner
+ */
+#define MAXTOKENTEXT 64
+
 /* Procedure printToken prints a token
  * and its lexeme to the listing file
  */
 void printToken( TokenType, const char* );
 
+/* Function formatToken writes the line that
+ * printToken prints for the token to buf, of size
+ * bytes, and returns its length as snprintf does
+ */
+int formatToken( char *buf, size_t size, TokenType, const char* );
+
 /* Function newStmtNode creates a new statement
  * node for syntax tree construction
  */
@@ -42,6 +71,21 @@ TreeNode * newTypeNode(TypeKind);
  */
 char * copyString( char * );
 
+/* Procedure freeTree releases the syntax tree and
+ * its identifier strings; their memory is kept for
+ * the next parse
+ */
+void freeTree( TreeNode * );
+
+/* Function detachArena takes the nodes and strings
+ * allocated by the calling thread out of its arena
+ * and returns them; attachArena adds them to the
+ * arena of the calling thread, so that they are
+ * released with its tree
+ */
+void *detachArena( void );
+void attachArena( void * );
+
 /* procedure printTree prints a syntax tree to the
  * listing file using indentation to indicate subtrees
  */
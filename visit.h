@@ -0,0 +1,85 @@
+/****************************************************/
+/* File: visit.h                                    */
+/* Syntax tree visitors with static dispatch for    */
+/* the C- compiler                                  */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _VISIT_H_
+#define _VISIT_H_
+
+/* NKINDS bounds the number of kinds of every node
+ * kind, so that nodekind and kind make one dense
+ * class number
+ */
+#define NKINDS 6
+
+#if MAXCHILDREN != 3
+#error "visit.h visits exactly three children"
+#endif
+
+#define NODECLASS(nodekind, kind) ((nodekind) * NKINDS + (kind))
+
+/* every member of the kind union is an enum, so
+ * any of them reads the kind of t
+ */
+#define CLASSOF(t) NODECLASS((t)->nodekind, (int) (t)->kind.exp)
+
+/* VISITCASE turns an entry X(nodekind, kind, handler)
+ * of a handler list into a case of the dispatch
+ */
+#define VISITCASE(nodekind, kind, handler) \
+  case NODECLASS(nodekind, kind): handler(t); break;
+
+/* NOHANDLERS is the empty handler list */
+#define NOHANDLERS(X)
+
+/* DEFINE_VISITOR(name, PRE, POST) defines
+ *
+ *   static void name(TreeNode *t);
+ *   static void nameNode(TreeNode *t);
+ *
+ * name visits the list t and nameNode the single
+ * node t, each with its subtrees, in the order of
+ * the old traverse of analyze.c: the handlers of
+ * the PRE list run before the children of a node
+ * and those of the POST list after them. A list is
+ * an X-macro of X(nodekind, kind, handler) entries,
+ * and each handler is a static void f(TreeNode *t).
+ * Every dispatch is a single switch over the node
+ * class, which the compiler turns into one jump
+ * table with the handlers inlined; classes with no
+ * handler fall through the default
+ */
+/* VISIT_BODY_ is the visit of the single node t:
+ * the PRE dispatch, the children and the POST
+ * dispatch; the children are unrolled so that the
+ * empty ones cost no call
+ */
+#define VISIT_BODY_(name, PRE, POST, t)           \
+    switch (CLASSOF(t)) {                         \
+      PRE(VISITCASE)                              \
+      default: break;                             \
+    }                                             \
+    if (t->child[0] != NULL)                      \
+      name(t->child[0]);                          \
+    if (t->child[1] != NULL)                      \
+      name(t->child[1]);                          \
+    if (t->child[2] != NULL)                      \
+      name(t->child[2]);                          \
+    switch (CLASSOF(t)) {                         \
+      POST(VISITCASE)                             \
+      default: break;                             \
+    }
+
+#define DEFINE_VISITOR(name, PRE, POST)           \
+  static void name(TreeNode *t) {                 \
+    for (; t != NULL; t = t->sibling) {           \
+      VISIT_BODY_(name, PRE, POST, t)             \
+    }                                             \
+  }                                               \
+  static void name##Node(TreeNode *t) {           \
+    VISIT_BODY_(name, PRE, POST, t)               \
+  }
+
+#endif
@@ -0,0 +1,136 @@
+/****************************************************/
+/* File: xref.c                                     */
+/* Cross-reference index file of the C- compiler:  */
+/* writes the symbols of the symbol table and       */
+/* their uses in a memory-mappable layout           */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "xref.h"
+
+/* the names written to the string area, each once */
+static char *strings;
+static uint32_t stringsLen, stringsCap;
+static const char **internKey;
+static uint32_t *internOff;
+static int internCap;
+
+static unsigned hashName(const char *s) {
+  unsigned h = 0;
+  while (*s != '\0')
+    h = h * 31 + (unsigned char) *s++;
+  return h;
+}
+
+/* Function internName returns the offset of name
+ * in the string area, adding it the first time
+ */
+static uint32_t internName(const char *name) {
+  int h = hashName(name) % internCap;
+  uint32_t len;
+
+  while (internKey[h] != NULL) {
+    if (strcmp(internKey[h], name) == 0)
+      return internOff[h];
+    h = (h + 1) % internCap;
+  }
+  len = strlen(name) + 1;
+  if (stringsLen + len > stringsCap) {
+    stringsCap = 2 * (stringsLen + len);
+    strings = (char *) realloc(strings, stringsCap);
+  }
+  memcpy(strings + stringsLen, name, len);
+  internKey[h] = name;
+  internOff[h] = stringsLen;
+  stringsLen += len;
+  return internOff[h];
+}
+
+static XrefSymKind symKind(TreeNode *decl) {
+  if (decl->nodekind == ParamK)
+    return decl->kind.param == VectorParamK ? XrefArrayParam : XrefParam;
+  switch (decl->kind.decl) {
+    case FuncK:      return XrefFunction;
+    case VectorVarK: return XrefArray;
+    default:         return XrefVariable;
+  }
+}
+
+static int compareSymbol(const void *a, const void *b) {
+  BucketList x = *(const BucketList *) a;
+  BucketList y = *(const BucketList *) b;
+  int c = strcmp(x->name, y->name);
+  if (c != 0)
+    return c;
+  return x->scope->nestedLevel - y->scope->nestedLevel;
+}
+
+void writeXref(FILE *out) {
+  XrefFileHeader header;
+  XrefFileSymbol *recs;
+  XrefFileUse use;
+  BucketList *syms;
+  BucketList l;
+  Scope sc;
+  int nScopes, nSyms = 0, nUses = 0;
+  int i, j;
+
+  for (nScopes = 0; (sc = st_scope(nScopes)) != NULL; ++nScopes)
+    for (j = 0; j < SIZE; ++j)
+      for (l = sc->hashTable[j]; l != NULL; l = l->next) {
+        ++nSyms;
+        nUses += l->nUses;
+      }
+  syms = (BucketList *) malloc((nSyms ? nSyms : 1) * sizeof(BucketList));
+  recs = (XrefFileSymbol *) malloc((nSyms ? nSyms : 1) * sizeof(XrefFileSymbol));
+  nSyms = 0;
+  for (i = 0; i < nScopes; ++i)
+    for (j = 0; j < SIZE; ++j)
+      for (l = st_scope(i)->hashTable[j]; l != NULL; l = l->next)
+        syms[nSyms++] = l;
+  qsort(syms, nSyms, sizeof(BucketList), compareSymbol);
+
+  /* every name is a symbol or a function */
+  internCap = 2 * (nSyms + nScopes) + 1;
+  internKey = (const char **) calloc(internCap, sizeof(char *));
+  internOff = (uint32_t *) malloc(internCap * sizeof(uint32_t));
+  stringsLen = 0;
+  for (i = 0, j = 0; i < nSyms; ++i) {
+    l = syms[i];
+    recs[i].name = internName(l->name);
+    recs[i].scope = l->scope->funcName != NULL ? internName(l->scope->funcName)
+                                                : XREF_GLOBAL;
+    recs[i].level = l->scope->nestedLevel;
+    recs[i].kind = symKind(l->treeNode);
+    recs[i].firstUse = j;
+    recs[i].nUses = l->nUses;
+    j += l->nUses;
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, XREF_MAGIC, sizeof(XREF_MAGIC));
+  header.nSymbols = nSyms;
+  header.nUses = nUses;
+  header.symbolsOff = sizeof(header);
+  header.usesOff = header.symbolsOff + nSyms * sizeof(XrefFileSymbol);
+  header.stringsOff = header.usesOff + nUses * sizeof(XrefFileUse);
+  header.size = header.stringsOff + stringsLen;
+
+  fwrite(&header, sizeof(header), 1, out);
+  fwrite(recs, sizeof(XrefFileSymbol), nSyms, out);
+  for (i = 0; i < nSyms; ++i)
+    for (j = 0; j < syms[i]->nUses; ++j) {
+      use.lineno = syms[i]->uses[j].lineno;
+      use.colno = syms[i]->uses[j].colno;
+      use.kind = syms[i]->uses[j].kind;
+      fwrite(&use, sizeof(use), 1, out);
+    }
+  fwrite(strings, 1, stringsLen, out);
+
+  free(syms);
+  free(recs);
+  free(internKey);
+  free(internOff);
+}
@@ -0,0 +1,67 @@
+/****************************************************/
+/* File: xref.h                                     */
+/* Cross-reference index file of the C- compiler   */
+/* Max Forasteiro                                   */
+/****************************************************/
+
+#ifndef _XREF_H_
+#define _XREF_H_
+
+#include <stdint.h>
+
+/* The index file is meant to be memory-mapped by
+ * code navigation tools. It holds, in this order:
+ *
+ *   an XrefFileHeader
+ *   nSymbols XrefFileSymbol records, sorted by name
+ *     (then by nesting level), for binary search
+ *   nUses XrefFileUse records; the uses of a symbol
+ *     are contiguous, in source order, and start
+ *     with its declaration
+ *   the NUL-terminated names
+ *
+ * All fields are 32-bit integers in the byte order
+ * of the compiling machine, and every offset counts
+ * from the start of the file
+ */
+
+#define XREF_MAGIC "CMXREF1"
+
+/* scope of the symbols declared at the top level */
+#define XREF_GLOBAL 0xffffffffu
+
+typedef enum {
+  XrefFunction, XrefVariable, XrefArray, XrefParam, XrefArrayParam
+} XrefSymKind;
+
+typedef struct {
+  char magic[8];        /* XREF_MAGIC */
+  uint32_t nSymbols;
+  uint32_t nUses;
+  uint32_t symbolsOff;
+  uint32_t usesOff;
+  uint32_t stringsOff;
+  uint32_t size;        /* size of the whole file */
+} XrefFileHeader;
+
+typedef struct {
+  uint32_t name;        /* offset of the symbol name */
+  uint32_t scope;       /* offset of the enclosing function name, or XREF_GLOBAL */
+  uint32_t level;       /* nesting level of the declaring scope */
+  uint32_t kind;        /* XrefSymKind */
+  uint32_t firstUse;    /* index of the first use */
+  uint32_t nUses;
+} XrefFileSymbol;
+
+typedef struct {
+  uint32_t lineno;
+  uint32_t colno;
+  uint32_t kind;        /* UseKind of symtab.h */
+} XrefFileUse;
+
+/* Procedure writeXref writes the index of the
+ * symbol table to the file out
+ */
+void writeXref(FILE *out);
+
+#endif